@@ -0,0 +1,78 @@
+/*
+ * Helpers shared by the host benchmarks: payload loading, a monotonic
+ * clock, and the pre-json_minify() body trimming kept as a baseline.
+ */
+#pragma once
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef BENCH_PAYLOAD_DIR
+#define BENCH_PAYLOAD_DIR "payloads"
+#endif
+
+/* esp_http_client's default receive buffer: HTTP_EVENT_ON_DATA chunk size */
+#define BENCH_CHUNK_SIZE 512
+
+static inline double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* NUL-terminated contents of dir/name (malloc'd), NULL if unreadable. */
+static inline char *bench_load(const char *dir, const char *name, int *len)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    *len = ftell(f);
+    rewind(f);
+    char *js = malloc(*len + 1);
+    if (js && fread(js, 1, *len, f) != (size_t)*len) {
+        free(js);
+        js = NULL;
+    }
+    fclose(f);
+    if (js) {
+        js[*len] = '\0';
+    }
+    return js;
+}
+
+/* handler_callbacks.c's memcpy_trimmed() before json_minify() replaced it
+ * (minus the overflow log), kept as the baseline for that step. */
+static inline size_t legacy_memcpy_trimmed(char *dest, int dest_size, const char *src, size_t src_len)
+{
+    size_t chars_stored = 0;
+    for (size_t i = 0; i < src_len; i++) {
+        if (isspace((unsigned char)src[i])) {
+            char prev = i ? src[i - 1] : 0;
+            char next = (i < src_len - 1) ? src[i + 1] : 0;
+            if (prev == ',' && next == '\"') {
+                continue;
+            }
+            if (prev == ':' && chars_stored > 1) {
+                if (dest[chars_stored - 2] == '\"') {
+                    continue;
+                }
+            }
+            if (strchr(" \"[]{}", prev) || strchr(" \"[]{}", next)) {
+                continue;
+            }
+        }
+        if ((int)chars_stored > dest_size - 1) {
+            return chars_stored;
+        }
+        dest[chars_stored++] = src[i];
+    }
+    return chars_stored;
+}
@@ -0,0 +1,190 @@
+/*
+ * Host benchmark for json_parser's integer decoding: json_str_to_int()/
+ * json_str_to_int64() against the strtoul()/strtoull() based code they
+ * replaced, over every number in the payloads, and the bulk
+ * json_arr_get_member_ints() against per-element lookups for an album's
+ * images[].height.
+ */
+#include "bench_common.h"
+#include "json_parser.h"
+
+#define MAX_TOKENS    4096
+#define MAX_NUMBERS   4096
+#define ROUNDS        5
+#define ROUND_SECONDS 0.1
+
+static const char *const payloads[] = {
+    "player_state.json", "ws_player_state.json", "devices.json", "search.json", "playlists.json",
+};
+
+static json_tok_t tokens[MAX_TOKENS];
+static volatile long sink;
+
+/* Every integer in the payloads, as {start, len} into its document */
+static struct {
+    const char *js;
+    int start;
+    int len;
+} numbers[MAX_NUMBERS];
+static int num_numbers;
+
+/* json_tok_to_int()/json_tok_to_int64() before json_str_to_int*() */
+static int legacy_tok_to_int(const char *js, int start, int len, int *val)
+{
+    char *endptr;
+    int i = strtoul(js + start, &endptr, 10);
+    if (endptr == js + start + len) {
+        *val = i;
+        return OS_SUCCESS;
+    }
+    return -OS_FAIL;
+}
+
+static int legacy_tok_to_int64(const char *js, int start, int len, int64_t *val)
+{
+    char *endptr;
+    int64_t i64 = strtoull(js + start, &endptr, 10);
+    if (endptr == js + start + len) {
+        *val = i64;
+        return OS_SUCCESS;
+    }
+    return -OS_FAIL;
+}
+
+static void step_legacy_int(void *arg)
+{
+    (void)arg;
+    for (int i = 0; i < num_numbers; i++) {
+        int v = 0;
+        legacy_tok_to_int(numbers[i].js, numbers[i].start, numbers[i].len, &v);
+        sink += v;
+    }
+}
+
+static void step_int(void *arg)
+{
+    (void)arg;
+    for (int i = 0; i < num_numbers; i++) {
+        int v = 0;
+        json_str_to_int(numbers[i].js + numbers[i].start, numbers[i].len, &v);
+        sink += v;
+    }
+}
+
+static void step_legacy_int64(void *arg)
+{
+    (void)arg;
+    for (int i = 0; i < num_numbers; i++) {
+        int64_t v = 0;
+        legacy_tok_to_int64(numbers[i].js, numbers[i].start, numbers[i].len, &v);
+        sink += v;
+    }
+}
+
+static void step_int64(void *arg)
+{
+    (void)arg;
+    for (int i = 0; i < num_numbers; i++) {
+        int64_t v = 0;
+        json_str_to_int64(numbers[i].js + numbers[i].start, numbers[i].len, &v);
+        sink += v;
+    }
+}
+
+/* jctx is on item.album.images */
+static void step_heights_each(void *arg)
+{
+    jparse_ctx_t *jctx = arg;
+    for (int i = 0; i < jctx->cur->size; i++) {
+        int h = 0;
+        if (json_arr_get_object(jctx, i) == OS_SUCCESS) {
+            json_obj_get_int(jctx, "height", &h);
+            json_arr_leave_object(jctx);
+        }
+        sink += h;
+    }
+}
+
+static void step_heights_bulk(void *arg)
+{
+    jparse_ctx_t *jctx = arg;
+    int heights[16];
+    int n = json_arr_get_member_ints(jctx, "height", heights, 16, 0);
+    for (int i = 0; i < n; i++) {
+        sink += heights[i];
+    }
+}
+
+static double time_step(void (*fn)(void *), void *arg)
+{
+    double best = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+        long iters = 0;
+        double start = bench_now(), elapsed;
+        do {
+            for (int i = 0; i < 64; i++) {
+                fn(arg);
+            }
+            iters += 64;
+            elapsed = bench_now() - start;
+        } while (elapsed < ROUND_SECONDS);
+        double ns = elapsed * 1e9 / iters;
+        best = (!round || ns < best) ? ns : best;
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    const char *dir = argc > 1 ? argv[1] : BENCH_PAYLOAD_DIR;
+    char *docs[sizeof(payloads) / sizeof(payloads[0])];
+    for (size_t p = 0; p < sizeof(payloads) / sizeof(payloads[0]); p++) {
+        int len;
+        jparse_ctx_t jctx;
+        docs[p] = bench_load(dir, payloads[p], &len);
+        if (!docs[p] || json_parse_start_static(&jctx, docs[p], len, tokens, MAX_TOKENS) != OS_SUCCESS) {
+            fprintf(stderr, "can't read %s/%s\n", dir, payloads[p]);
+            return 1;
+        }
+        for (int t = 0; t < jctx.num_tokens && num_numbers < MAX_NUMBERS; t++) {
+            char c = docs[p][tokens[t].start];
+            if (tokens[t].type == JSMN_PRIMITIVE && (c == '-' || (c >= '0' && c <= '9'))) {
+                numbers[num_numbers].js = docs[p];
+                numbers[num_numbers].start = tokens[t].start;
+                numbers[num_numbers].len = tokens[t].end - tokens[t].start;
+                num_numbers++;
+            }
+        }
+        json_parse_end_static(&jctx);
+    }
+
+    printf("%d integers from %d payloads\n%-28s %10s %10s\n", num_numbers,
+           (int)(sizeof(payloads) / sizeof(payloads[0])), "step", "ns/number", "speedup");
+    double legacy = time_step(step_legacy_int, NULL) / num_numbers;
+    double fast = time_step(step_int, NULL) / num_numbers;
+    printf("%-28s %10.2f\n%-28s %10.2f %9.2fx\n", "strtoul (legacy int)", legacy, "json_str_to_int", fast, legacy / fast);
+    legacy = time_step(step_legacy_int64, NULL) / num_numbers;
+    fast = time_step(step_int64, NULL) / num_numbers;
+    printf("%-28s %10.2f\n%-28s %10.2f %9.2fx\n", "strtoull (legacy int64)", legacy, "json_str_to_int64", fast,
+           legacy / fast);
+
+    jparse_ctx_t jctx;
+    int len = strlen(docs[0]), num_images;
+    if (json_parse_start_static(&jctx, docs[0], len, tokens, MAX_TOKENS) != OS_SUCCESS ||
+        json_obj_get_object(&jctx, "item") != OS_SUCCESS || json_obj_get_object(&jctx, "album") != OS_SUCCESS ||
+        json_obj_get_array(&jctx, "images", &num_images) != OS_SUCCESS) {
+        fprintf(stderr, "no item.album.images in %s\n", payloads[0]);
+        return 1;
+    }
+    printf("\n%s item.album.images (%d)\n%-28s %10s %10s\n", payloads[0], num_images, "step", "ns/array", "speedup");
+    double each = time_step(step_heights_each, &jctx);
+    double bulk = time_step(step_heights_bulk, &jctx);
+    printf("%-28s %10.1f\n%-28s %10.1f %9.2fx\n", "per-element get_int", each, "json_arr_get_member_ints", bulk,
+           each / bulk);
+    json_parse_end_static(&jctx);
+
+    for (size_t p = 0; p < sizeof(payloads) / sizeof(payloads[0]); p++) {
+        free(docs[p]);
+    }
+    return 0;
+}
@@ -0,0 +1,405 @@
+/*
+ * Host benchmark for spotify_client's response parsing (parse_objects.c
+ * plus json_parser/jsmn underneath), built against the ESP-IDF stubs in
+ * stubs/.
+ *
+ * Each op is one full response the way the firmware handles it: bodies that
+ * arrive over HTTP are fed in randomly sized chunks (fixed seed, so runs are
+ * comparable) to the same json_stream/json_filter/json_minify entry points
+ * handler_callbacks.c uses, and whatever the op builds (lists, track
+ * snapshots) is freed before the next one. Each op's result is checked
+ * once, before it's timed (the checks abort the run on a mismatch).
+ * Reported per op: wall time, heap allocations and bytes allocated, and
+ * the peak of live heap above what was live when the op started. malloc & co. are interposed below, so
+ * this needs glibc (libc-internal allocations like strdup's are counted
+ * too).
+ */
+#include <malloc.h>
+#include <stdint.h>
+
+#include "bench_common.h"
+#include "json_minify.h"
+#include "parse_objects.h"
+#include "spotify_utils.h"
+#include "track_snapshot.h"
+
+#define ROUNDS        5
+#define ROUND_SECONDS 0.1
+/* Chunk sizes esp_http_client hands HTTP_EVENT_ON_DATA: anywhere from a
+ * partial TLS record up to its receive buffer. */
+#define CHUNK_MIN     16
+#define CHUNK_MAX     1024
+#define CHUNK_SEED    0x2545F491u
+/* Receive buffers the firmware parses into (spotify_client_priv.h) */
+#define MAX_HTTP_BUFFER 8192
+#define SEARCH_STREAM_VALUE_MAX 512
+/* What player_state.json/ws_player_state.json hold */
+#define PAYLOAD_TRACK_ID    "a3dDVhYRnKTbxTNJFoBinF"
+#define PAYLOAD_TRACK_NAME  "Nights \"Live\""
+#define PAYLOAD_PROGRESS_MS 81234
+#define PAYLOAD_DURATION_MS 230201
+#define PAYLOAD_VOLUME      48
+/* The track shown before a NEW_TRACK op: any other valid id, so the op
+ * goes through the same SAME_TRACK check a real track change does. */
+#define OTHER_TRACK_ID      "0000000000000000000000"
+/* Items in search.json, devices.json, playlists.json */
+#define PAYLOAD_SEARCH_TRACKS 6
+#define PAYLOAD_DEVICES       4
+#define PAYLOAD_PLAYLISTS     24
+
+/* Allocation accounting -----------------------------------------------------*/
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+static struct {
+    unsigned long allocs;
+    unsigned long bytes;
+    long live;
+    long peak;
+} heap;
+
+static void heap_add(void *p)
+{
+    if (p) {
+        heap.allocs++;
+        heap.bytes += malloc_usable_size(p);
+        heap.live += malloc_usable_size(p);
+        if (heap.live > heap.peak) {
+            heap.peak = heap.live;
+        }
+    }
+}
+
+void *malloc(size_t size)
+{
+    void *p = __libc_malloc(size);
+    heap_add(p);
+    return p;
+}
+
+void *calloc(size_t n, size_t size)
+{
+    void *p = __libc_calloc(n, size);
+    heap_add(p);
+    return p;
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    if (ptr) {
+        heap.live -= malloc_usable_size(ptr);
+    }
+    void *p = __libc_realloc(ptr, size);
+    if (p) {
+        heap_add(p);
+    } else if (ptr) {
+        heap.live += malloc_usable_size(ptr); // still owned by the caller
+    }
+    return p;
+}
+
+void free(void *ptr)
+{
+    if (ptr) {
+        heap.live -= malloc_usable_size(ptr);
+    }
+    __libc_free(ptr);
+}
+
+/* Ops -----------------------------------------------------------------------*/
+typedef struct {
+    const char *js;
+    int len;
+    char *work; /* len + 1 bytes the op may modify */
+} fixture_t;
+
+static parse_scratch_t scratch;
+static TrackInfo *track;
+static char http_buf[MAX_HTTP_BUFFER];
+static uint32_t chunk_rng = CHUNK_SEED;
+static volatile long sink;
+/* What the last op produced, for its check */
+static struct {
+    PlayerEvent_t player_event;
+    long count;
+    TrackInfo track;
+    char name[64];
+} last;
+
+static int next_chunk(int left)
+{
+    chunk_rng ^= chunk_rng << 13;
+    chunk_rng ^= chunk_rng >> 17;
+    chunk_rng ^= chunk_rng << 5;
+    int n = CHUNK_MIN + (int)(chunk_rng % (CHUNK_MAX - CHUNK_MIN + 1));
+    return n < left ? n : left;
+}
+
+/* parse_track() plus the consumer's part: dropping the event's snapshot
+ * once done with it, as the UI does with a SAME_TRACK's. */
+static void track_op(const fixture_t *f, int initial_state)
+{
+    SpotifyEvent_t evt = parse_track(f->js, &track, initial_state, &scratch);
+    last.player_event = evt.player_event;
+    if (evt.payload) {
+        last.track = *(const TrackInfo *)evt.payload;
+        snprintf(last.name, sizeof(last.name), "%s", spotify_track_name(evt.payload));
+    }
+    sink += evt.player_event;
+    spotify_track_unref(evt.payload);
+}
+
+/* GET /me/player when the track changed (NEW_TRACK) */
+static void op_track_http_new(const fixture_t *f)
+{
+    strcpy(track->id, OTHER_TRACK_ID);
+    track_op(f, 1);
+}
+
+/* PLAYER_STATE_CHANGED push for another track (NEW_TRACK) */
+static void op_track_ws_new(const fixture_t *f)
+{
+    strcpy(track->id, OTHER_TRACK_ID);
+    track_op(f, 0);
+}
+
+/* PLAYER_STATE_CHANGED push for the current track (SAME_TRACK) */
+static void op_track_ws_same(const fixture_t *f)
+{
+    strcpy(track->id, PAYLOAD_TRACK_ID);
+    track_op(f, 0);
+}
+
+static bool check_track(PlayerEvent_t expected)
+{
+    return last.player_event == expected &&
+           strcmp(last.track.id, PAYLOAD_TRACK_ID) == 0 &&
+           last.track.progress_ms == PAYLOAD_PROGRESS_MS &&
+           last.track.duration_ms == PAYLOAD_DURATION_MS &&
+           last.track.isPlaying &&
+           last.track.device.volume_percent == PAYLOAD_VOLUME &&
+           strcmp(last.name, PAYLOAD_TRACK_NAME) == 0;
+}
+
+static bool check_new_track(const fixture_t *f)
+{
+    (void)f;
+    return check_track(NEW_TRACK);
+}
+
+static bool check_same_track(const fixture_t *f)
+{
+    // a SAME_TRACK that only carried the new progress would still pass
+    // check_track() on a warm track: start from a stale one
+    track->progress_ms = 0;
+    track->isPlaying = false;
+    track->device.volume_percent = -1;
+    op_track_ws_same(f);
+    return check_track(SAME_TRACK);
+}
+
+/* GET /v1/search, streamed (spotify_search_tracks()) */
+static void op_search(const fixture_t *f)
+{
+    char *value_buf = malloc(SEARCH_STREAM_VALUE_MAX);
+    List tracks = {.type = TRACK_LIST};
+    search_results_state_t st = {.tracks = &tracks};
+    json_stream_t stream;
+    json_stream_init(&stream, value_buf, SEARCH_STREAM_VALUE_MAX, search_results_stream_cb, &st);
+    for (int off = 0, n; off < f->len; off += n) {
+        n = next_chunk(f->len - off);
+        json_stream_feed(&stream, f->js + off, n);
+    }
+    json_stream_finish(&stream);
+    parse_search_results_finish(&st);
+    last.count = tracks.count;
+    sink += tracks.count;
+    spotify_free_nodes(&tracks);
+    free(value_buf);
+}
+
+/* GET /me/player/devices, buffered */
+static void op_devices(const fixture_t *f)
+{
+    List devices = {.type = DEVICE_LIST};
+    memcpy(f->work, f->js, f->len + 1);
+    parse_available_devices(f->work, &devices, &scratch);
+    last.count = devices.count;
+    sink += devices.count;
+    spotify_free_nodes(&devices);
+}
+
+/* GET /me/playlists, items cut out of the stream (spotify_user_playlists()) */
+static void op_playlists(const fixture_t *f)
+{
+    static const char *const drop_keys[] = {"images", "owner", "tracks", "description", "external_urls", NULL};
+    List playlists = {.type = PLAYLIST_LIST};
+    playlist_filter_state_t st = {.playlists = &playlists, .scratch = &scratch};
+    json_filter_t filter;
+    json_filter_config_t cfg = {
+        .path = "items[*]",
+        .drop_keys = drop_keys,
+        .buf = http_buf,
+        .buf_size = sizeof(http_buf),
+        .cb = playlist_filter_cb,
+        .arg = &st,
+    };
+    json_filter_init(&filter, &cfg);
+    for (int off = 0, n; off < f->len; off += n) {
+        n = next_chunk(f->len - off);
+        json_filter_feed(&filter, f->js + off, n);
+    }
+    last.count = playlists.count;
+    sink += playlists.count;
+    spotify_free_nodes(&playlists);
+}
+
+/* Buffered body as json_http_event_cb() stores it */
+static void op_minify(const fixture_t *f)
+{
+    json_minify_t m;
+    int out = 0;
+    json_minify_reset(&m);
+    for (int off = 0, n; off < f->len; off += n) {
+        n = next_chunk(f->len - off);
+        out += json_minify(&m, f->work + out, f->len + 1 - out, f->js + off, n);
+    }
+    last.count = out;
+    sink += out;
+}
+
+/* ...and as memcpy_trimmed() used to */
+static void op_legacy_trim(const fixture_t *f)
+{
+    size_t out = 0;
+    for (int off = 0, n; off < f->len; off += n) {
+        n = next_chunk(f->len - off);
+        out += legacy_memcpy_trimmed(f->work + out, f->len + 1 - out, f->js + off, n);
+    }
+    last.count = out;
+    sink += out;
+}
+
+static bool check_search(const fixture_t *f)
+{
+    (void)f;
+    return last.count == PAYLOAD_SEARCH_TRACKS;
+}
+
+static bool check_devices(const fixture_t *f)
+{
+    (void)f;
+    return last.count == PAYLOAD_DEVICES;
+}
+
+static bool check_playlists(const fixture_t *f)
+{
+    (void)f;
+    return last.count == PAYLOAD_PLAYLISTS;
+}
+
+/* Chunked minify must come out the same as minifying the whole body at
+ * once. */
+static bool check_minify(const fixture_t *f)
+{
+    json_minify_t m;
+    char *whole = malloc(f->len + 1);
+    json_minify_reset(&m);
+    int len = json_minify(&m, whole, f->len + 1, f->js, f->len);
+    bool ok = len == last.count && memcmp(whole, f->work, len) == 0;
+    free(whole);
+    return ok;
+}
+
+/* The old loop also eats spaces inside strings and depends on where the
+ * chunks fall, so there's no exact output to compare: only that it
+ * stripped something and stayed within the body. */
+static bool check_legacy_trim(const fixture_t *f)
+{
+    return last.count > 0 && last.count < f->len;
+}
+
+/* `buffered` ops get the payload the way json_http_event_cb() leaves it in
+ * the receive buffer (minified); the rest see it as sent. */
+static const struct {
+    const char *payload;
+    const char *name;
+    void (*fn)(const fixture_t *f);
+    bool (*check)(const fixture_t *f); /* on the result of a run of fn */
+    bool buffered;
+} ops[] = {
+    { "player_state.json", "parse_track http NEW", op_track_http_new, check_new_track, true },
+    { "ws_player_state.json", "parse_track ws NEW", op_track_ws_new, check_new_track, false },
+    { "ws_player_state.json", "parse_track ws SAME", op_track_ws_same, check_same_track, false },
+    { "search.json", "search stream", op_search, check_search, false },
+    { "devices.json", "parse_available_devices", op_devices, check_devices, true },
+    { "playlists.json", "playlists filter", op_playlists, check_playlists, false },
+    { "player_state.json", "json_minify", op_minify, check_minify, false },
+    { "player_state.json", "trim (legacy loop)", op_legacy_trim, check_legacy_trim, false },
+    { "ws_player_state.json", "json_minify", op_minify, check_minify, false },
+    { "ws_player_state.json", "trim (legacy loop)", op_legacy_trim, check_legacy_trim, false },
+};
+
+int main(int argc, char **argv)
+{
+    const char *dir = argc > 1 ? argv[1] : BENCH_PAYLOAD_DIR;
+    parse_scratch_init(&scratch);
+    track = track_snapshot_new(0, 0, NULL);
+
+    printf("%-22s %-24s %10s %9s %10s %10s\n", "payload", "op", "ns/op", "allocs/op", "bytes/op", "peak heap");
+    for (size_t o = 0; o < sizeof(ops) / sizeof(ops[0]); o++) {
+        fixture_t f;
+        char *js = bench_load(dir, ops[o].payload, &f.len);
+        if (!js) {
+            fprintf(stderr, "can't read %s/%s\n", dir, ops[o].payload);
+            return 1;
+        }
+        if (ops[o].buffered) {
+            json_minify_t m;
+            char *body = malloc(f.len + 1);
+            json_minify_reset(&m);
+            f.len = json_minify(&m, body, f.len + 1, js, f.len);
+            body[f.len] = '\0';
+            free(js);
+            js = body;
+        }
+        f.js = js;
+        f.work = malloc(f.len + 1);
+
+        // warm-up (grows the token arena), then the check
+        ops[o].fn(&f);
+        if (!ops[o].check(&f)) {
+            fprintf(stderr, "%s: wrong result for %s\n", ops[o].name, ops[o].payload);
+            return 1;
+        }
+
+        double best_ns = 0;
+        unsigned long allocs = 0, bytes = 0;
+        long peak = 0;
+        for (int round = 0; round < ROUNDS; round++) {
+            long iters = 0;
+            unsigned long allocs0 = heap.allocs, bytes0 = heap.bytes;
+            heap.peak = heap.live;
+            long live0 = heap.live;
+            double start = bench_now(), elapsed;
+            do {
+                ops[o].fn(&f);
+                iters++;
+                elapsed = bench_now() - start;
+            } while (elapsed < ROUND_SECONDS);
+            double ns = elapsed * 1e9 / iters;
+            best_ns = (!round || ns < best_ns) ? ns : best_ns;
+            allocs = (heap.allocs - allocs0) / iters;
+            bytes = (heap.bytes - bytes0) / iters;
+            peak = heap.peak - live0 > peak ? heap.peak - live0 : peak;
+        }
+        printf("%-22s %-24s %10.0f %9lu %10lu %10ld\n", ops[o].payload, ops[o].name, best_ns, allocs, bytes, peak);
+        free(f.work);
+        free(js);
+    }
+    spotify_track_unref(track);
+    parse_scratch_free(&scratch);
+    return 0;
+}
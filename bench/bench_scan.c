@@ -0,0 +1,130 @@
+/*
+ * Host benchmark for the JSON byte-scanning paths (json_scan.h users).
+ *
+ * Runs each step over the payloads in payloads/ (shaped like what the API
+ * and the dealer send; the API pretty-prints, the dealer doesn't) and
+ * prints MB/s of input. Built once per kernel variant - see CMakeLists.txt
+ * and README.md - so "before" is the bench_scan_bytewise column.
+ */
+#include "bench_common.h"
+#include "json_filter.h"
+#include "json_minify.h"
+#include "json_parser.h"
+
+#ifndef BENCH_VARIANT
+#define BENCH_VARIANT "default"
+#endif
+#define CHUNK_SIZE     BENCH_CHUNK_SIZE
+#define MAX_TOKENS     4096
+/* Best of ROUNDS rounds of at least ROUND_SECONDS each: keeps scheduler
+ * noise out of the numbers. */
+#define ROUNDS         5
+#define ROUND_SECONDS  0.1
+
+static const char *const payloads[] = {
+    "player_state.json", "playlists.json", "devices.json", "ws_player_state.json",
+};
+
+static char out_buf[256 * 1024];
+static json_tok_t tokens[MAX_TOKENS];
+static volatile long sink;
+
+static void step_legacy_trim(const char *js, int len)
+{
+    size_t out = 0;
+    for (int off = 0; off < len; off += CHUNK_SIZE) {
+        int n = len - off < CHUNK_SIZE ? len - off : CHUNK_SIZE;
+        out += legacy_memcpy_trimmed(out_buf + out, sizeof(out_buf) - out, js + off, n);
+    }
+    sink += out;
+}
+
+static void step_minify(const char *js, int len)
+{
+    json_minify_t m = {0};
+    int out = 0;
+    for (int off = 0; off < len; off += CHUNK_SIZE) {
+        int n = len - off < CHUNK_SIZE ? len - off : CHUNK_SIZE;
+        out += json_minify(&m, out_buf + out, sizeof(out_buf) - out, js + off, n);
+    }
+    sink += out;
+}
+
+static void step_tokenize(const char *js, int len)
+{
+    jparse_ctx_t jctx;
+    if (json_parse_start_static(&jctx, js, len, tokens, MAX_TOKENS) == OS_SUCCESS) {
+        sink += jctx.num_tokens;
+        json_parse_end_static(&jctx);
+    }
+}
+
+static int count_match(char *json, int len, int index, void *arg)
+{
+    (void)json;
+    (void)index;
+    (void)arg;
+    sink += len;
+    return 0;
+}
+
+static void step_filter(const char *js, int len)
+{
+    static const char *const drop[] = {"images", "owner", "tracks", "description", "external_urls", NULL};
+    json_filter_t f;
+    json_filter_config_t cfg = {
+        .path = "items[*]",
+        .drop_keys = drop,
+        .buf = out_buf,
+        .buf_size = sizeof(out_buf),
+        .cb = count_match,
+    };
+    json_filter_init(&f, &cfg);
+    for (int off = 0; off < len; off += CHUNK_SIZE) {
+        int n = len - off < CHUNK_SIZE ? len - off : CHUNK_SIZE;
+        json_filter_feed(&f, js + off, n);
+    }
+}
+
+static const struct {
+    const char *name;
+    void (*fn)(const char *js, int len);
+} steps[] = {
+    { "trim (legacy loop)", step_legacy_trim },
+    { "json_minify", step_minify },
+    { "jsmn tokenize", step_tokenize },
+    { "json_filter items[*]", step_filter },
+};
+
+int main(int argc, char **argv)
+{
+    const char *dir = argc > 1 ? argv[1] : BENCH_PAYLOAD_DIR;
+    printf("kernels: %s\n%-22s %-22s %10s\n", BENCH_VARIANT, "payload", "step", "MB/s");
+    for (size_t p = 0; p < sizeof(payloads) / sizeof(payloads[0]); p++) {
+        int len;
+        char *js = bench_load(dir, payloads[p], &len);
+        if (!js) {
+            fprintf(stderr, "can't read %s/%s\n", dir, payloads[p]);
+            return 1;
+        }
+        for (size_t s = 0; s < sizeof(steps) / sizeof(steps[0]); s++) {
+            double best = 0;
+            for (int round = 0; round < ROUNDS; round++) {
+                long iters = 0;
+                double start = bench_now(), elapsed;
+                do {
+                    for (int i = 0; i < 64; i++) {
+                        steps[s].fn(js, len);
+                    }
+                    iters += 64;
+                    elapsed = bench_now() - start;
+                } while (elapsed < ROUND_SECONDS);
+                double mbps = (double)len * iters / elapsed / 1e6;
+                best = mbps > best ? mbps : best;
+            }
+            printf("%-22s %-22s %10.1f\n", payloads[p], steps[s].name, best);
+        }
+        free(js);
+    }
+    return 0;
+}
@@ -0,0 +1,13 @@
+#pragma once
+/* Silent: logging would dominate the timings, and malformed-input paths
+ * aren't what's benchmarked. The arguments are still type-checked against
+ * the format (and count as used), as with the real macros. */
+#include <stdio.h>
+#include "esp_err.h"
+
+#define BENCH_LOG(tag, fmt, ...) ((void)(tag), (void)(0 && printf(fmt, ##__VA_ARGS__)))
+#define ESP_LOGE(tag, fmt, ...) BENCH_LOG(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) BENCH_LOG(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) BENCH_LOG(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) BENCH_LOG(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGV(tag, fmt, ...) BENCH_LOG(tag, fmt, ##__VA_ARGS__)
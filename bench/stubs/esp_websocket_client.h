@@ -0,0 +1,6 @@
+#pragma once
+#include "esp_event.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+
+typedef struct esp_websocket_client *esp_websocket_client_handle_t;
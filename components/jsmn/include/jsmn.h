@@ -25,6 +25,9 @@
 #define JSMN_H
 
 #include <stddef.h>
+#ifdef JSMN_COMPACT_TOKENS
+#include <stdint.h>
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -57,15 +60,43 @@ enum jsmnerr {
     /* Invalid character inside JSON string */
     JSMN_ERROR_INVAL = -2,
     /* The string is not a full JSON packet, more bytes expected */
-    JSMN_ERROR_PART = -3
+    JSMN_ERROR_PART = -3,
+    /* Too long, or a container too big, for JSMN_COMPACT_TOKENS */
+    JSMN_ERROR_RANGE = -4
 };
 
+#ifdef JSMN_COMPACT_TOKENS
+/* Limits of the 16-bit token fields */
+#define JSMN_MAX_LEN    0xFFFE /* document length; 0xFFFF marks unset offsets */
+#define JSMN_MAX_TOKENS 0x7FFF /* tokens per document (parent is signed) */
+#define JSMN_MAX_SIZE   0x0FFF /* members/elements per object/array */
+#define JSMN_UNSET      0xFFFF
+#else
+#define JSMN_UNSET      -1
+#endif
+
 /**
  * JSON token description.
  * type     type (object, array, string etc.)
  * start    start position in JSON data string
  * end      end position in JSON data string
+ *
+ * With JSMN_COMPACT_TOKENS the same fields are 16 bits wide (type packed
+ * next to size), 8 bytes per token with parent links instead of 20, for
+ * documents within the JSMN_MAX_* limits; larger ones fail with
+ * JSMN_ERROR_RANGE (or JSMN_ERROR_NOMEM past JSMN_MAX_TOKENS).
  */
+#ifdef JSMN_COMPACT_TOKENS
+typedef struct jsmntok {
+    uint16_t start;
+    uint16_t end;
+    uint16_t size : 12;
+    uint16_t type : 4;   /* jsmntype_t */
+#ifdef JSMN_PARENT_LINKS
+    int16_t parent;
+#endif
+} jsmntok_t;
+#else
 typedef struct jsmntok {
     jsmntype_t type;
     int start;
@@ -75,6 +106,7 @@ typedef struct jsmntok {
     int parent;
 #endif
 } jsmntok_t;
+#endif
 
 /**
  * JSON parser. Contains an array of token blocks available. Also stores
@@ -100,6 +132,20 @@ JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len,
                         jsmntok_t *tokens, const unsigned int num_tokens);
 
 #ifndef JSMN_HEADER
+#include "json_scan.h"
+
+#ifdef JSMN_COMPACT_TOKENS
+#define JSMN_SIZE_INC(t)                          \
+    do {                                          \
+        if ((t)->size == JSMN_MAX_SIZE) {         \
+            return JSMN_ERROR_RANGE;              \
+        }                                         \
+        (t)->size++;                              \
+    } while (0)
+#else
+#define JSMN_SIZE_INC(t) ((t)->size++)
+#endif
+
 /**
  * Allocates a fresh unused token from the token pool.
  */
@@ -110,8 +156,13 @@ static jsmntok_t *jsmn_alloc_token(jsmn_parser *parser, jsmntok_t *tokens,
     if (parser->toknext >= num_tokens) {
         return NULL;
     }
+#ifdef JSMN_COMPACT_TOKENS
+    if (parser->toknext >= JSMN_MAX_TOKENS) {
+        return NULL;
+    }
+#endif
     tok = &tokens[parser->toknext++];
-    tok->start = tok->end = -1;
+    tok->start = tok->end = JSMN_UNSET;
     tok->size = 0;
 #ifdef JSMN_PARENT_LINKS
     tok->parent = -1;
@@ -204,7 +255,12 @@ static int jsmn_parse_string(jsmn_parser *parser, const char *js,
     /* Skip starting quote */
     parser->pos++;
 
-    for (; parser->pos < len && js[parser->pos] != '\0'; parser->pos++) {
+    for (; parser->pos < len; parser->pos++) {
+        /* Jump over plain contents to the next quote, backslash or NUL */
+        parser->pos += json_scan_str(js + parser->pos, len - parser->pos);
+        if (parser->pos >= len || js[parser->pos] == '\0') {
+            break;
+        }
         char c = js[parser->pos];
 
         /* Quote: end of string */
@@ -277,6 +333,12 @@ JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len,
     jsmntok_t *token;
     int count = parser->toknext;
 
+#ifdef JSMN_COMPACT_TOKENS
+    if (len > JSMN_MAX_LEN) {
+        return JSMN_ERROR_RANGE;
+    }
+#endif
+
     for (; parser->pos < len && js[parser->pos] != '\0'; parser->pos++) {
         char c;
         jsmntype_t type;
@@ -301,7 +363,7 @@ JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len,
                     return JSMN_ERROR_INVAL;
                 }
 #endif
-                t->size++;
+                JSMN_SIZE_INC(t);
 #ifdef JSMN_PARENT_LINKS
                 token->parent = parser->toksuper;
 #endif
@@ -322,7 +384,7 @@ JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len,
             }
             token = &tokens[parser->toknext - 1];
             for (;;) {
-                if (token->start != -1 && token->end == -1) {
+                if (token->start != JSMN_UNSET && token->end == JSMN_UNSET) {
                     if (token->type != type) {
                         return JSMN_ERROR_INVAL;
                     }
@@ -341,7 +403,7 @@ JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len,
 #else
             for (i = parser->toknext - 1; i >= 0; i--) {
                 token = &tokens[i];
-                if (token->start != -1 && token->end == -1) {
+                if (token->start != JSMN_UNSET && token->end == JSMN_UNSET) {
                     if (token->type != type) {
                         return JSMN_ERROR_INVAL;
                     }
@@ -356,7 +418,7 @@ JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len,
             }
             for (; i >= 0; i--) {
                 token = &tokens[i];
-                if (token->start != -1 && token->end == -1) {
+                if (token->start != JSMN_UNSET && token->end == JSMN_UNSET) {
                     parser->toksuper = i;
                     break;
                 }
@@ -370,13 +432,15 @@ JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len,
             }
             count++;
             if (parser->toksuper != -1 && tokens != NULL) {
-                tokens[parser->toksuper].size++;
+                JSMN_SIZE_INC(&tokens[parser->toksuper]);
             }
             break;
         case '\t':
         case '\r':
         case '\n':
         case ' ':
+            /* the whole run (pretty-printed indentation) at once */
+            parser->pos += json_scan_ws(js + parser->pos, len - parser->pos) - 1;
             break;
         case ':':
             parser->toksuper = parser->toknext - 1;
@@ -390,7 +454,7 @@ JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len,
 #else
                 for (i = parser->toknext - 1; i >= 0; i--) {
                     if (tokens[i].type == JSMN_ARRAY || tokens[i].type == JSMN_OBJECT) {
-                        if (tokens[i].start != -1 && tokens[i].end == -1) {
+                        if (tokens[i].start != JSMN_UNSET && tokens[i].end == JSMN_UNSET) {
                             parser->toksuper = i;
                             break;
                         }
@@ -433,7 +497,7 @@ JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len,
             }
             count++;
             if (parser->toksuper != -1 && tokens != NULL) {
-                tokens[parser->toksuper].size++;
+                JSMN_SIZE_INC(&tokens[parser->toksuper]);
             }
             break;
 
@@ -448,7 +512,7 @@ JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len,
     if (tokens != NULL) {
         for (i = parser->toknext - 1; i >= 0; i--) {
             /* Unmatched opened object or array */
-            if (tokens[i].start != -1 && tokens[i].end == -1) {
+            if (tokens[i].start != JSMN_UNSET && tokens[i].end == JSMN_UNSET) {
                 return JSMN_ERROR_PART;
             }
         }
@@ -0,0 +1,206 @@
+/*
+ * Byte-class scanning kernels for JSON text.
+ *
+ * Each returns the offset of the first byte in s[0..len) that ends a run
+ * the caller wants to skip or copy in bulk (len if there's none), so loops
+ * that used to classify one byte at a time can jump over string contents
+ * and whitespace a word at a time instead:
+ *
+ *   json_scan_str()   string contents: stops at '"', '\\' or NUL
+ *   json_scan_ws()    whitespace: stops at anything but ' ', \t, \n, \r
+ *   json_scan_plain() outside strings: stops at '"' or whitespace
+ *
+ * After a short byte-wise prefix, words are the native register width
+ * (4 bytes on the ESP32 family), loaded aligned; the classification is
+ * exact per byte, so the first flagged byte is found with a
+ * count-trailing-zeros (little-endian only; other targets use the byte
+ * loop). Host builds with SSE2 compare 16 bytes
+ * at a time first. Defining JSON_SCAN_BYTEWISE forces the plain byte loops
+ * (reference/benchmark baseline), JSON_SCAN_NO_SSE2 the SWAR ones.
+ */
+#ifndef JSON_SCAN_H
+#define JSON_SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__SSE2__) && !defined(JSON_SCAN_NO_SSE2) && !defined(JSON_SCAN_BYTEWISE)
+#include <emmintrin.h>
+#define JSON_SCAN_SSE2
+#endif
+
+#if !defined(JSON_SCAN_BYTEWISE) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define JSON_SCAN_SWAR
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bytes checked one at a time before going wide: most runs in Spotify's
+ * JSON (keys, numbers, country codes, indentation) are shorter than this,
+ * and a byte compare beats setting up word/vector masks for them. */
+#define JSON_SCAN_PREFIX 8
+
+static inline int json_scan_is_ws(unsigned char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+#ifdef JSON_SCAN_SWAR
+typedef uintptr_t __attribute__((may_alias)) json_scan_word_t;
+
+#define JSON_SCAN_ONES  ((uintptr_t)-1 / 0xFF)
+#define JSON_SCAN_LOW7  (JSON_SCAN_ONES * 0x7F)
+#define JSON_SCAN_HIGHS (JSON_SCAN_ONES * 0x80)
+
+/* High bit of every byte of w equal to c, and only those (no borrows
+ * between bytes, unlike the classic (w - 0x01..) & ~w test). */
+static inline uintptr_t json_scan_eq(uintptr_t w, unsigned char c)
+{
+    uintptr_t x = w ^ (JSON_SCAN_ONES * c);
+    return ~(((x & JSON_SCAN_LOW7) + JSON_SCAN_LOW7) | x) & JSON_SCAN_HIGHS;
+}
+
+static inline uintptr_t json_scan_ws_mask(uintptr_t w)
+{
+    return json_scan_eq(w, ' ') | json_scan_eq(w, '\n') | json_scan_eq(w, '\r') | json_scan_eq(w, '\t');
+}
+
+/* Byte index of the lowest flagged byte of a non-zero mask. */
+static inline size_t json_scan_first(uintptr_t mask)
+{
+#if UINTPTR_MAX > 0xFFFFFFFFu
+    return __builtin_ctzll(mask) / 8;
+#else
+    return __builtin_ctz(mask) / 8;
+#endif
+}
+
+/* Byte loop up to the first word boundary; true if it found the end. */
+#define JSON_SCAN_HEAD(s, len, i, stop)                                     \
+    for (; (i) < (len) && ((uintptr_t)((s) + (i)) & (sizeof(uintptr_t) - 1)); (i)++) { \
+        if (stop) {                                                         \
+            return (i);                                                     \
+        }                                                                   \
+    }
+#endif
+
+static inline size_t json_scan_str(const char *s, size_t len)
+{
+    size_t i = 0;
+    for (; i < len && i < JSON_SCAN_PREFIX; i++) {
+        if (s[i] == '"' || s[i] == '\\' || s[i] == '\0') {
+            return i;
+        }
+    }
+#ifdef JSON_SCAN_SSE2
+    const __m128i quote = _mm_set1_epi8('"'), bslash = _mm_set1_epi8('\\'), zero = _mm_setzero_si128();
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        int m = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, bslash)),
+                                               _mm_cmpeq_epi8(v, zero)));
+        if (m) {
+            return i + __builtin_ctz(m);
+        }
+    }
+#endif
+#ifdef JSON_SCAN_SWAR
+    JSON_SCAN_HEAD(s, len, i, s[i] == '"' || s[i] == '\\' || s[i] == '\0')
+    for (; i + sizeof(uintptr_t) <= len; i += sizeof(uintptr_t)) {
+        uintptr_t w = *(const json_scan_word_t *)(s + i);
+        uintptr_t m = json_scan_eq(w, '"') | json_scan_eq(w, '\\') | json_scan_eq(w, 0);
+        if (m) {
+            return i + json_scan_first(m);
+        }
+    }
+#endif
+    for (; i < len; i++) {
+        if (s[i] == '"' || s[i] == '\\' || s[i] == '\0') {
+            break;
+        }
+    }
+    return i;
+}
+
+static inline size_t json_scan_ws(const char *s, size_t len)
+{
+    size_t i = 0;
+    for (; i < len && i < JSON_SCAN_PREFIX; i++) {
+        if (!json_scan_is_ws(s[i])) {
+            return i;
+        }
+    }
+#ifdef JSON_SCAN_SSE2
+    const __m128i sp = _mm_set1_epi8(' '), nl = _mm_set1_epi8('\n'), cr = _mm_set1_epi8('\r'), tab = _mm_set1_epi8('\t');
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, sp), _mm_cmpeq_epi8(v, nl)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, tab)));
+        int m = _mm_movemask_epi8(ws) ^ 0xFFFF;
+        if (m) {
+            return i + __builtin_ctz(m);
+        }
+    }
+#endif
+#ifdef JSON_SCAN_SWAR
+    JSON_SCAN_HEAD(s, len, i, !json_scan_is_ws(s[i]))
+    for (; i + sizeof(uintptr_t) <= len; i += sizeof(uintptr_t)) {
+        uintptr_t m = ~json_scan_ws_mask(*(const json_scan_word_t *)(s + i)) & JSON_SCAN_HIGHS;
+        if (m) {
+            return i + json_scan_first(m);
+        }
+    }
+#endif
+    for (; i < len; i++) {
+        if (!json_scan_is_ws(s[i])) {
+            break;
+        }
+    }
+    return i;
+}
+
+static inline size_t json_scan_plain(const char *s, size_t len)
+{
+    size_t i = 0;
+    for (; i < len && i < JSON_SCAN_PREFIX; i++) {
+        if (s[i] == '"' || json_scan_is_ws(s[i])) {
+            return i;
+        }
+    }
+#ifdef JSON_SCAN_SSE2
+    const __m128i quote = _mm_set1_epi8('"'), sp = _mm_set1_epi8(' '), nl = _mm_set1_epi8('\n'),
+                  cr = _mm_set1_epi8('\r'), tab = _mm_set1_epi8('\t');
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, sp), _mm_cmpeq_epi8(v, nl)),
+                                   _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, tab)));
+        int m = _mm_movemask_epi8(_mm_or_si128(hit, _mm_cmpeq_epi8(v, quote)));
+        if (m) {
+            return i + __builtin_ctz(m);
+        }
+    }
+#endif
+#ifdef JSON_SCAN_SWAR
+    JSON_SCAN_HEAD(s, len, i, s[i] == '"' || json_scan_is_ws(s[i]))
+    for (; i + sizeof(uintptr_t) <= len; i += sizeof(uintptr_t)) {
+        uintptr_t w = *(const json_scan_word_t *)(s + i);
+        uintptr_t m = json_scan_eq(w, '"') | json_scan_ws_mask(w);
+        if (m) {
+            return i + json_scan_first(m);
+        }
+    }
+#endif
+    for (; i < len; i++) {
+        if (s[i] == '"' || json_scan_is_ws(s[i])) {
+            break;
+        }
+    }
+    return i;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* JSON_SCAN_H */
@@ -0,0 +1,94 @@
+/*
+ * Streaming JSON path filter.
+ *
+ * Takes a document in arbitrary chunks (like json_stream.h) and cuts out
+ * every value matching a simple path - "items[*]", "tracks.items[*]",
+ * "devices[*]" - as raw, whitespace-stripped JSON text, handing each one to
+ * a callback as soon as it closes. Everything outside the matches is never
+ * stored, and members named in the drop list (e.g. "images",
+ * "available_markets") are cut out of the matches at the byte level, so
+ * the buffer only has to hold one trimmed element, not the document.
+ *
+ * The input is assumed to be well-formed JSON; it isn't validated beyond
+ * what's needed to track structure.
+ */
+#ifndef _JSON_FILTER_H_
+#define _JSON_FILTER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <json_parser.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define JSON_FILTER_MAX_DEPTH    32
+#define JSON_FILTER_MAX_SEGMENTS 8
+#define JSON_FILTER_MAX_KEY_LEN  32
+
+/* json: the matching value, NUL-terminated, or NULL if it didn't fit the
+ * buffer (len is then 0; the match is skipped). It sits in the caller's
+ * buffer, so the callback may modify it (e.g. decode strings in place). index: 0-based number of
+ * the match within the current document - 0 also means a new document has
+ * started (e.g. a retried request), so anything kept from a previous one
+ * should be discarded. Return 0 to keep going, non-zero to stop. */
+typedef int (*json_filter_cb_t)(char *json, int len, int index, void *arg);
+
+typedef struct {
+    const char *path;              /* must outlive the filter */
+    const char *const *drop_keys;  /* NULL-terminated, or NULL for none; must outlive the filter */
+    char *buf;                     /* holds one match at a time */
+    int buf_size;
+    json_filter_cb_t cb;
+    void *arg;
+} json_filter_config_t;
+
+/* Treat as opaque; only public so it can live on the stack or inside
+ * another struct. */
+typedef struct {
+    json_filter_config_t cfg;
+    struct {
+        const char *key;           /* NULL: "[*]" */
+        uint8_t len;
+    } seg[JSON_FILTER_MAX_SEGMENTS];
+    uint8_t seg_count;
+    int8_t level_match[JSON_FILTER_MAX_DEPTH + 1]; /* path segments matched down to each open container, -1: none */
+    uint32_t obj_mask;
+    uint8_t depth;
+    bool in_string;
+    bool escaped;
+    bool string_is_key;
+    bool expect_key;
+    bool expect_value;
+    bool in_literal;
+    char key[JSON_FILTER_MAX_KEY_LEN];
+    uint8_t key_len;
+    bool has_key;
+    bool capturing;
+    uint8_t capture_depth;
+    bool skipping;
+    uint8_t skip_depth;
+    bool overflow;
+    int out_len;
+    int member_start;
+    int matches;
+    int status;                    /* OS_SUCCESS, -OS_FAIL or JSON_FILTER_STOPPED; sticky */
+} json_filter_t;
+
+/* Returned once the callback asked to stop. Not an error. */
+#define JSON_FILTER_STOPPED 2
+
+/* -OS_FAIL if the path can't be parsed (or has too many segments). */
+int json_filter_init(json_filter_t *f, const json_filter_config_t *cfg);
+/* Starts over with a new document, same configuration. */
+void json_filter_reset(json_filter_t *f);
+/* OS_SUCCESS, -OS_FAIL (nesting too deep; sticky) or JSON_FILTER_STOPPED. */
+int json_filter_feed(json_filter_t *f, const char *data, int len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _JSON_FILTER_H_ */
@@ -0,0 +1,45 @@
+/*
+ * Streaming JSON minifier.
+ *
+ * Copies a document, fed in arbitrary chunks, without the whitespace
+ * between tokens - Spotify pretty-prints its responses, so that's most of
+ * what a receive buffer would otherwise hold. String contents are copied
+ * verbatim (whitespace, escapes and all); runs are found with the
+ * json_scan.h kernels rather than byte by byte.
+ *
+ * A document that comes compact (its first token directly followed by the
+ * next, as the dealer sends them) is copied as is, without being walked:
+ * there's nothing to strip, and walking it costs more than the memcpy.
+ *
+ * The input is assumed to be well-formed JSON; it isn't validated.
+ */
+#ifndef _JSON_MINIFY_H_
+#define _JSON_MINIFY_H_
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Treat as opaque; zeroed (or json_minify_reset()) for a new document. */
+typedef struct {
+    bool in_string;
+    bool escaped;
+    bool overflow;  /* dst filled up; sticky until reset */
+    bool started;   /* the document's first chunk has been seen */
+    bool verbatim;  /* compact document: chunks are copied as they come */
+} json_minify_t;
+
+void json_minify_reset(json_minify_t *m);
+/* Appends the minified form of src[0..len) to dst, writing at most
+ * dst_size bytes (no NUL terminator). Returns the bytes written; once dst
+ * is full the rest of the document is dropped and m->overflow is set. */
+int json_minify(json_minify_t *m, char *dst, int dst_size, const char *src, int len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _JSON_MINIFY_H_ */
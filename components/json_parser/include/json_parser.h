@@ -33,18 +33,74 @@ extern "C"
 typedef jsmn_parser json_parser_t;
 typedef jsmntok_t json_tok_t;
 
+/* Optional lookup acceleration, see json_parse_attach_index(). */
+typedef struct {
+    uint16_t *next;      /* per token: index of the first token after its subtree */
+    uint16_t *slots;     /* open addressing table of key token index + 1, 0: empty */
+    uint32_t *indexed;   /* bitmap of the objects whose keys are in slots[] */
+    uint16_t slot_mask;
+} json_key_index_t;
+
 typedef struct {
     json_parser_t parser;
     const char *js;
     json_tok_t *tokens;
     json_tok_t *cur;
     int num_tokens;
+    json_key_index_t index;
 } jparse_ctx_t;
 
+/* A string value as it appears in the document: not NUL-terminated and
+ * with its escapes (\" \\ \uXXXX...) left undecoded. Points into the
+ * document, so it's only valid as long as that is. */
+typedef struct {
+    const char *str;
+    int len;
+} json_str_t;
+
+/* Reusable token storage for json_parse_start_arena(): grown (with
+ * realloc) to exactly what the largest document so far needed and kept
+ * for the next one, instead of a worst-case array sized up front. */
+typedef struct {
+    json_tok_t *tokens;
+    int capacity;        /* tokens allocated */
+    int max_tokens;      /* documents needing more are rejected */
+    bool with_index;     /* also keep json_parse_attach_index() scratch */
+    uint32_t *index;     /* JSON_KEY_INDEX_WORDS(capacity) words, or NULL */
+} json_tok_arena_t;
+
+/* Objects with fewer members than this are still scanned linearly: with
+ * O(1) skips that is already cheaper than hashing the key. */
+#define JSON_KEY_INDEX_MIN_SIZE  4
+/* uint32_t words of scratch json_parse_attach_index() needs for documents
+ * of up to max_tokens tokens. */
+#define JSON_KEY_INDEX_WORDS(max_tokens) \
+    (((max_tokens) + 31) / 32 + ((max_tokens) + 1) / 2 + (max_tokens))
+
 int json_parse_start(jparse_ctx_t *jctx, const char *js, int len);
 int json_parse_end(jparse_ctx_t *jctx);
 int json_parse_start_static(jparse_ctx_t *jctx, const char *js, int len, json_tok_t *buffer_tokens, int buffer_tokens_max_count);
 int json_parse_end_static(jparse_ctx_t *jctx);
+/* Call right after json_parse_start*() to speed up the lookups that follow:
+ * the end of every subtree is precomputed (skipping a value becomes O(1)
+ * instead of recursive) and every object looked up by key gets its members
+ * hashed on first use, so repeated json_obj_get_*() calls on it are O(1)
+ * probes instead of linear scans. `scratch` must hold
+ * JSON_KEY_INDEX_WORDS(n) words for an n-token document and stay untouched
+ * until json_parse_end*(). -OS_FAIL if it's too small (or the document has
+ * more than 65535 tokens); the lookups then simply stay linear. */
+int json_parse_attach_index(jparse_ctx_t *jctx, uint32_t *scratch, int scratch_words);
+
+/* Nothing is allocated until the first document is parsed. */
+void json_tok_arena_init(json_tok_arena_t *arena, int max_tokens, bool with_index);
+void json_tok_arena_free(json_tok_arena_t *arena);
+/* Like json_parse_start_static(), with the tokens (and, if the arena was
+ * set up with_index, an attached key index) taken from the arena, growing
+ * it first if this document needs more tokens than any before it. The
+ * exact count is jctx->num_tokens afterwards. -OS_FAIL if the document is
+ * invalid, needs more than max_tokens, or the arena can't grow. Finish
+ * with json_parse_end_static(); the arena must not be reused before. */
+int json_parse_start_arena(jparse_ctx_t *jctx, const char *js, int len, json_tok_arena_t *arena);
 
 int json_obj_get_array(jparse_ctx_t *jctx, const char *name, int *num_elem);
 int json_obj_leave_array(jparse_ctx_t *jctx);
@@ -62,6 +118,14 @@ int json_obj_get_object_str(jparse_ctx_t *jctx, const char *name, char *val, int
 int json_obj_get_object_strlen(jparse_ctx_t *jctx, const char *name, int *strlen);
 int json_obj_get_array_str(jparse_ctx_t *jctx, const char *name, char *val, int size);
 int json_obj_get_array_strlen(jparse_ctx_t *jctx, const char *name, int *strlen);
+int json_obj_get_strview(jparse_ctx_t *jctx, const char *name, json_str_t *val);
+/* Decodes the string value's escapes in place, inside the document itself
+ * (which must be writable), NUL-terminates it there and points *str at it:
+ * no copy, no allocation, valid as long as the document is. len is
+ * optional. Calling it again for the same value returns the same string.
+ * The raw text of an enclosing object/array (json_obj_get_object_str()...)
+ * then has that string cut short. */
+int json_obj_get_string_inplace(jparse_ctx_t *jctx, const char *name, char **str, int *len);
 
 int json_arr_get_array(jparse_ctx_t *jctx, uint32_t index);
 int json_arr_leave_array(jparse_ctx_t *jctx);
@@ -70,9 +134,33 @@ int json_arr_leave_object(jparse_ctx_t *jctx);
 int json_arr_get_bool(jparse_ctx_t *jctx, uint32_t index, bool *val);
 int json_arr_get_int(jparse_ctx_t *jctx, uint32_t index, int *val);
 int json_arr_get_int64(jparse_ctx_t *jctx, uint32_t index, int64_t *val);
+/* json_arr_get_object() + json_obj_get_int(name) for every element of the
+ * current array at once (e.g. the "height" of each of an album's
+ * "images"), in a single pass instead of re-walking the array per index.
+ * vals[i] is element i's value, or `missing` if the element isn't an
+ * object or has no integer `name`. Returns how many were written (at most
+ * max_vals), -OS_FAIL if the cursor isn't on an array. */
+int json_arr_get_member_ints(jparse_ctx_t *jctx, const char *name, int *vals, int max_vals, int missing);
 int json_arr_get_float(jparse_ctx_t *jctx, uint32_t index, float *val);
 int json_arr_get_string(jparse_ctx_t *jctx, uint32_t index, char *val, int size);
 int json_arr_get_strlen(jparse_ctx_t *jctx, uint32_t index, int *strlen);
+int json_arr_get_strview(jparse_ctx_t *jctx, uint32_t index, json_str_t *val);
+int json_arr_get_string_inplace(jparse_ctx_t *jctx, uint32_t index, char **str, int *len);
+
+/* Decoder behind json_*_get_int() and json_*_get_int64(): the JSON
+ * integer in str[0..len) exactly (no NUL needed, nothing read past len,
+ * no locale), i.e. an optional '-' and digits without leading zeros.
+ * -OS_FAIL for anything else (fractions, exponents, '+', stray bytes) and
+ * for values out of range instead of wrapping them. */
+int json_str_to_int(const char *str, int len, int *val);
+int json_str_to_int64(const char *str, int len, int64_t *val);
+
+/* json_*_get_string(), json_obj_dup_string() and the _inplace variants
+ * return strings with their escapes decoded (\uXXXX as UTF-8); this is
+ * the decoder they use. Writes the decoded src[0..len) to dst, which may
+ * be src itself since the result is never longer, without a NUL. dst NULL
+ * only counts. Returns the decoded length. */
+int json_unescape(char *dst, const char *src, int len);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,116 @@
+/*
+ * Incremental, push-based (SAX style) JSON parser.
+ *
+ * Where json_parser.h needs the whole document in memory plus one jsmn token
+ * per element, json_stream takes the document in arbitrary chunks (e.g. one
+ * HTTP_EVENT_ON_DATA at a time), keeps its state across chunk boundaries and
+ * reports what it finds through a callback. Memory use is bounded by the
+ * caller's scratch buffer (the longest string/number value it wants to see
+ * in full) and JSON_STREAM_MAX_DEPTH, not by the size of the document.
+ *
+ * Usage:
+ *
+ *     json_stream_t js;
+ *     char buf[256];
+ *     json_stream_init(&js, buf, sizeof(buf), my_cb, my_ctx);
+ *     while (more data)
+ *         json_stream_feed(&js, chunk, chunk_len);
+ *     if (json_stream_finish(&js) != OS_SUCCESS) { ...incomplete or invalid... }
+ */
+#ifndef _JSON_STREAM_H_
+#define _JSON_STREAM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <json_parser.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Deepest nesting of objects/arrays accepted; deeper documents fail. */
+#define JSON_STREAM_MAX_DEPTH   32
+/* Member names longer than this (minus the NUL) are cut short; only meant
+ * for matching against known, short key names. */
+#define JSON_STREAM_MAX_KEY_LEN 32
+/* json_stream_feed()/json_stream_finish() return value once the callback
+ * has asked to stop (by returning non-zero). Not an error. */
+#define JSON_STREAM_STOPPED     2
+
+typedef enum {
+    JSON_STREAM_OBJECT_BEGIN,
+    JSON_STREAM_OBJECT_END,
+    JSON_STREAM_ARRAY_BEGIN,
+    JSON_STREAM_ARRAY_END,
+    JSON_STREAM_KEY,
+    JSON_STREAM_STRING,
+    JSON_STREAM_NUMBER,
+    JSON_STREAM_BOOL,
+    JSON_STREAM_NULL,
+} json_stream_evt_type_t;
+
+typedef struct {
+    json_stream_evt_type_t type;
+    /* Container BEGIN and END events: depth of that container (the root
+     * one is 1). Everything else: depth of the enclosing container (0 for a
+     * bare top-level value). */
+    int depth;
+    /* Member name a value or container BEGIN belongs to, or NULL for array
+     * elements, the root value and all END events. */
+    const char *key;
+    /* KEY/STRING: the unescaped (UTF-8) text. NUMBER/BOOL/NULL: the literal
+     * as it appeared. NUL-terminated; NULL for the container events. Only
+     * valid for the duration of the callback. */
+    const char *value;
+    int value_len;
+    /* STRING only: the value didn't fit the scratch buffer and `value` holds
+     * just its beginning. */
+    bool truncated;
+} json_stream_evt_t;
+
+/* Return 0 to keep going, anything else to stop parsing (every later feed
+ * is then ignored and reports JSON_STREAM_STOPPED). */
+typedef int (*json_stream_cb_t)(const json_stream_evt_t *evt, void *arg);
+
+/* Treat as opaque; only public so it can live on the stack or inside
+ * another struct. */
+typedef struct {
+    json_stream_cb_t cb;
+    void *arg;
+    char *buf;
+    int buf_size;
+    int len;
+    bool truncated;
+    char key[JSON_STREAM_MAX_KEY_LEN];
+    bool has_key;
+    bool in_key;
+    uint32_t obj_mask;     /* bit (d - 1) set: container at depth d is an object */
+    uint8_t depth;
+    uint8_t state;
+    uint8_t hex_left;      /* \uXXXX digits still to read */
+    uint32_t codepoint;
+    uint32_t high_surrogate;
+    int status;            /* OS_SUCCESS, -OS_FAIL or JSON_STREAM_STOPPED; sticky */
+    uint32_t offset;       /* bytes consumed, for error reporting */
+} json_stream_t;
+
+/* buf/buf_size: scratch for string and number values (at least 32 bytes
+ * is sensible); strings longer than buf_size - 1 are reported truncated. */
+void json_stream_init(json_stream_t *js, char *buf, int buf_size, json_stream_cb_t cb, void *arg);
+/* Starts over with a new document, keeping buffer, callback and arg. */
+void json_stream_reset(json_stream_t *js);
+/* Returns OS_SUCCESS, -OS_FAIL on malformed input (sticky: later feeds do
+ * nothing) or JSON_STREAM_STOPPED. With len 0 it only reports that status. */
+int json_stream_feed(json_stream_t *js, const char *data, int len);
+/* Call once the input has ended. OS_SUCCESS only if exactly one complete
+ * top-level value was seen; JSON_STREAM_STOPPED if the callback stopped it. */
+int json_stream_finish(json_stream_t *js);
+/* Byte offset (from the start of the document) where parsing stopped. */
+uint32_t json_stream_offset(const json_stream_t *js);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _JSON_STREAM_H_ */
@@ -0,0 +1,294 @@
+/*
+ * Streaming JSON path filter, see json_filter.h.
+ *
+ * Byte-at-a-time structure tracker: depth, which open containers are
+ * objects, whether we're inside a string, and the last member name seen.
+ * For every container, level_match[] records how many path segments its
+ * position matches; a value whose position matches the whole path starts a
+ * capture, which copies bytes (minus insignificant whitespace and dropped
+ * members) into the caller's buffer until that value closes. String
+ * values and whitespace runs are skipped/copied in bulk (json_scan.h).
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <json_filter.h>
+#include <json_scan.h>
+
+static bool is_ws(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool in_object(const json_filter_t *f)
+{
+    return f->depth && (f->obj_mask & (1u << (f->depth - 1)));
+}
+
+static void out(json_filter_t *f, char c)
+{
+    if (!f->capturing || f->skipping || f->overflow) {
+        return;
+    }
+    if (f->out_len < f->cfg.buf_size - 1) {
+        f->cfg.buf[f->out_len++] = c;
+    } else {
+        f->overflow = true;
+    }
+}
+
+/* out() for a run of string contents. */
+static void out_run(json_filter_t *f, const char *data, int n)
+{
+    if (!f->capturing || f->skipping || f->overflow || !n) {
+        return;
+    }
+    if (n <= f->cfg.buf_size - 1 - f->out_len) {
+        memcpy(f->cfg.buf + f->out_len, data, n);
+        f->out_len += n;
+    } else {
+        f->overflow = true;
+    }
+}
+
+static bool key_is_dropped(const json_filter_t *f)
+{
+    if (!f->cfg.drop_keys) {
+        return false;
+    }
+    for (const char *const *k = f->cfg.drop_keys; *k; k++) {
+        if (strlen(*k) == f->key_len && memcmp(*k, f->key, f->key_len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* A value starts at the current depth (its container's). */
+static void value_start(json_filter_t *f)
+{
+    f->expect_value = false;
+    int m = -1;
+    if (f->depth == 0) {
+        m = 0; /* the root matches the empty path */
+    } else {
+        int k = f->level_match[f->depth];
+        if (k >= 0 && k < f->seg_count) {
+            if (!f->seg[k].key && !in_object(f)) {
+                m = k + 1;
+            } else if (f->seg[k].key && in_object(f) && f->has_key &&
+                       f->seg[k].len == f->key_len && memcmp(f->seg[k].key, f->key, f->key_len) == 0) {
+                m = k + 1;
+            }
+        }
+    }
+    if (m == f->seg_count && !f->capturing) {
+        f->capturing = true;
+        f->capture_depth = f->depth;
+        f->overflow = false;
+        f->out_len = 0;
+    }
+    /* only meaningful if this value turns out to be a container */
+    if (f->depth < JSON_FILTER_MAX_DEPTH) {
+        f->level_match[f->depth + 1] = m;
+    }
+}
+
+/* The value at the current depth has just ended. */
+static void value_end(json_filter_t *f)
+{
+    f->has_key = false;
+    if (f->skipping && f->depth == f->skip_depth) {
+        f->skipping = false;
+    }
+    if (f->capturing && f->depth == f->capture_depth) {
+        f->capturing = false;
+        int index = f->matches++;
+        int ret;
+        if (f->overflow) {
+            ret = f->cfg.cb(NULL, 0, index, f->cfg.arg);
+        } else {
+            f->cfg.buf[f->out_len] = 0;
+            ret = f->cfg.cb(f->cfg.buf, f->out_len, index, f->cfg.arg);
+        }
+        if (ret != 0) {
+            f->status = JSON_FILTER_STOPPED;
+        }
+    }
+}
+
+static void string_byte(json_filter_t *f, char c)
+{
+    out(f, c);
+    if (f->escaped) {
+        f->escaped = false;
+    } else if (c == '\\') {
+        f->escaped = true;
+    } else if (c == '"') {
+        f->in_string = false;
+        if (!f->string_is_key) {
+            value_end(f);
+            return;
+        }
+        f->has_key = true;
+        if (f->capturing && !f->skipping && key_is_dropped(f)) {
+            /* Take back the member (and its leading comma) written so far;
+             * its value is skipped until it ends at this depth. */
+            f->out_len = f->member_start;
+            f->skipping = true;
+            f->skip_depth = f->depth;
+        }
+        return;
+    }
+    if (f->string_is_key) {
+        if (f->key_len < JSON_FILTER_MAX_KEY_LEN) {
+            f->key[f->key_len++] = c;
+        } else {
+            f->key_len = JSON_FILTER_MAX_KEY_LEN; /* too long to match anything */
+        }
+    }
+}
+
+static void structural_byte(json_filter_t *f, char c)
+{
+    if (f->in_literal) {
+        if (!is_ws(c) && c != ',' && c != '}' && c != ']') {
+            out(f, c);
+            return;
+        }
+        f->in_literal = false;
+        value_end(f);
+        if (f->status != OS_SUCCESS) {
+            return;
+        }
+    }
+    if (is_ws(c)) {
+        return;
+    }
+    switch (c) {
+    case '{':
+    case '[':
+        if (f->depth >= JSON_FILTER_MAX_DEPTH) {
+            f->status = -OS_FAIL;
+            return;
+        }
+        value_start(f);
+        out(f, c);
+        f->depth++;
+        if (c == '{') {
+            f->obj_mask |= 1u << (f->depth - 1);
+            f->expect_key = true;
+            f->member_start = f->out_len;
+        } else {
+            f->obj_mask &= ~(1u << (f->depth - 1));
+            f->expect_value = true;
+        }
+        f->has_key = false;
+        break;
+    case '}':
+    case ']':
+        f->expect_value = false;
+        f->expect_key = false;
+        out(f, c);
+        if (f->depth) {
+            f->depth--;
+            value_end(f);
+        }
+        break;
+    case ',':
+        f->member_start = f->out_len;
+        /* A dropped first member leaves "{" right before this comma */
+        if (!f->out_len || f->cfg.buf[f->out_len - 1] != '{') {
+            out(f, c);
+        }
+        if (in_object(f)) {
+            f->expect_key = true;
+        } else {
+            f->expect_value = true;
+        }
+        break;
+    case ':':
+        out(f, c);
+        f->expect_value = true;
+        break;
+    case '"':
+        if (f->expect_key) {
+            f->expect_key = false;
+            f->string_is_key = true;
+            f->key_len = 0;
+        } else {
+            value_start(f);
+            f->string_is_key = false;
+        }
+        f->in_string = true;
+        out(f, c);
+        break;
+    default:
+        value_start(f);
+        f->in_literal = true;
+        out(f, c);
+        break;
+    }
+}
+
+int json_filter_init(json_filter_t *f, const json_filter_config_t *cfg)
+{
+    memset(f, 0, sizeof(*f));
+    f->cfg = *cfg;
+    const char *p = cfg->path;
+    while (*p) {
+        const char *name = p;
+        while (*p && *p != '.' && *p != '[') {
+            p++;
+        }
+        if (p > name) {
+            if (f->seg_count == JSON_FILTER_MAX_SEGMENTS || p - name >= JSON_FILTER_MAX_KEY_LEN) {
+                return -OS_FAIL;
+            }
+            f->seg[f->seg_count].key = name;
+            f->seg[f->seg_count++].len = p - name;
+        }
+        if (*p == '[') {
+            if (strncmp(p, "[*]", 3) != 0 || f->seg_count == JSON_FILTER_MAX_SEGMENTS) {
+                return -OS_FAIL;
+            }
+            f->seg[f->seg_count].key = NULL;
+            f->seg[f->seg_count++].len = 0;
+            p += 3;
+        }
+        if (*p == '.') {
+            p++;
+        }
+    }
+    return OS_SUCCESS;
+}
+
+void json_filter_reset(json_filter_t *f)
+{
+    json_filter_config_t cfg = f->cfg;
+    json_filter_init(f, &cfg);
+}
+
+int json_filter_feed(json_filter_t *f, const char *data, int len)
+{
+    for (int i = 0; i < len && f->status == OS_SUCCESS; i++) {
+        if (f->in_string) {
+            // keys go byte by byte: they're short and get matched
+            if (!f->escaped && !f->string_is_key) {
+                int run = json_scan_str(data + i, len - i);
+                out_run(f, data + i, run);
+                i += run;
+                if (i == len) {
+                    break;
+                }
+            }
+            string_byte(f, data[i]);
+        } else {
+            structural_byte(f, data[i]);
+            if (is_ws(data[i])) {
+                i += json_scan_ws(data + i + 1, len - i - 1);
+            }
+        }
+    }
+    return f->status;
+}
@@ -0,0 +1,81 @@
+/*
+ * Streaming JSON minifier, see json_minify.h.
+ *
+ * Walks the input run by run (json_scan.h): string contents up to the next
+ * quote or backslash, and outside strings up to the next quote or
+ * whitespace. Only the byte ending a run is looked at on its own, and
+ * everything between two whitespace runs goes out in a single memcpy - on
+ * already compact input, that's the whole chunk.
+ *
+ * Whether a document is compact is decided on its first two bytes. A
+ * compact one with whitespace further on keeps it: still valid JSON, only
+ * less of the buffer saved.
+ */
+#include <string.h>
+#include <json_minify.h>
+#include <json_scan.h>
+
+/* Copies n bytes if they fit; false (and overflow) otherwise. */
+static bool flush(json_minify_t *m, char *dst, int dst_size, int *out, const char *src, int n)
+{
+    if (n > dst_size - *out) {
+        m->overflow = true;
+        return false;
+    }
+    memcpy(dst + *out, src, n);
+    *out += n;
+    return true;
+}
+
+void json_minify_reset(json_minify_t *m)
+{
+    memset(m, 0, sizeof(*m));
+}
+
+int json_minify(json_minify_t *m, char *dst, int dst_size, const char *src, int len)
+{
+    int out = 0;
+    int seg = 0; /* src[seg..i) is kept but not copied yet */
+    int i = 0;
+    if (m->overflow) {
+        return 0;
+    }
+    if (!m->started && len > 0) {
+        m->started = true;
+        m->verbatim = len > 1 && (src[0] == '{' || src[0] == '[') && !json_scan_is_ws(src[1]);
+    }
+    if (m->verbatim) {
+        flush(m, dst, dst_size, &out, src, len);
+        return out;
+    }
+    while (i < len) {
+        if (m->escaped) {
+            m->escaped = false;
+            i++;
+        } else if (m->in_string) {
+            i += json_scan_str(src + i, len - i);
+            if (i < len) {
+                m->escaped = src[i] == '\\';
+                m->in_string = src[i] != '"';
+                i++;
+            }
+        } else {
+            i += json_scan_plain(src + i, len - i);
+            if (i == len) {
+                break;
+            }
+            if (src[i] == '"') {
+                m->in_string = true;
+                i++;
+                continue;
+            }
+            if (!flush(m, dst, dst_size, &out, src + seg, i - seg)) {
+                return out;
+            }
+            i += json_scan_ws(src + i, len - i);
+            seg = i;
+        }
+    }
+    flush(m, dst, dst_size, &out, src + seg, i - seg);
+    return out;
+}
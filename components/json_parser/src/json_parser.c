@@ -41,6 +41,63 @@ static json_tok_t *json_skip_elem(json_tok_t *token)
     return cur;
 }
 
+/* Last token of the element starting at token, like json_skip_elem(). */
+static json_tok_t *json_skip_elem_fast(jparse_ctx_t *jctx, json_tok_t *token)
+{
+    if (jctx->index.next) {
+        return &jctx->tokens[jctx->index.next[token - jctx->tokens] - 1];
+    }
+    return json_skip_elem(token);
+}
+
+/* FNV-1a of the key, seeded with the index of the object it belongs to so
+ * all indexed objects can share one table. */
+static uint32_t json_key_hash(int obj, const char *key, int len)
+{
+    uint32_t h = 2166136261u ^ ((uint32_t)obj * 2654435761u);
+    while (len--) {
+        h ^= (uint8_t)*key++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void json_index_object(jparse_ctx_t *jctx, int obj)
+{
+    json_key_index_t *idx = &jctx->index;
+    int key = obj + 1;
+    for (int n = jctx->tokens[obj].size; n--; key = idx->next[key]) {
+        json_tok_t *tok = &jctx->tokens[key];
+        uint32_t slot = json_key_hash(obj, jctx->js + tok->start, tok->end - tok->start) & idx->slot_mask;
+        /* Never full: there are fewer keys than tokens, and at least as
+         * many slots. Duplicate keys keep their order along the probe
+         * sequence, so the first one still wins like in a linear scan. */
+        while (idx->slots[slot]) {
+            slot = (slot + 1) & idx->slot_mask;
+        }
+        idx->slots[slot] = key + 1;
+    }
+    idx->indexed[obj / 32] |= 1u << (obj % 32);
+}
+
+static json_tok_t *json_obj_index_search(jparse_ctx_t *jctx, const char *key)
+{
+    json_key_index_t *idx = &jctx->index;
+    int obj = jctx->cur - jctx->tokens;
+    if (!(idx->indexed[obj / 32] & (1u << (obj % 32)))) {
+        json_index_object(jctx, obj);
+    }
+    uint32_t slot = json_key_hash(obj, key, strlen(key)) & idx->slot_mask;
+    while (idx->slots[slot]) {
+        json_tok_t *tok = &jctx->tokens[idx->slots[slot] - 1];
+        if (tok->parent == obj && token_matches_str(jctx, tok, key)) {
+            return tok;
+        }
+        slot = (slot + 1) & idx->slot_mask;
+    }
+    return NULL;
+}
+
 static int json_tok_to_bool(jparse_ctx_t *jctx, json_tok_t *tok, bool *val)
 {
     if (token_matches_str(jctx, tok, "true") || token_matches_str(jctx, tok, "1")) {
@@ -53,30 +110,63 @@ static int json_tok_to_bool(jparse_ctx_t *jctx, json_tok_t *tok, bool *val)
     return OS_SUCCESS;
 }
 
-static int json_tok_to_int(jparse_ctx_t *jctx, json_tok_t *tok, int *val)
+static inline int json_str_to_i64(const char *str, int len, int64_t *val)
 {
-    const char *tok_start = &jctx->js[tok->start];
-    const char *tok_end = &jctx->js[tok->end];
-    char *endptr;
-    int i = strtoul(tok_start, &endptr, 10);
-    if (endptr == tok_end) {
-        *val = i;
-        return OS_SUCCESS;
+    const char *p = str, *end = str + len;
+    bool neg = len > 0 && *p == '-';
+    p += neg;
+    /* JSON integers only: no '+', no leading zeros, no fraction/exponent */
+    if (p == end || (*p == '0' && end - p > 1)) {
+        return -OS_FAIL;
     }
-    return -OS_FAIL;
+    /* Up to 9 digits can't overflow 32 bits, which is all that Spotify's
+     * heights, volumes and most durations need: 32-bit multiplies are
+     * single instructions on the ESP32, 64-bit ones aren't. */
+    const char *p32 = (end - p > 9) ? p + 9 : end;
+    uint32_t v32 = 0;
+    for (; p < p32; p++) {
+        uint32_t d = (uint32_t)(uint8_t)*p - '0';
+        if (d > 9) {
+            return -OS_FAIL;
+        }
+        v32 = v32 * 10 + d;
+    }
+    uint64_t v = v32;
+    uint64_t limit = neg ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX;
+    for (; p < end; p++) {
+        uint32_t d = (uint32_t)(uint8_t)*p - '0';
+        if (d > 9 || v > (limit - d) / 10) {
+            return -OS_FAIL;
+        }
+        v = v * 10 + d;
+    }
+    *val = neg ? -(int64_t)(v - 1) - 1 : (int64_t)v;
+    return OS_SUCCESS;
 }
 
-static int json_tok_to_int64(jparse_ctx_t *jctx, json_tok_t *tok, int64_t *val)
+int json_str_to_int64(const char *str, int len, int64_t *val)
 {
-    const char *tok_start = &jctx->js[tok->start];
-    const char *tok_end = &jctx->js[tok->end];
-    char *endptr;
-    int64_t i64 = strtoull(tok_start, &endptr, 10);
-    if (endptr == tok_end) {
-        *val = i64;
-        return OS_SUCCESS;
+    return json_str_to_i64(str, len, val);
+}
+
+int json_str_to_int(const char *str, int len, int *val)
+{
+    int64_t v;
+    if (json_str_to_i64(str, len, &v) != OS_SUCCESS || v < INT32_MIN || v > INT32_MAX) {
+        return -OS_FAIL;
     }
-    return -OS_FAIL;
+    *val = (int)v;
+    return OS_SUCCESS;
+}
+
+static int json_tok_to_int(jparse_ctx_t *jctx, json_tok_t *tok, int *val)
+{
+    return json_str_to_int(jctx->js + tok->start, tok->end - tok->start, val);
+}
+
+static int json_tok_to_int64(jparse_ctx_t *jctx, json_tok_t *tok, int64_t *val)
+{
+    return json_str_to_int64(jctx->js + tok->start, tok->end - tok->start, val);
 }
 
 static int json_tok_to_float(jparse_ctx_t *jctx, json_tok_t *tok, float *val)
@@ -102,6 +192,128 @@ static int json_tok_to_string(jparse_ctx_t *jctx, json_tok_t *tok, char *val, in
     return OS_SUCCESS;
 }
 
+static int json_hex4(const char *s)
+{
+    int v = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = s[i];
+        v <<= 4;
+        if (c >= '0' && c <= '9') {
+            v |= c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            v |= c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            v |= c - 'A' + 10;
+        } else {
+            return -1;
+        }
+    }
+    return v;
+}
+
+static int json_put_utf8(char *dst, uint32_t cp)
+{
+    char buf[4];
+    int n;
+    if (cp < 0x80) {
+        buf[0] = cp;
+        n = 1;
+    } else if (cp < 0x800) {
+        buf[0] = 0xC0 | (cp >> 6);
+        buf[1] = 0x80 | (cp & 0x3F);
+        n = 2;
+    } else if (cp < 0x10000) {
+        buf[0] = 0xE0 | (cp >> 12);
+        buf[1] = 0x80 | ((cp >> 6) & 0x3F);
+        buf[2] = 0x80 | (cp & 0x3F);
+        n = 3;
+    } else {
+        buf[0] = 0xF0 | (cp >> 18);
+        buf[1] = 0x80 | ((cp >> 12) & 0x3F);
+        buf[2] = 0x80 | ((cp >> 6) & 0x3F);
+        buf[3] = 0x80 | (cp & 0x3F);
+        n = 4;
+    }
+    if (dst) {
+        memcpy(dst, buf, n);
+    }
+    return n;
+}
+
+int json_unescape(char *dst, const char *src, int len)
+{
+    /* In place, out never passes i: every escape decodes to fewer bytes
+     * than it takes (\uXXXX: 6 -> at most 3, a surrogate pair: 12 -> 4). */
+    int out = 0;
+    for (int i = 0; i < len; i++) {
+        char c = src[i];
+        if (c == '\\' && i + 1 < len) {
+            c = src[++i];
+            switch (c) {
+            case 'b': c = '\b'; break;
+            case 'f': c = '\f'; break;
+            case 'n': c = '\n'; break;
+            case 'r': c = '\r'; break;
+            case 't': c = '\t'; break;
+            case 'u': {
+                int cp = (i + 4 < len) ? json_hex4(src + i + 1) : -1;
+                if (cp < 0) {
+                    break; /* not valid JSON anyway: keep the 'u' */
+                }
+                i += 4;
+                if (cp >= 0xD800 && cp <= 0xDBFF && i + 6 < len && src[i + 1] == '\\' && src[i + 2] == 'u') {
+                    int lo = json_hex4(src + i + 3);
+                    if (lo >= 0xDC00 && lo <= 0xDFFF) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                        i += 6;
+                    }
+                }
+                if (cp >= 0xD800 && cp <= 0xDFFF) {
+                    cp = 0xFFFD; /* unpaired surrogate */
+                }
+                out += json_put_utf8(dst ? dst + out : NULL, cp);
+                continue;
+            }
+            default:
+                break; /* \" \\ \/ stand for themselves */
+            }
+        }
+        if (dst) {
+            dst[out] = c;
+        }
+        out++;
+    }
+    return out;
+}
+
+static int json_tok_to_unescaped(jparse_ctx_t *jctx, json_tok_t *tok, char *val, int size)
+{
+    const char *src = jctx->js + tok->start;
+    int len = tok->end - tok->start;
+    if (len > size - 1 && json_unescape(NULL, src, len) > size - 1) {
+        return -OS_FAIL;
+    }
+    val[json_unescape(val, src, len)] = 0;
+    return OS_SUCCESS;
+}
+
+static int json_tok_to_inplace(jparse_ctx_t *jctx, json_tok_t *tok, char **str, int *len)
+{
+    /* A string token always ends at its closing quote; a NUL there means
+     * it was already decoded by an earlier call. */
+    char *s = (char *)jctx->js + tok->start;
+    if (jctx->js[tok->end] != 0) {
+        int n = json_unescape(s, s, tok->end - tok->start);
+        s[n] = 0;
+        tok->end = tok->start + n;
+    }
+    *str = s;
+    if (len) {
+        *len = tok->end - tok->start;
+    }
+    return OS_SUCCESS;
+}
+
 static json_tok_t *json_obj_search(jparse_ctx_t *jctx, const char *key)
 {
     json_tok_t *tok = jctx->cur;
@@ -112,13 +324,16 @@ static json_tok_t *json_obj_search(jparse_ctx_t *jctx, const char *key)
     if (tok->type != JSMN_OBJECT) {
         return NULL;
     }
+    if (jctx->index.next && size >= JSON_KEY_INDEX_MIN_SIZE) {
+        return json_obj_index_search(jctx, key);
+    }
 
     while (size--) {
         tok++;
         if (token_matches_str(jctx, tok, key)) {
             return tok;
         }
-        tok = json_skip_elem(tok);
+        tok = json_skip_elem_fast(jctx, tok);
     }
     return NULL;
 }
@@ -231,7 +446,7 @@ int json_obj_get_string(jparse_ctx_t *jctx, const char *name, char *val, int siz
     if (!tok) {
         return -OS_FAIL;
     }
-    return json_tok_to_string(jctx, tok, val, size);
+    return json_tok_to_unescaped(jctx, tok, val, size);
 }
 
 int json_obj_dup_string(jparse_ctx_t* jctx, const char* name, char** str)
@@ -245,7 +460,7 @@ int json_obj_dup_string(jparse_ctx_t* jctx, const char* name, char** str)
     if (!*str) {
         return -OS_FAIL;
     }
-    return json_tok_to_string(jctx, tok, *str, size);
+    return json_tok_to_unescaped(jctx, tok, *str, size);
 }
 
 int json_obj_match_string(jparse_ctx_t* jctx, const char* name, const char* str, bool* val)
@@ -305,6 +520,26 @@ int json_obj_get_array_strlen(jparse_ctx_t *jctx, const char *name, int *strlen)
     return OS_SUCCESS;
 }
 
+int json_obj_get_strview(jparse_ctx_t *jctx, const char *name, json_str_t *val)
+{
+    json_tok_t *tok = json_obj_get_val_tok(jctx, name, JSMN_STRING);
+    if (!tok) {
+        return -OS_FAIL;
+    }
+    val->str = jctx->js + tok->start;
+    val->len = tok->end - tok->start;
+    return OS_SUCCESS;
+}
+
+int json_obj_get_string_inplace(jparse_ctx_t *jctx, const char *name, char **str, int *len)
+{
+    json_tok_t *tok = json_obj_get_val_tok(jctx, name, JSMN_STRING);
+    if (!tok) {
+        return -OS_FAIL;
+    }
+    return json_tok_to_inplace(jctx, tok, str, len);
+}
+
 static json_tok_t *json_arr_search(jparse_ctx_t *ctx, uint32_t index)
 {
     json_tok_t *tok = ctx->cur;
@@ -317,7 +552,7 @@ static json_tok_t *json_arr_search(jparse_ctx_t *ctx, uint32_t index)
     /* Increment by 1, so that token points to index 0 */
     tok++;
     while (index--) {
-        tok = json_skip_elem(tok);
+        tok = json_skip_elem_fast(ctx, tok);
         tok++;
     }
     return tok;
@@ -399,6 +634,32 @@ int json_arr_get_int64(jparse_ctx_t *jctx, uint32_t index, int64_t *val)
     return json_tok_to_int64(jctx, tok, val);
 }
 
+int json_arr_get_member_ints(jparse_ctx_t *jctx, const char *name, int *vals, int max_vals, int missing)
+{
+    json_tok_t *arr = jctx->cur;
+    if (arr->type != JSMN_ARRAY) {
+        return -OS_FAIL;
+    }
+    int count = arr->size < max_vals ? arr->size : max_vals;
+    json_tok_t *elem = arr + 1;
+    for (int i = 0; i < count; i++) {
+        vals[i] = missing;
+        if (elem->type == JSMN_OBJECT) {
+            json_tok_t *key = elem + 1;
+            for (int n = elem->size; n--; key = json_skip_elem_fast(jctx, key + 1) + 1) {
+                if (token_matches_str(jctx, key, name)) {
+                    if (key[1].type != JSMN_PRIMITIVE || json_tok_to_int(jctx, key + 1, &vals[i]) != OS_SUCCESS) {
+                        vals[i] = missing;
+                    }
+                    break;
+                }
+            }
+        }
+        elem = json_skip_elem_fast(jctx, elem) + 1;
+    }
+    return count;
+}
+
 int json_arr_get_float(jparse_ctx_t *jctx, uint32_t index, float *val)
 {
     json_tok_t *tok = json_arr_get_val_tok(jctx, index, JSMN_PRIMITIVE);
@@ -414,7 +675,7 @@ int json_arr_get_string(jparse_ctx_t *jctx, uint32_t index, char *val, int size)
     if (!tok) {
         return -OS_FAIL;
     }
-    return json_tok_to_string(jctx, tok, val, size);
+    return json_tok_to_unescaped(jctx, tok, val, size);
 }
 
 int json_arr_get_strlen(jparse_ctx_t *jctx, uint32_t index, int *strlen)
@@ -427,6 +688,26 @@ int json_arr_get_strlen(jparse_ctx_t *jctx, uint32_t index, int *strlen)
     return OS_SUCCESS;
 }
 
+int json_arr_get_strview(jparse_ctx_t *jctx, uint32_t index, json_str_t *val)
+{
+    json_tok_t *tok = json_arr_get_val_tok(jctx, index, JSMN_STRING);
+    if (!tok) {
+        return -OS_FAIL;
+    }
+    val->str = jctx->js + tok->start;
+    val->len = tok->end - tok->start;
+    return OS_SUCCESS;
+}
+
+int json_arr_get_string_inplace(jparse_ctx_t *jctx, uint32_t index, char **str, int *len)
+{
+    json_tok_t *tok = json_arr_get_val_tok(jctx, index, JSMN_STRING);
+    if (!tok) {
+        return -OS_FAIL;
+    }
+    return json_tok_to_inplace(jctx, tok, str, len);
+}
+
 int json_parse_start(jparse_ctx_t *jctx, const char *js, int len)
 {
     memset(jctx, 0, sizeof(jparse_ctx_t));
@@ -464,7 +745,6 @@ int json_parse_end(jparse_ctx_t *jctx)
 int json_parse_start_static(jparse_ctx_t *jctx, const char *js, int len, json_tok_t *buffer_tokens, int buffer_tokens_max_count)
 {
     // Init
-    memset(buffer_tokens, 0, buffer_tokens_max_count * sizeof(json_tok_t));
     memset(jctx, 0, sizeof(jparse_ctx_t));
 
     // Check fit
@@ -473,6 +753,8 @@ int json_parse_start_static(jparse_ctx_t *jctx, const char *js, int len, json_to
     if (num_tokens <= 0 || num_tokens > buffer_tokens_max_count) {
         return -OS_FAIL;
     }
+    // Only what this document uses, not the whole buffer
+    memset(buffer_tokens, 0, num_tokens * sizeof(json_tok_t));
 
     // Set struct
     jctx->num_tokens = num_tokens;
@@ -496,3 +778,97 @@ int json_parse_end_static(jparse_ctx_t *jctx)
     return OS_SUCCESS;
 }
 
+void json_tok_arena_init(json_tok_arena_t *arena, int max_tokens, bool with_index)
+{
+    memset(arena, 0, sizeof(*arena));
+    arena->max_tokens = max_tokens;
+    arena->with_index = with_index;
+}
+
+void json_tok_arena_free(json_tok_arena_t *arena)
+{
+    free(arena->tokens);
+    free(arena->index);
+    json_tok_arena_init(arena, arena->max_tokens, arena->with_index);
+}
+
+static int json_tok_arena_reserve(json_tok_arena_t *arena, int num_tokens)
+{
+    if (num_tokens <= arena->capacity) {
+        return OS_SUCCESS;
+    }
+    json_tok_t *tokens = realloc(arena->tokens, num_tokens * sizeof(json_tok_t));
+    if (!tokens) {
+        return -OS_FAIL;
+    }
+    arena->tokens = tokens;
+    if (arena->with_index) {
+        uint32_t *index = realloc(arena->index, JSON_KEY_INDEX_WORDS(num_tokens) * sizeof(uint32_t));
+        if (!index) {
+            /* tokens grew, index didn't: capacity stays put */
+            return -OS_FAIL;
+        }
+        arena->index = index;
+    }
+    arena->capacity = num_tokens;
+    return OS_SUCCESS;
+}
+
+int json_parse_start_arena(jparse_ctx_t *jctx, const char *js, int len, json_tok_arena_t *arena)
+{
+    memset(jctx, 0, sizeof(jparse_ctx_t));
+    jsmn_init(&jctx->parser);
+    int num_tokens = jsmn_parse(&jctx->parser, js, len, NULL, 0);
+    if (num_tokens <= 0 || num_tokens > arena->max_tokens) {
+        return -OS_FAIL;
+    }
+    if (json_tok_arena_reserve(arena, num_tokens) != OS_SUCCESS) {
+        return -OS_FAIL;
+    }
+    jctx->num_tokens = num_tokens;
+    jctx->tokens = arena->tokens;
+    jctx->js = js;
+    jsmn_init(&jctx->parser);
+    if (jsmn_parse(&jctx->parser, js, len, jctx->tokens, jctx->num_tokens) <= 0) {
+        memset(jctx, 0, sizeof(jparse_ctx_t));
+        return -OS_FAIL;
+    }
+    jctx->cur = jctx->tokens;
+    if (arena->with_index) {
+        json_parse_attach_index(jctx, arena->index, JSON_KEY_INDEX_WORDS(arena->capacity));
+    }
+    return OS_SUCCESS;
+}
+
+int json_parse_attach_index(jparse_ctx_t *jctx, uint32_t *scratch, int scratch_words)
+{
+    int n = jctx->num_tokens;
+    if (!jctx->tokens || n > UINT16_MAX || scratch_words < JSON_KEY_INDEX_WORDS(n)) {
+        return -OS_FAIL;
+    }
+    json_key_index_t *idx = &jctx->index;
+    int slot_count = 1;
+    while (slot_count < n) {
+        slot_count <<= 1;
+    }
+    idx->indexed = scratch;
+    idx->next = (uint16_t *)(scratch + (n + 31) / 32);
+    idx->slots = idx->next + n;
+    idx->slot_mask = slot_count - 1;
+    memset(idx->indexed, 0, ((n + 31) / 32) * sizeof(uint32_t));
+    memset(idx->slots, 0, slot_count * sizeof(uint16_t));
+
+    /* Tokens come in document order, so the subtrees ending right before
+     * token j are those of token j - 1 and of its ancestors below j's
+     * parent. Each token is assigned exactly once: O(n) overall. */
+    for (int i = 0; i < n; i++) {
+        idx->next[i] = n;
+    }
+    for (int j = 1; j < n; j++) {
+        for (int k = j - 1; k >= 0 && k != jctx->tokens[j].parent; k = jctx->tokens[k].parent) {
+            idx->next[k] = j;
+        }
+    }
+    return OS_SUCCESS;
+}
+
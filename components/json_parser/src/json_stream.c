@@ -0,0 +1,414 @@
+/*
+ * Incremental JSON parser, see json_stream.h.
+ *
+ * A single byte-at-a-time state machine: the only things carried across
+ * json_stream_feed() calls are the current state, the partially read
+ * string/number (in the caller's buffer), the pending member name and a
+ * bitmask stack of which open containers are objects.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <json_stream.h>
+
+enum {
+    ST_VALUE,           /* expecting any value (after ':' or ',' in an array, or at the root) */
+    ST_VALUE_OR_END,    /* right after '[' */
+    ST_KEY_OR_END,      /* right after '{' */
+    ST_KEY,             /* after ',' inside an object */
+    ST_COLON,
+    ST_COMMA_OR_END,
+    ST_STRING,
+    ST_ESCAPE,
+    ST_UNICODE,
+    ST_LITERAL,         /* number, true, false or null */
+    ST_DONE,
+};
+
+#define REPLACEMENT_CHAR 0xFFFD
+
+static bool is_ws(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool is_literal_char(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '-' || c == '+' || c == '.' || c == 'E';
+}
+
+static int fail(json_stream_t *js)
+{
+    js->status = -OS_FAIL;
+    return js->status;
+}
+
+static void emit(json_stream_t *js, json_stream_evt_type_t type, const char *value, int value_len)
+{
+    json_stream_evt_t evt = {
+        .type = type,
+        .depth = js->depth,
+        .key = (js->has_key && type != JSON_STREAM_KEY) ? js->key : NULL,
+        .value = value,
+        .value_len = value_len,
+        .truncated = (type == JSON_STREAM_STRING) && js->truncated,
+    };
+    if (js->cb(&evt, js->arg) != 0) {
+        js->status = JSON_STREAM_STOPPED;
+    }
+}
+
+/* A value (scalar or whole container) at the current depth just ended. */
+static void value_done(json_stream_t *js)
+{
+    js->has_key = false;
+    js->state = js->depth ? ST_COMMA_OR_END : ST_DONE;
+}
+
+static bool in_object(const json_stream_t *js)
+{
+    return js->depth && (js->obj_mask & (1u << (js->depth - 1)));
+}
+
+static void append(json_stream_t *js, char c)
+{
+    char *dst = js->in_key ? js->key : js->buf;
+    int size = js->in_key ? JSON_STREAM_MAX_KEY_LEN : js->buf_size;
+    if (js->len < size - 1) {
+        dst[js->len++] = c;
+    } else {
+        js->truncated = true;
+    }
+}
+
+static void append_utf8(json_stream_t *js, uint32_t cp)
+{
+    if (cp < 0x80) {
+        append(js, cp);
+    } else if (cp < 0x800) {
+        append(js, 0xC0 | (cp >> 6));
+        append(js, 0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        append(js, 0xE0 | (cp >> 12));
+        append(js, 0x80 | ((cp >> 6) & 0x3F));
+        append(js, 0x80 | (cp & 0x3F));
+    } else {
+        append(js, 0xF0 | (cp >> 18));
+        append(js, 0x80 | ((cp >> 12) & 0x3F));
+        append(js, 0x80 | ((cp >> 6) & 0x3F));
+        append(js, 0x80 | (cp & 0x3F));
+    }
+}
+
+/* A \uD8xx high surrogate not followed by its \uDCxx half is invalid
+ * UTF-16; it becomes U+FFFD instead of failing the whole document. */
+static void flush_surrogate(json_stream_t *js)
+{
+    if (js->high_surrogate) {
+        js->high_surrogate = 0;
+        append_utf8(js, REPLACEMENT_CHAR);
+    }
+}
+
+static void unicode_escape_done(json_stream_t *js)
+{
+    uint32_t cp = js->codepoint;
+    if (js->high_surrogate) {
+        if (cp >= 0xDC00 && cp <= 0xDFFF) {
+            cp = 0x10000 + ((js->high_surrogate - 0xD800) << 10) + (cp - 0xDC00);
+            js->high_surrogate = 0;
+            append_utf8(js, cp);
+            return;
+        }
+        flush_surrogate(js);
+    }
+    if (cp >= 0xD800 && cp <= 0xDBFF) {
+        js->high_surrogate = cp;
+    } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+        append_utf8(js, REPLACEMENT_CHAR);
+    } else {
+        append_utf8(js, cp);
+    }
+}
+
+static void string_done(json_stream_t *js)
+{
+    flush_surrogate(js);
+    if (js->in_key) {
+        js->key[js->len] = 0;
+        js->has_key = true;
+        emit(js, JSON_STREAM_KEY, js->key, js->len);
+        js->state = ST_COLON;
+    } else {
+        js->buf[js->len] = 0;
+        emit(js, JSON_STREAM_STRING, js->buf, js->len);
+        value_done(js);
+    }
+}
+
+/* -?digits(.digits)?([eE][+-]?digits)? */
+static bool is_number(const char *s)
+{
+    if (*s == '-') {
+        s++;
+    }
+    if (*s < '0' || *s > '9') {
+        return false;
+    }
+    while (*s >= '0' && *s <= '9') {
+        s++;
+    }
+    if (*s == '.') {
+        s++;
+        if (*s < '0' || *s > '9') {
+            return false;
+        }
+        while (*s >= '0' && *s <= '9') {
+            s++;
+        }
+    }
+    if (*s == 'e' || *s == 'E') {
+        s++;
+        if (*s == '+' || *s == '-') {
+            s++;
+        }
+        if (*s < '0' || *s > '9') {
+            return false;
+        }
+        while (*s >= '0' && *s <= '9') {
+            s++;
+        }
+    }
+    return *s == 0;
+}
+
+static int literal_done(json_stream_t *js)
+{
+    if (js->truncated) {
+        return fail(js);
+    }
+    js->buf[js->len] = 0;
+    json_stream_evt_type_t type;
+    if (strcmp(js->buf, "true") == 0 || strcmp(js->buf, "false") == 0) {
+        type = JSON_STREAM_BOOL;
+    } else if (strcmp(js->buf, "null") == 0) {
+        type = JSON_STREAM_NULL;
+    } else if (is_number(js->buf)) {
+        type = JSON_STREAM_NUMBER;
+    } else {
+        return fail(js);
+    }
+    emit(js, type, js->buf, js->len);
+    value_done(js);
+    return js->status;
+}
+
+static void begin_scalar(json_stream_t *js, uint8_t state, bool in_key)
+{
+    js->state = state;
+    js->in_key = in_key;
+    js->len = 0;
+    js->truncated = false;
+}
+
+static int begin_container(json_stream_t *js, bool is_object)
+{
+    if (js->depth >= JSON_STREAM_MAX_DEPTH) {
+        return fail(js);
+    }
+    js->depth++;
+    if (is_object) {
+        js->obj_mask |= 1u << (js->depth - 1);
+    } else {
+        js->obj_mask &= ~(1u << (js->depth - 1));
+    }
+    emit(js, is_object ? JSON_STREAM_OBJECT_BEGIN : JSON_STREAM_ARRAY_BEGIN, NULL, 0);
+    js->has_key = false;
+    js->state = is_object ? ST_KEY_OR_END : ST_VALUE_OR_END;
+    return js->status;
+}
+
+static int end_container(json_stream_t *js, bool is_object)
+{
+    if (!js->depth || in_object(js) != is_object) {
+        return fail(js);
+    }
+    js->has_key = false;
+    emit(js, is_object ? JSON_STREAM_OBJECT_END : JSON_STREAM_ARRAY_END, NULL, 0);
+    js->depth--;
+    value_done(js);
+    return js->status;
+}
+
+/* Any value may start here (state is ST_VALUE or ST_VALUE_OR_END). */
+static int begin_value(json_stream_t *js, char c)
+{
+    if (c == '{') {
+        return begin_container(js, true);
+    } else if (c == '[') {
+        return begin_container(js, false);
+    } else if (c == '"') {
+        begin_scalar(js, ST_STRING, false);
+    } else if (c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n') {
+        begin_scalar(js, ST_LITERAL, false);
+        append(js, c);
+    } else {
+        return fail(js);
+    }
+    return js->status;
+}
+
+/* Handles one byte in every state except the ones inside a string. */
+static int structural(json_stream_t *js, char c)
+{
+    if (is_ws(c)) {
+        return OS_SUCCESS;
+    }
+    switch (js->state) {
+    case ST_VALUE:
+        return begin_value(js, c);
+    case ST_VALUE_OR_END:
+        if (c == ']') {
+            return end_container(js, false);
+        }
+        return begin_value(js, c);
+    case ST_KEY_OR_END:
+        if (c == '}') {
+            return end_container(js, true);
+        }
+        /* fall through */
+    case ST_KEY:
+        if (c != '"') {
+            return fail(js);
+        }
+        begin_scalar(js, ST_STRING, true);
+        return OS_SUCCESS;
+    case ST_COLON:
+        if (c != ':') {
+            return fail(js);
+        }
+        js->state = ST_VALUE;
+        return OS_SUCCESS;
+    case ST_COMMA_OR_END:
+        if (c == ',') {
+            js->state = in_object(js) ? ST_KEY : ST_VALUE;
+            return OS_SUCCESS;
+        } else if (c == '}' || c == ']') {
+            return end_container(js, c == '}');
+        }
+        return fail(js);
+    default: /* ST_DONE: only trailing whitespace allowed */
+        return fail(js);
+    }
+}
+
+static int hex_val(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+void json_stream_init(json_stream_t *js, char *buf, int buf_size, json_stream_cb_t cb, void *arg)
+{
+    memset(js, 0, sizeof(*js));
+    js->buf = buf;
+    js->buf_size = buf_size;
+    js->cb = cb;
+    js->arg = arg;
+}
+
+void json_stream_reset(json_stream_t *js)
+{
+    json_stream_init(js, js->buf, js->buf_size, js->cb, js->arg);
+}
+
+int json_stream_feed(json_stream_t *js, const char *data, int len)
+{
+    const char *end = data + len;
+    const char *p = data;
+    for (; p < end && js->status == OS_SUCCESS; p++) {
+        char c = *p;
+        switch (js->state) {
+        case ST_STRING:
+            if (c == '"') {
+                string_done(js);
+            } else if (c == '\\') {
+                js->state = ST_ESCAPE;
+            } else if ((unsigned char)c < 0x20) {
+                fail(js);
+            } else {
+                flush_surrogate(js);
+                append(js, c);
+            }
+            break;
+        case ST_ESCAPE: {
+            const char *from = "\"\\/bfnrt";
+            const char *to = "\"\\/\b\f\n\r\t";
+            const char *esc = (c != 0) ? strchr(from, c) : NULL;
+            if (c == 'u') {
+                js->hex_left = 4;
+                js->codepoint = 0;
+                js->state = ST_UNICODE;
+            } else if (esc) {
+                flush_surrogate(js);
+                append(js, to[esc - from]);
+                js->state = ST_STRING;
+            } else {
+                fail(js);
+            }
+            break;
+        }
+        case ST_UNICODE: {
+            int v = hex_val(c);
+            if (v < 0) {
+                fail(js);
+                break;
+            }
+            js->codepoint = (js->codepoint << 4) | v;
+            if (--js->hex_left == 0) {
+                unicode_escape_done(js);
+                js->state = ST_STRING;
+            }
+            break;
+        }
+        case ST_LITERAL:
+            if (is_literal_char(c)) {
+                append(js, c);
+                break;
+            }
+            /* The byte that ended the literal still has to be looked at
+             * as structure (',', '}', whitespace...). */
+            if (literal_done(js) == OS_SUCCESS) {
+                structural(js, c);
+            }
+            break;
+        default:
+            structural(js, c);
+            break;
+        }
+    }
+    js->offset += p - data;
+    return js->status;
+}
+
+int json_stream_finish(json_stream_t *js)
+{
+    if (js->status == OS_SUCCESS && js->state == ST_LITERAL && js->depth == 0) {
+        literal_done(js);
+    }
+    if (js->status == OS_SUCCESS && js->state != ST_DONE) {
+        return fail(js);
+    }
+    return js->status;
+}
+
+uint32_t json_stream_offset(const json_stream_t *js)
+{
+    return js->offset;
+}
@@ -0,0 +1,88 @@
+#include <string.h>
+#include "json_filter.h"
+#include "unity.h"
+
+typedef struct {
+    char out[512];
+    int calls;
+    int oversized;
+} match_log_t;
+
+static int log_match(char *json, int len, int index, void *arg)
+{
+    match_log_t *log = arg;
+    if (index == 0) {
+        log->out[0] = 0;
+    }
+    log->calls++;
+    if (!json) {
+        log->oversized++;
+        return 0;
+    }
+    if ((int)strlen(json) != len) {
+        strcat(log->out, "(bad len)");
+    }
+    strcat(log->out, json);
+    strcat(log->out, "|");
+    return 0;
+}
+
+#define json_filter_test_str "{\"href\": \"x\", \"tracks\": {\"items\": [\n" \
+            "  {\"images\": [{\"url\": \"a\"}], \"name\": \"One, {two}\", \"n\": 1},\n" \
+            "  {\"name\": \"esc \\\" [\", \"available_markets\": [\"AR\", \"ES\"]},\n" \
+            "  {\"images\": []}\n" \
+            "], \"items_ignored\": [{\"name\": \"no\"}]}, \"items\": [{\"name\": \"root\"}]}"
+
+TEST_CASE("json_filter cuts out matches for any chunking", "[json_parser]")
+{
+    static const char *const drop[] = {"images", "available_markets", NULL};
+    const char *doc = json_filter_test_str;
+    int doc_len = strlen(doc);
+    for (int chunk = 1; chunk <= doc_len; chunk++) {
+        match_log_t log = {0};
+        char buf[64];
+        json_filter_t f;
+        json_filter_config_t cfg = {
+            .path = "tracks.items[*]",
+            .drop_keys = drop,
+            .buf = buf,
+            .buf_size = sizeof(buf),
+            .cb = log_match,
+            .arg = &log,
+        };
+        TEST_ASSERT_EQUAL(OS_SUCCESS, json_filter_init(&f, &cfg));
+        for (int off = 0; off < doc_len; off += chunk) {
+            int n = (doc_len - off < chunk) ? doc_len - off : chunk;
+            TEST_ASSERT_EQUAL(OS_SUCCESS, json_filter_feed(&f, doc + off, n));
+        }
+        TEST_ASSERT_EQUAL_STRING("{\"name\":\"One, {two}\",\"n\":1}|{\"name\":\"esc \\\" [\"}|{}|", log.out);
+    }
+}
+
+TEST_CASE("json_filter root arrays, overflow and restart", "[json_parser]")
+{
+    match_log_t log = {0};
+    char buf[12];
+    json_filter_t f;
+    json_filter_config_t cfg = {
+        .path = "[*]",
+        .buf = buf,
+        .buf_size = sizeof(buf),
+        .cb = log_match,
+        .arg = &log,
+    };
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_filter_init(&f, &cfg));
+    const char *doc = "[1, \"two\", {\"three\": 3333333}, [4]]";
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_filter_feed(&f, doc, strlen(doc)));
+    TEST_ASSERT_EQUAL(4, log.calls);
+    TEST_ASSERT_EQUAL(1, log.oversized);
+    TEST_ASSERT_EQUAL_STRING("1|\"two\"|[4]|", log.out);
+
+    // a new document starts numbering (and the consumer's list) over
+    json_filter_reset(&f);
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_filter_feed(&f, "[5]", 3));
+    TEST_ASSERT_EQUAL_STRING("5|", log.out);
+
+    cfg.path = "items[x]";
+    TEST_ASSERT_EQUAL(-OS_FAIL, json_filter_init(&f, &cfg));
+}
@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <string.h>
+#include "json_parser.h"
+#include "unity.h"
+
+TEST_CASE("json_str_to_int64 decodes exactly the JSON integer", "[json_parser]")
+{
+    static const struct {
+        const char *str;
+        int64_t val;
+    } ok[] = {
+        {"0", 0},
+        {"-0", 0},
+        {"7", 7},
+        {"-42", -42},
+        {"999999999", 999999999},
+        {"1000000000", 1000000000},
+        {"1718000000000", 1718000000000LL},
+        {"9223372036854775807", INT64_MAX},
+        {"-9223372036854775808", INT64_MIN},
+    };
+    static const char *const bad[] = {
+        "", "-", "+1", "01", "-01", "1.5", "1e3", "12a", " 1", "1 ", "true",
+        "9223372036854775808", "-9223372036854775809", "99999999999999999999",
+    };
+    int64_t v;
+    for (int i = 0; i < sizeof(ok) / sizeof(ok[0]); i++) {
+        TEST_ASSERT_EQUAL(OS_SUCCESS, json_str_to_int64(ok[i].str, strlen(ok[i].str), &v));
+        TEST_ASSERT(v == ok[i].val);
+    }
+    for (int i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        v = 123;
+        TEST_ASSERT_EQUAL(-OS_FAIL, json_str_to_int64(bad[i], strlen(bad[i]), &v));
+        TEST_ASSERT(v == 123);
+    }
+    // bounded by len: the digits after it are never read
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_str_to_int64("12345", 3, &v));
+    TEST_ASSERT(v == 123);
+
+    int i32;
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_str_to_int("-2147483648", 11, &i32));
+    TEST_ASSERT_EQUAL(INT32_MIN, i32);
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_str_to_int("2147483647", 10, &i32));
+    TEST_ASSERT_EQUAL(INT32_MAX, i32);
+    TEST_ASSERT_EQUAL(-OS_FAIL, json_str_to_int("2147483648", 10, &i32));
+    TEST_ASSERT_EQUAL(-OS_FAIL, json_str_to_int("4294967295", 10, &i32));
+
+    // every length on both sides of the 32-bit fast path
+    char buf[24];
+    for (int64_t x = 1; x < INT64_MAX / 10; x = x * 10 + 3) {
+        snprintf(buf, sizeof(buf), "%lld", (long long)-x);
+        TEST_ASSERT_EQUAL(OS_SUCCESS, json_str_to_int64(buf, strlen(buf), &v));
+        TEST_ASSERT(v == -x);
+        TEST_ASSERT_EQUAL(OS_SUCCESS, json_str_to_int64(buf + 1, strlen(buf) - 1, &v));
+        TEST_ASSERT(v == x);
+    }
+}
+
+TEST_CASE("json_parser int getters reject what strtoul let through", "[json_parser]")
+{
+    const char *js = "{\"neg\": -5, \"big\": 4294967296, \"frac\": 2.5, \"ms\": 1718000000000}";
+    jparse_ctx_t jctx;
+    int val;
+    int64_t val64;
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_parse_start(&jctx, js, strlen(js)));
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_obj_get_int(&jctx, "neg", &val));
+    TEST_ASSERT_EQUAL(-5, val);
+    TEST_ASSERT_EQUAL(-OS_FAIL, json_obj_get_int(&jctx, "big", &val));
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_obj_get_int64(&jctx, "big", &val64));
+    TEST_ASSERT(val64 == 4294967296LL);
+    TEST_ASSERT_EQUAL(-OS_FAIL, json_obj_get_int(&jctx, "frac", &val));
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_obj_get_int64(&jctx, "ms", &val64));
+    TEST_ASSERT(val64 == 1718000000000LL);
+    json_parse_end(&jctx);
+}
+
+TEST_CASE("json_arr_get_member_ints matches per-element lookups", "[json_parser]")
+{
+    const char *js = "{\"images\": [{\"height\": 640, \"url\": \"a\"}, {\"url\": \"b\", \"height\": 300},"
+                     " {\"height\": \"64\"}, 7, {\"url\": {\"height\": 1}}, {\"height\": 1.5}, {\"height\": 32}]}";
+    jparse_ctx_t jctx;
+    int num_elem, vals[8];
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_parse_start(&jctx, js, strlen(js)));
+    TEST_ASSERT_EQUAL(-OS_FAIL, json_arr_get_member_ints(&jctx, "height", vals, 8, -1));
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_obj_get_array(&jctx, "images", &num_elem));
+    TEST_ASSERT_EQUAL(7, num_elem);
+
+    TEST_ASSERT_EQUAL(7, json_arr_get_member_ints(&jctx, "height", vals, 8, -1));
+    for (int i = 0; i < num_elem; i++) {
+        int expected = -1;
+        if (json_arr_get_object(&jctx, i) == OS_SUCCESS) {
+            json_obj_get_int(&jctx, "height", &expected);
+            json_arr_leave_object(&jctx);
+        }
+        TEST_ASSERT_EQUAL(expected, vals[i]);
+    }
+    TEST_ASSERT_EQUAL(640, vals[0]);
+    TEST_ASSERT_EQUAL(300, vals[1]);
+    TEST_ASSERT_EQUAL(32, vals[6]);
+
+    // max_vals caps the output, and the cursor stays on the array
+    vals[2] = 0;
+    TEST_ASSERT_EQUAL(2, json_arr_get_member_ints(&jctx, "height", vals, 2, -1));
+    TEST_ASSERT_EQUAL(0, vals[2]);
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_obj_leave_array(&jctx));
+    json_parse_end(&jctx);
+}
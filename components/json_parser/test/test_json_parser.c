@@ -67,4 +67,164 @@ TEST_CASE("json_parser basic tests", "[json_parser]")
     TEST_ASSERT(int64_val == 109174583252);
 
     json_parse_end(&jctx);
-}
\ No newline at end of file
+}
+#define json_index_test_str "{\"a\": 1, \"obj\": {\"x\": [1, [2, {\"a\": 9}], 3], \"y\": 2, \"z\": 3, \"w\": {}}," \
+            " \"dup\": 1, \"dup\": 2, \"list\": [{\"k\": 1}, [], {\"k\": 3}], \"b\": true}"
+
+TEST_CASE("json_parser key index matches linear lookups", "[json_parser]")
+{
+    json_tok_t tokens[64];
+    uint32_t scratch[JSON_KEY_INDEX_WORDS(64)];
+    jparse_ctx_t jctx;
+    int val, num_elem;
+    bool bool_val;
+
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_parse_start_static(&jctx, json_index_test_str, strlen(json_index_test_str),
+                                                          tokens, 64));
+    TEST_ASSERT_EQUAL(-OS_FAIL, json_parse_attach_index(&jctx, scratch, 1));
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_parse_attach_index(&jctx, scratch, JSON_KEY_INDEX_WORDS(64)));
+
+    /* twice: the second round hits the already built index */
+    for (int round = 0; round < 2; round++) {
+        TEST_ASSERT_EQUAL(OS_SUCCESS, json_obj_get_int(&jctx, "a", &val));
+        TEST_ASSERT_EQUAL_INT(1, val);
+        TEST_ASSERT_EQUAL(OS_SUCCESS, json_obj_get_int(&jctx, "dup", &val));
+        TEST_ASSERT_EQUAL_INT(1, val);
+        TEST_ASSERT_EQUAL(OS_SUCCESS, json_obj_get_bool(&jctx, "b", &bool_val));
+        TEST_ASSERT_EQUAL(true, bool_val);
+        TEST_ASSERT_EQUAL(-OS_FAIL, json_obj_get_int(&jctx, "x", &val));
+        TEST_ASSERT_EQUAL(-OS_FAIL, json_obj_get_int(&jctx, "missing", &val));
+
+        TEST_ASSERT_EQUAL(OS_SUCCESS, json_obj_get_object(&jctx, "obj"));
+        TEST_ASSERT_EQUAL(-OS_FAIL, json_obj_get_int(&jctx, "a", &val));
+        TEST_ASSERT_EQUAL(OS_SUCCESS, json_obj_get_int(&jctx, "z", &val));
+        TEST_ASSERT_EQUAL_INT(3, val);
+        TEST_ASSERT_EQUAL(OS_SUCCESS, json_obj_get_array(&jctx, "x", &num_elem));
+        TEST_ASSERT_EQUAL_INT(3, num_elem);
+        TEST_ASSERT_EQUAL(OS_SUCCESS, json_arr_get_int(&jctx, 2, &val));
+        TEST_ASSERT_EQUAL_INT(3, val);
+        TEST_ASSERT_EQUAL(OS_SUCCESS, json_obj_leave_array(&jctx));
+        TEST_ASSERT_EQUAL(OS_SUCCESS, json_obj_leave_object(&jctx));
+
+        TEST_ASSERT_EQUAL(OS_SUCCESS, json_obj_get_array(&jctx, "list", &num_elem));
+        TEST_ASSERT_EQUAL(OS_SUCCESS, json_arr_get_object(&jctx, 2));
+        TEST_ASSERT_EQUAL(OS_SUCCESS, json_obj_get_int(&jctx, "k", &val));
+        TEST_ASSERT_EQUAL_INT(3, val);
+        TEST_ASSERT_EQUAL(OS_SUCCESS, json_arr_leave_object(&jctx));
+        TEST_ASSERT_EQUAL(OS_SUCCESS, json_obj_leave_array(&jctx));
+    }
+    json_parse_end_static(&jctx);
+}
+
+TEST_CASE("json_parser arena grows to the exact token count", "[json_parser]")
+{
+    json_tok_arena_t arena;
+    jparse_ctx_t jctx;
+    int val;
+
+    json_tok_arena_init(&arena, 16, true);
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_parse_start_arena(&jctx, "{\"a\": 1}", 8, &arena));
+    TEST_ASSERT_EQUAL_INT(3, jctx.num_tokens);
+    TEST_ASSERT_EQUAL_INT(3, arena.capacity);
+    json_parse_end_static(&jctx);
+
+    const char *big = "{\"a\": 1, \"b\": 2, \"c\": 3, \"d\": [4, 5]}";
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_parse_start_arena(&jctx, big, strlen(big), &arena));
+    TEST_ASSERT_EQUAL_INT(11, arena.capacity);
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_obj_get_int(&jctx, "c", &val));
+    TEST_ASSERT_EQUAL_INT(3, val);
+    json_parse_end_static(&jctx);
+
+    /* smaller documents reuse what's there */
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_parse_start_arena(&jctx, "[1]", 3, &arena));
+    TEST_ASSERT_EQUAL_INT(11, arena.capacity);
+    json_parse_end_static(&jctx);
+
+    const char *too_big = "[1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16]";
+    TEST_ASSERT_EQUAL(-OS_FAIL, json_parse_start_arena(&jctx, too_big, strlen(too_big), &arena));
+    TEST_ASSERT_EQUAL(-OS_FAIL, json_parse_start_arena(&jctx, "{\"a\" 1}", 7, &arena));
+    TEST_ASSERT_EQUAL_INT(11, arena.capacity);
+
+    json_tok_arena_free(&arena);
+    TEST_ASSERT_EQUAL_INT(0, arena.capacity);
+}
+
+TEST_CASE("json_parser string views, escapes and in-place decoding", "[json_parser]")
+{
+    char doc[] = "{\"s\": \"a\\\"b\\u00e9\\ud83c\\udfb5\\n\", \"list\": [\"x\\/y\"], \"k\": 1}";
+    const char *decoded = "a\"b\xc3\xa9\xf0\x9f\x8e\xb5\n";
+    jparse_ctx_t jctx;
+    json_str_t view;
+    char buf[16], *str;
+    int len;
+
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_parse_start(&jctx, doc, strlen(doc)));
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_obj_get_strview(&jctx, "s", &view));
+    TEST_ASSERT_EQUAL_INT(24, view.len);
+    TEST_ASSERT_EQUAL_STRING_LEN("a\\\"b", view.str, 4);
+
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_obj_get_string(&jctx, "s", buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING(decoded, buf);
+    /* 10 decoded bytes fit in 11 even though the raw text doesn't */
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_obj_get_string(&jctx, "s", buf, 11));
+    TEST_ASSERT_EQUAL(-OS_FAIL, json_obj_get_string(&jctx, "s", buf, 10));
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_obj_dup_string(&jctx, "s", &str));
+    TEST_ASSERT_EQUAL_STRING(decoded, str);
+    free(str);
+
+    for (int round = 0; round < 2; round++) {
+        TEST_ASSERT_EQUAL(OS_SUCCESS, json_obj_get_string_inplace(&jctx, "s", &str, &len));
+        TEST_ASSERT(str >= doc && str < doc + sizeof(doc));
+        TEST_ASSERT_EQUAL_STRING(decoded, str);
+        TEST_ASSERT_EQUAL_INT(10, len);
+    }
+    /* the rest of the document is still usable */
+    int num_elem;
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_obj_get_array(&jctx, "list", &num_elem));
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_arr_get_string_inplace(&jctx, 0, &str, NULL));
+    TEST_ASSERT_EQUAL_STRING("x/y", str);
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_arr_get_strview(&jctx, 0, &view));
+    TEST_ASSERT_EQUAL_INT(3, view.len);
+    json_obj_leave_array(&jctx);
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_obj_get_int(&jctx, "k", &len));
+    TEST_ASSERT_EQUAL_INT(1, len);
+    json_parse_end(&jctx);
+}
+
+#ifdef JSMN_COMPACT_TOKENS
+TEST_CASE("json_parser compact token limits", "[json_parser]")
+{
+    TEST_ASSERT_EQUAL(8, sizeof(json_tok_t));
+
+    /* one element more than a compact token's size field can count */
+    int n = JSMN_MAX_SIZE + 1;
+    char *doc = malloc(2 * n + 2);
+    TEST_ASSERT_NOT_NULL(doc);
+    doc[0] = '[';
+    for (int i = 0; i < n; i++) {
+        doc[1 + 2 * i] = '0';
+        doc[2 + 2 * i] = ',';
+    }
+    doc[2 * n] = ']';
+    doc[2 * n + 1] = 0;
+
+    jparse_ctx_t jctx;
+    int ret = json_parse_start(&jctx, doc, strlen(doc));
+    if (ret == OS_SUCCESS) {
+        json_parse_end(&jctx);
+    }
+    /* one element less fits */
+    doc[2 * n - 2] = ']';
+    doc[2 * n - 1] = 0;
+    int ret_fits = json_parse_start(&jctx, doc, strlen(doc));
+    int num_elem = 0;
+    if (ret_fits == OS_SUCCESS) {
+        num_elem = jctx.tokens[0].size;
+        json_parse_end(&jctx);
+    }
+    free(doc);
+    TEST_ASSERT_EQUAL(-OS_FAIL, ret);
+    TEST_ASSERT_EQUAL(OS_SUCCESS, ret_fits);
+    TEST_ASSERT_EQUAL(JSMN_MAX_SIZE, num_elem);
+}
+#endif
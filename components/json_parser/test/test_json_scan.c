@@ -0,0 +1,143 @@
+#include <stdlib.h>
+#include <string.h>
+#include "json_parser.h"
+#include "json_minify.h"
+#include "json_scan.h"
+#include "unity.h"
+
+static size_t ref_str(const char *s, size_t len)
+{
+    size_t i = 0;
+    while (i < len && s[i] != '"' && s[i] != '\\' && s[i] != '\0') {
+        i++;
+    }
+    return i;
+}
+
+static size_t ref_ws(const char *s, size_t len)
+{
+    size_t i = 0;
+    while (i < len && json_scan_is_ws(s[i])) {
+        i++;
+    }
+    return i;
+}
+
+static size_t ref_plain(const char *s, size_t len)
+{
+    size_t i = 0;
+    while (i < len && s[i] != '"' && !json_scan_is_ws(s[i])) {
+        i++;
+    }
+    return i;
+}
+
+TEST_CASE("json_scan kernels match byte loops at every alignment", "[json_parser]")
+{
+    /* bytes next to the ones looked for (0x21/0x5b/0x1f/0x01...) catch
+     * borrows between lanes; 0x80+ catches sign mixups */
+    static const char alphabet[] = " \t\n\r\"\\\0!#[]{}:,a\x01\x1f\x21\x5b\x5d\xa2\xdc\xff";
+    char buf[96];
+    srand(42);
+    for (int round = 0; round < 2000; round++) {
+        int kind = round % 3;
+        for (int i = 0; i < (int)sizeof(buf); i++) {
+            // mostly the run's own class, so runs get long enough for words
+            int r = rand() % 16;
+            if (r == 0) {
+                buf[i] = alphabet[rand() % (sizeof(alphabet) - 1)];
+            } else if (kind == 1) {
+                buf[i] = " \t\n\r"[r % 4];
+            } else {
+                buf[i] = 'a' + r;
+            }
+        }
+        for (int off = 0; off < 16; off++) {
+            int len = rand() % (int)(sizeof(buf) - off);
+            TEST_ASSERT_EQUAL(ref_str(buf + off, len), json_scan_str(buf + off, len));
+            TEST_ASSERT_EQUAL(ref_ws(buf + off, len), json_scan_ws(buf + off, len));
+            TEST_ASSERT_EQUAL(ref_plain(buf + off, len), json_scan_plain(buf + off, len));
+        }
+    }
+}
+
+#define json_scan_pretty_str "{\n  \"name\" : \"a  b\\\\\",\n\t\"uri\": \"x \\\" y\" ,\r\n" \
+            "  \"list\": [ 1 , true,\n    {  } ,  \"  \" ]\n}\n"
+#define json_scan_min_str "{\"name\":\"a  b\\\\\",\"uri\":\"x \\\" y\",\"list\":[1,true,{},\"  \"]}"
+
+TEST_CASE("json_minify keeps strings intact for any chunking", "[json_parser]")
+{
+    const char *doc = json_scan_pretty_str;
+    int doc_len = strlen(doc);
+    for (int chunk = 1; chunk <= doc_len; chunk++) {
+        char out[128];
+        int out_len = 0;
+        json_minify_t m = {0};
+        for (int off = 0; off < doc_len; off += chunk) {
+            int n = (doc_len - off < chunk) ? doc_len - off : chunk;
+            out_len += json_minify(&m, out + out_len, sizeof(out) - 1 - out_len, doc + off, n);
+        }
+        out[out_len] = 0;
+        TEST_ASSERT_FALSE(m.overflow);
+        TEST_ASSERT_EQUAL_STRING(json_scan_min_str, out);
+    }
+
+    char small[16];
+    json_minify_t m = {0};
+    int n = json_minify(&m, small, sizeof(small), doc, doc_len);
+    TEST_ASSERT_TRUE(m.overflow);
+    TEST_ASSERT_TRUE(n <= (int)sizeof(small));
+    json_minify_reset(&m);
+    TEST_ASSERT_FALSE(m.overflow);
+}
+
+TEST_CASE("json_minify copies a compact document as is", "[json_parser]")
+{
+    // compact from its first two bytes: later whitespace is kept, too
+    const char *doc = "{\"a b\":[1,2], \"c\":\"\\\" \"}";
+    int doc_len = strlen(doc);
+    for (int chunk = 2; chunk <= doc_len; chunk++) {
+        char out[64];
+        int out_len = 0;
+        json_minify_t m = {0};
+        for (int off = 0; off < doc_len; off += chunk) {
+            int n = (doc_len - off < chunk) ? doc_len - off : chunk;
+            out_len += json_minify(&m, out + out_len, sizeof(out) - 1 - out_len, doc + off, n);
+        }
+        out[out_len] = 0;
+        TEST_ASSERT_EQUAL_STRING(doc, out);
+    }
+
+    // still all or nothing once it doesn't fit
+    char small[8];
+    json_minify_t m = {0};
+    TEST_ASSERT_EQUAL(0, json_minify(&m, small, sizeof(small), doc, doc_len));
+    TEST_ASSERT_TRUE(m.overflow);
+    TEST_ASSERT_EQUAL(0, json_minify(&m, small, sizeof(small), "{}", 2));
+}
+
+TEST_CASE("jsmn tokenizes pretty-printed and minified alike", "[json_parser]")
+{
+    const char *docs[] = {json_scan_pretty_str, json_scan_min_str};
+    int values[2][4];
+    for (int d = 0; d < 2; d++) {
+        jparse_ctx_t jctx;
+        json_tok_t tokens[32];
+        TEST_ASSERT_EQUAL(OS_SUCCESS, json_parse_start_static(&jctx, docs[d], strlen(docs[d]), tokens, 32));
+        TEST_ASSERT_EQUAL(11, jctx.num_tokens);
+        json_str_t name, uri;
+        int count;
+        TEST_ASSERT_EQUAL(OS_SUCCESS, json_obj_get_strview(&jctx, "name", &name));
+        TEST_ASSERT_EQUAL(OS_SUCCESS, json_obj_get_strview(&jctx, "uri", &uri));
+        TEST_ASSERT_EQUAL(OS_SUCCESS, json_obj_get_array(&jctx, "list", &count));
+        values[d][0] = name.len;
+        values[d][1] = uri.len;
+        values[d][2] = count;
+        values[d][3] = memcmp(name.str, "a  b\\\\", name.len);
+        json_parse_end_static(&jctx);
+    }
+    TEST_ASSERT_EQUAL_INT_ARRAY(values[1], values[0], 4);
+    TEST_ASSERT_EQUAL(6, values[0][0]);
+    TEST_ASSERT_EQUAL(4, values[0][2]);
+    TEST_ASSERT_EQUAL(0, values[0][3]);
+}
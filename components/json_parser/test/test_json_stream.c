@@ -0,0 +1,74 @@
+#include <string.h>
+#include <stdio.h>
+#include "json_stream.h"
+#include "unity.h"
+
+/* Flattens every event into one line of text, so a whole parse can be
+ * checked with a single string comparison. */
+typedef struct {
+    char out[512];
+    int stop_after;
+    int count;
+} event_log_t;
+
+static int log_event(const json_stream_evt_t *evt, void *arg)
+{
+    static const char *names[] = {"{", "}", "[", "]", "K", "S", "N", "B", "Z"};
+    event_log_t *log = arg;
+    size_t used = strlen(log->out);
+    snprintf(log->out + used, sizeof(log->out) - used, "%s%d%s%s%s%s%s ",
+             names[evt->type], evt->depth,
+             evt->key ? "@" : "", evt->key ? evt->key : "",
+             evt->value ? "=" : "", evt->value ? evt->value : "",
+             evt->truncated ? "~" : "");
+    return ++log->count == log->stop_after;
+}
+
+#define json_stream_test_str "{\"name\": \"a\\\"b\\u00e9\\ud83c\\udfb5\", \"n\": -12.5e3," \
+                             " \"list\": [true, null, {\"x\": []}], \"e\": {}}"
+#define json_stream_test_events "{1 K1=name S1@name=a\"b\xc3\xa9\xf0\x9f\x8e\xb5 K1=n N1@n=-12.5e3 " \
+                                "K1=list [2@list B2=true Z2=null {3 K3=x [4@x ]4 }3 ]2 K1=e {2@e }2 }1 "
+
+TEST_CASE("json_stream emits the same events for any chunking", "[json_parser]")
+{
+    const char *doc = json_stream_test_str;
+    int doc_len = strlen(doc);
+    for (int chunk = 1; chunk <= doc_len; chunk++) {
+        event_log_t log = {0};
+        char buf[64];
+        json_stream_t js;
+        json_stream_init(&js, buf, sizeof(buf), log_event, &log);
+        for (int off = 0; off < doc_len; off += chunk) {
+            int n = (doc_len - off < chunk) ? doc_len - off : chunk;
+            TEST_ASSERT_EQUAL(OS_SUCCESS, json_stream_feed(&js, doc + off, n));
+        }
+        TEST_ASSERT_EQUAL(OS_SUCCESS, json_stream_finish(&js));
+        TEST_ASSERT_EQUAL_STRING(json_stream_test_events, log.out);
+    }
+}
+
+TEST_CASE("json_stream truncation, stop and errors", "[json_parser]")
+{
+    event_log_t log = {0};
+    char buf[4];
+    json_stream_t js;
+
+    json_stream_init(&js, buf, sizeof(buf), log_event, &log);
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_stream_feed(&js, "[\"abcdef\", 7]", 13));
+    TEST_ASSERT_EQUAL(OS_SUCCESS, json_stream_finish(&js));
+    TEST_ASSERT_EQUAL_STRING("[1 S1=abc~ N1=7 ]1 ", log.out);
+
+    memset(&log, 0, sizeof(log));
+    log.stop_after = 2;
+    json_stream_reset(&js);
+    TEST_ASSERT_EQUAL(JSON_STREAM_STOPPED, json_stream_feed(&js, "[1, 2, 3]", 9));
+    TEST_ASSERT_EQUAL(JSON_STREAM_STOPPED, json_stream_finish(&js));
+    TEST_ASSERT_EQUAL_STRING("[1 N1=1 ", log.out);
+
+    const char *bad[] = {"{\"a\" 1}", "[1,]", "{\"a\":1]", "[01x]", "\"\\q\"", "[1] 2", "{\"a\":"};
+    for (int i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        json_stream_reset(&js);
+        json_stream_feed(&js, bad[i], strlen(bad[i]));
+        TEST_ASSERT_EQUAL(-OS_FAIL, json_stream_finish(&js));
+    }
+}
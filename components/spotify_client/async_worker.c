@@ -0,0 +1,331 @@
+/* Includes ------------------------------------------------------------------*/
+#include "async_worker.h"
+#include "esp_log.h"
+#include "spotify_client_priv.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Private function prototypes -----------------------------------------------*/
+static esp_err_t submit(esp_spotify_client_handle_t client, async_op_t op, const char *arg, spotify_async_cb_t cb, void *user_ctx, spotify_request_t *req);
+static void async_task(void *pvParameters);
+static bool take_next(async_worker_t *worker);
+static void run(esp_spotify_client_handle_t client, const async_req_t *req, spotify_async_result_t *result);
+static void free_result(spotify_async_result_t *result);
+
+/* Locally scoped variables --------------------------------------------------*/
+static const char *TAG = "spotify_client";
+
+/* Exported functions --------------------------------------------------------*/
+/* The _async variants queue the blocking call they're named after for the
+ * component's worker task and return at once: ESP_OK and, if req isn't
+ * NULL, the request's id in *req (set before cb can run), or
+ * ESP_ERR_NO_MEM if ASYNC_QUEUE_DEPTH requests are already waiting. cb (may
+ * be NULL) gets what the call returned; string arguments are copied. */
+esp_err_t spotify_user_playlists_async(esp_spotify_client_handle_t client, spotify_async_cb_t cb, void *user_ctx, spotify_request_t *req)
+{
+    return submit(client, ASYNC_USER_PLAYLISTS, NULL, cb, user_ctx, req);
+}
+
+esp_err_t spotify_available_devices_async(esp_spotify_client_handle_t client, spotify_async_cb_t cb, void *user_ctx, spotify_request_t *req)
+{
+    return submit(client, ASYNC_AVAILABLE_DEVICES, NULL, cb, user_ctx, req);
+}
+
+esp_err_t spotify_search_tracks_async(esp_spotify_client_handle_t client, const char *query, spotify_async_cb_t cb, void *user_ctx, spotify_request_t *req)
+{
+    if (!query)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return submit(client, ASYNC_SEARCH_TRACKS, query, cb, user_ctx, req);
+}
+
+esp_err_t spotify_play_context_uri_async(esp_spotify_client_handle_t client, const char *uri, spotify_async_cb_t cb, void *user_ctx, spotify_request_t *req)
+{
+    if (!uri)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return submit(client, ASYNC_PLAY_CONTEXT_URI, uri, cb, user_ctx, req);
+}
+
+esp_err_t spotify_play_track_uri_async(esp_spotify_client_handle_t client, const char *uri, spotify_async_cb_t cb, void *user_ctx, spotify_request_t *req)
+{
+    if (!uri)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return submit(client, ASYNC_PLAY_TRACK_URI, uri, cb, user_ctx, req);
+}
+
+esp_err_t spotify_transfer_playback_async(esp_spotify_client_handle_t client, const char *device_id, spotify_async_cb_t cb, void *user_ctx, spotify_request_t *req)
+{
+    if (!device_id)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return submit(client, ASYNC_TRANSFER_PLAYBACK, device_id, cb, user_ctx, req);
+}
+
+/* Makes sure req's callback won't run. A request still waiting is simply
+ * dropped. One being sent has its connection's timeout cut to
+ * ASYNC_CANCEL_TIMEOUT_MS from here, so perform_http_request() gives up at
+ * its next socket wait instead of reading the rest of the response, drops
+ * the connection, and whatever it got is freed. The wait already under way
+ * (a DNS lookup, a TLS handshake step, the first byte) still runs to its
+ * own end; nothing shorter can be had without closing a socket
+ * esp_http_client is using from another task. ESP_OK if cancelled,
+ * ESP_ERR_NOT_FOUND if it's too late: its callback is running or has
+ * run. */
+esp_err_t spotify_request_cancel(esp_spotify_client_handle_t client, spotify_request_t req)
+{
+    async_worker_t *worker = &client->async;
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    if (!req)
+    {
+        return err;
+    }
+    ACQUIRE_LOCK(worker->lock);
+    for (int i = 0; i < worker->count; i++)
+    {
+        if (worker->pending[(worker->head + i) % ASYNC_QUEUE_DEPTH].id == req)
+        {
+            free(worker->pending[(worker->head + i) % ASYNC_QUEUE_DEPTH].arg);
+            for (; i < worker->count - 1; i++)
+            {
+                worker->pending[(worker->head + i) % ASYNC_QUEUE_DEPTH] = worker->pending[(worker->head + i + 1) % ASYNC_QUEUE_DEPTH];
+            }
+            worker->count--;
+            err = ESP_OK;
+            break;
+        }
+    }
+    if (err != ESP_OK && worker->running.id == req)
+    {
+        atomic_store(&worker->cancel_running, true);
+        if (worker->sending)
+        {
+            // esp_http_client_set_timeout_ms() only stores the value,
+            // read again by each socket wait of the handle
+            esp_http_client_set_timeout_ms(worker->sending, ASYNC_CANCEL_TIMEOUT_MS);
+        }
+        err = ESP_OK;
+    }
+    RELEASE_LOCK(worker->lock);
+    if (err == ESP_OK)
+    {
+        ESP_LOGD(TAG, "Request %" PRIu32 " cancelled", req);
+    }
+    return err;
+}
+
+/* Starts client->async's task, at the same priority as player_task. */
+esp_err_t async_worker_init(esp_spotify_client_handle_t client, UBaseType_t priority)
+{
+    async_worker_t *worker = &client->async;
+    memset(worker, 0, sizeof(*worker));
+    atomic_init(&worker->cancel_running, false);
+    worker->lock = xSemaphoreCreateMutex();
+    if (!worker->lock)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(async_task, "spotify_async", ASYNC_TASK_STACK_SIZE, client, priority, &worker->task) != pdPASS)
+    {
+        worker->task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+/* Pending requests are dropped without their callbacks. */
+void async_worker_deinit(async_worker_t *worker)
+{
+    if (worker->task)
+    {
+        vTaskDelete(worker->task);
+        worker->task = NULL;
+    }
+    for (int i = 0; i < worker->count; i++)
+    {
+        free(worker->pending[(worker->head + i) % ASYNC_QUEUE_DEPTH].arg);
+    }
+    worker->count = 0;
+    free(worker->running.arg);
+    worker->running.arg = NULL;
+    if (worker->lock)
+    {
+        vSemaphoreDelete(worker->lock);
+        worker->lock = NULL;
+    }
+}
+
+/* The cancel flag of the request the calling task is sending, if it's the
+ * worker: other tasks' requests can't be cancelled. */
+const atomic_bool *async_worker_cancel_flag(async_worker_t *worker)
+{
+    return worker->task && xTaskGetCurrentTaskHandle() == worker->task ? &worker->cancel_running : NULL;
+}
+
+/* Called by perform_http_request() on the worker before each attempt at
+ * sending the running request: publishes the connection for
+ * spotify_request_cancel() to cut short. false (and nothing published) if
+ * the request is already cancelled. */
+bool async_worker_begin_send(async_worker_t *worker, esp_http_client_handle_t handle)
+{
+    ACQUIRE_LOCK(worker->lock);
+    bool cancelled = atomic_load(&worker->cancel_running);
+    if (!cancelled)
+    {
+        worker->sending = handle;
+    }
+    RELEASE_LOCK(worker->lock);
+    return !cancelled;
+}
+
+/* ...and after it, giving the connection back its usual timeout. */
+void async_worker_end_send(async_worker_t *worker)
+{
+    ACQUIRE_LOCK(worker->lock);
+    esp_http_client_handle_t handle = worker->sending;
+    worker->sending = NULL;
+    RELEASE_LOCK(worker->lock);
+    if (handle)
+    {
+        esp_http_client_set_timeout_ms(handle, HTTP_TIMEOUT_MS);
+    }
+}
+
+/* Private functions ---------------------------------------------------------*/
+static esp_err_t submit(esp_spotify_client_handle_t client, async_op_t op, const char *arg, spotify_async_cb_t cb, void *user_ctx, spotify_request_t *req)
+{
+    async_worker_t *worker = &client->async;
+    char *copy = NULL;
+    if (arg && !(copy = strdup(arg)))
+    {
+        ESP_LOGE(TAG, "Cannot allocate memory for async request");
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t err = ESP_OK;
+    ACQUIRE_LOCK(worker->lock);
+    if (worker->count < ASYNC_QUEUE_DEPTH)
+    {
+        if (++worker->last_id == 0)
+        {
+            worker->last_id = 1; // 0 is never a request
+        }
+        worker->pending[(worker->head + worker->count) % ASYNC_QUEUE_DEPTH] = (async_req_t){
+            .id = worker->last_id,
+            .op = op,
+            .arg = copy,
+            .cb = cb,
+            .user_ctx = user_ctx,
+        };
+        worker->count++;
+        if (req)
+        {
+            *req = worker->last_id;
+        }
+    }
+    else
+    {
+        err = ESP_ERR_NO_MEM;
+    }
+    RELEASE_LOCK(worker->lock);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Async request queue full, refusing request %d", op);
+        free(copy);
+        return err;
+    }
+    xTaskNotifyGive(worker->task);
+    return ESP_OK;
+}
+
+static void async_task(void *pvParameters)
+{
+    esp_spotify_client_handle_t client = pvParameters;
+    async_worker_t *worker = &client->async;
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (take_next(worker))
+        {
+            spotify_async_result_t result = {0};
+            run(client, &worker->running, &result);
+            // from here on it's too late to cancel
+            ACQUIRE_LOCK(worker->lock);
+            bool cancelled = atomic_load(&worker->cancel_running);
+            async_req_t done = worker->running;
+            worker->running = (async_req_t){0};
+            RELEASE_LOCK(worker->lock);
+            free(done.arg);
+            if (cancelled)
+            {
+                ESP_LOGD(TAG, "Request %" PRIu32 " was cancelled, dropping its result", done.id);
+                free_result(&result);
+            }
+            else if (done.cb)
+            {
+                done.cb(done.id, &result, done.user_ctx);
+            }
+            else
+            {
+                free_result(&result);
+            }
+        }
+    }
+}
+
+/* Moves the oldest pending request to worker->running, if there's one. */
+static bool take_next(async_worker_t *worker)
+{
+    ACQUIRE_LOCK(worker->lock);
+    bool got = worker->count > 0;
+    if (got)
+    {
+        worker->running = worker->pending[worker->head];
+        worker->head = (worker->head + 1) % ASYNC_QUEUE_DEPTH;
+        worker->count--;
+        atomic_store(&worker->cancel_running, false);
+    }
+    RELEASE_LOCK(worker->lock);
+    return got;
+}
+
+static void run(esp_spotify_client_handle_t client, const async_req_t *req, spotify_async_result_t *result)
+{
+    switch (req->op)
+    {
+    case ASYNC_USER_PLAYLISTS:
+        result->list = spotify_user_playlists(client);
+        break;
+    case ASYNC_AVAILABLE_DEVICES:
+        result->list = spotify_available_devices(client);
+        break;
+    case ASYNC_SEARCH_TRACKS:
+        result->list = spotify_search_tracks(client, req->arg);
+        break;
+    case ASYNC_PLAY_CONTEXT_URI:
+        result->err = spotify_play_context_uri(client, req->arg, &result->status_code);
+        return;
+    case ASYNC_PLAY_TRACK_URI:
+        result->err = spotify_play_track_uri(client, req->arg, &result->status_code);
+        return;
+    case ASYNC_TRANSFER_PLAYBACK:
+        result->err = spotify_transfer_playback(client, req->arg, &result->status_code);
+        return;
+    }
+    result->err = result->list ? ESP_OK : ESP_FAIL;
+}
+
+static void free_result(spotify_async_result_t *result)
+{
+    if (result->list)
+    {
+        // spotify_free_nodes() leaves the List itself
+        spotify_free_nodes(result->list);
+        free(result->list);
+        result->list = NULL;
+    }
+}
@@ -0,0 +1,110 @@
+/* Includes ------------------------------------------------------------------*/
+#include "cmd_queue.h"
+#include "esp_log.h"
+#include "spotify_client_priv.h"
+#include <string.h>
+
+/* Private function prototypes -----------------------------------------------*/
+static void remove_at(cmd_queue_t *queue, int i);
+
+/* Locally scoped variables --------------------------------------------------*/
+static const char *TAG = "spotify_client";
+
+/* Exported functions --------------------------------------------------------*/
+esp_err_t cmd_queue_init(cmd_queue_t *queue)
+{
+    memset(queue, 0, sizeof(*queue));
+    queue->lock = xSemaphoreCreateMutex();
+    if (!queue->lock)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void cmd_queue_deinit(cmd_queue_t *queue)
+{
+    if (queue->lock)
+    {
+        vSemaphoreDelete(queue->lock);
+        queue->lock = NULL;
+    }
+    queue->count = 0;
+}
+
+/* Appends cmd, unless it merges with what's pending:
+ * - a PAUSE_UNPAUSE right after another one undoes it, and neither runs;
+ * - a SET_VOLUME or SEEK replaces the pending one, if any, and moves to the
+ *   back: only where the user left the slider matters, and a seek queued
+ *   before a NEXT must not land on the next track.
+ * Anything else keeps its place and its count. ESP_OK if cmd was queued or
+ * merged, ESP_ERR_NO_MEM (and logged) if the queue is full: a tap is never
+ * lost without the caller knowing. */
+esp_err_t cmd_queue_push(cmd_queue_t *queue, int cmd, int arg)
+{
+    esp_err_t err = ESP_OK;
+    ACQUIRE_LOCK(queue->lock);
+    if (cmd == PAUSE_UNPAUSE && queue->count > 0 &&
+        queue->cmds[(queue->head + queue->count - 1) % CMD_QUEUE_DEPTH].cmd == PAUSE_UNPAUSE)
+    {
+        ESP_LOGD(TAG, "Two pending pause/unpause cancel out");
+        queue->count--;
+        RELEASE_LOCK(queue->lock);
+        return ESP_OK;
+    }
+    if (cmd == SET_VOLUME || cmd == SEEK)
+    {
+        for (int i = 0; i < queue->count; i++)
+        {
+            if (queue->cmds[(queue->head + i) % CMD_QUEUE_DEPTH].cmd == cmd)
+            {
+                ESP_LOGD(TAG, "Command %d replaces the pending one", cmd);
+                remove_at(queue, i);
+                break;
+            }
+        }
+    }
+    if (queue->count < CMD_QUEUE_DEPTH)
+    {
+        queued_cmd_t *slot = &queue->cmds[(queue->head + queue->count) % CMD_QUEUE_DEPTH];
+        slot->cmd = cmd;
+        slot->arg = arg;
+        queue->count++;
+    }
+    else
+    {
+        err = ESP_ERR_NO_MEM;
+    }
+    RELEASE_LOCK(queue->lock);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Command queue full, refusing command %d", cmd);
+    }
+    return err;
+}
+
+/* Oldest pending command, if any. Single consumer (player_task). */
+bool cmd_queue_pop(cmd_queue_t *queue, queued_cmd_t *out)
+{
+    ACQUIRE_LOCK(queue->lock);
+    bool got = queue->count > 0;
+    if (got)
+    {
+        *out = queue->cmds[queue->head];
+        queue->head = (queue->head + 1) % CMD_QUEUE_DEPTH;
+        queue->count--;
+    }
+    RELEASE_LOCK(queue->lock);
+    return got;
+}
+
+/* Private functions ---------------------------------------------------------*/
+/* Removes the i-th pending command (0 = oldest), keeping the others' order. */
+static void remove_at(cmd_queue_t *queue, int i)
+{
+    for (; i < queue->count - 1; i++)
+    {
+        queue->cmds[(queue->head + i) % CMD_QUEUE_DEPTH] = queue->cmds[(queue->head + i + 1) % CMD_QUEUE_DEPTH];
+    }
+    queue->count--;
+}
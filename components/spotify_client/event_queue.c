@@ -0,0 +1,170 @@
+/* Includes ------------------------------------------------------------------*/
+#include "event_queue.h"
+#include "esp_log.h"
+#include "freertos/task.h"
+#include "spotify_client_priv.h"
+#include <string.h>
+
+/* Private function prototypes -----------------------------------------------*/
+static bool is_droppable(const SpotifyEvent_t *event);
+static void remove_at(event_queue_t *queue, int i);
+static void release_event(const SpotifyEvent_t *event);
+
+/* Locally scoped variables --------------------------------------------------*/
+static const char *TAG = "spotify_client";
+
+/* Exported functions --------------------------------------------------------*/
+esp_err_t event_queue_init(event_queue_t *queue)
+{
+    memset(queue, 0, sizeof(*queue));
+    queue->lock = xSemaphoreCreateMutex();
+    queue->ready = xSemaphoreCreateBinary();
+    if (!queue->lock || !queue->ready)
+    {
+        event_queue_deinit(queue);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void event_queue_deinit(event_queue_t *queue)
+{
+    for (; queue->count > 0; queue->count--)
+    {
+        release_event(&queue->events[queue->head]);
+        queue->head = (queue->head + 1) % EVENT_QUEUE_DEPTH;
+    }
+    if (queue->lock)
+    {
+        vSemaphoreDelete(queue->lock);
+        queue->lock = NULL;
+    }
+    if (queue->ready)
+    {
+        vSemaphoreDelete(queue->ready);
+        queue->ready = NULL;
+    }
+}
+
+/* Never waits for the consumer. A SAME_TRACK replaces any pending
+ * SAME_TRACK (a snapshot of the same track, older, so it has nothing the
+ * newer one lacks) and moves to the back; a NEW_TRACK likewise replaces
+ * any pending SAME_TRACK and NEW_TRACK, the UI only needs the latest
+ * track. So at most two track events are ever pending, however fast the
+ * track changes. A full queue evicts its oldest SAME_TRACK/UNKNOW to make
+ * room. PLAYER_ERROR and NO_PLAYER_ACTIVE are never evicted; should the
+ * queue be full of them (one per player command at most, see
+ * EVENT_QUEUE_DEPTH) the incoming event is refused and logged. Takes over
+ * the payload reference of the event, which is dropped along with any
+ * event that is. */
+void event_queue_push(event_queue_t *queue, const SpotifyEvent_t *event)
+{
+    ACQUIRE_LOCK(queue->lock);
+    if (event->player_event == SAME_TRACK || event->player_event == NEW_TRACK)
+    {
+        // newest first: remove_at() only moves the ones after i
+        for (int i = queue->count - 1; i >= 0; i--)
+        {
+            PlayerEvent_t pending = queue->events[(queue->head + i) % EVENT_QUEUE_DEPTH].player_event;
+            if (pending == SAME_TRACK || (pending == NEW_TRACK && event->player_event == NEW_TRACK))
+            {
+                release_event(&queue->events[(queue->head + i) % EVENT_QUEUE_DEPTH]);
+                remove_at(queue, i);
+            }
+        }
+    }
+    if (queue->count == EVENT_QUEUE_DEPTH)
+    {
+        for (int i = 0; i < queue->count; i++)
+        {
+            if (is_droppable(&queue->events[(queue->head + i) % EVENT_QUEUE_DEPTH]))
+            {
+                ESP_LOGD(TAG, "Event queue full, dropping pending event %d", queue->events[(queue->head + i) % EVENT_QUEUE_DEPTH].player_event);
+                release_event(&queue->events[(queue->head + i) % EVENT_QUEUE_DEPTH]);
+                remove_at(queue, i);
+                break;
+            }
+        }
+    }
+    bool queued = queue->count < EVENT_QUEUE_DEPTH;
+    if (queued)
+    {
+        queue->events[(queue->head + queue->count) % EVENT_QUEUE_DEPTH] = *event;
+        queue->count++;
+    }
+    RELEASE_LOCK(queue->lock);
+
+    if (queued)
+    {
+        xSemaphoreGive(queue->ready);
+    }
+    else if (is_droppable(event))
+    {
+        ESP_LOGD(TAG, "Event queue full, dropping event %d", event->player_event);
+    }
+    else
+    {
+        ESP_LOGE(TAG, "Event queue full, dropping event %d", event->player_event);
+    }
+    if (!queued)
+    {
+        release_event(event);
+    }
+}
+
+/* Oldest pending event, waiting up to ticks_to_wait for one; same contract
+ * as the xQueueReceive() it replaced. Single consumer. */
+BaseType_t event_queue_receive(event_queue_t *queue, SpotifyEvent_t *event, TickType_t ticks_to_wait)
+{
+    TimeOut_t timeout;
+    vTaskSetTimeOutState(&timeout);
+    while (1)
+    {
+        ACQUIRE_LOCK(queue->lock);
+        bool got = queue->count > 0;
+        if (got)
+        {
+            *event = queue->events[queue->head];
+            queue->head = (queue->head + 1) % EVENT_QUEUE_DEPTH;
+            queue->count--;
+        }
+        RELEASE_LOCK(queue->lock);
+        if (got)
+        {
+            return pdPASS;
+        }
+        // `ready` may still be given for events already read: loop, on
+        // whatever is left of the wait
+        if (xSemaphoreTake(queue->ready, ticks_to_wait) != pdTRUE)
+        {
+            return pdFAIL;
+        }
+        xTaskCheckForTimeOut(&timeout, &ticks_to_wait);
+    }
+}
+
+/* Private functions ---------------------------------------------------------*/
+/* Events that only refresh state the next one carries as well. */
+static bool is_droppable(const SpotifyEvent_t *event)
+{
+    return event->player_event == SAME_TRACK || event->player_event == UNKNOW;
+}
+
+/* Drops the TrackInfo reference a SAME_TRACK/NEW_TRACK event carries. */
+static void release_event(const SpotifyEvent_t *event)
+{
+    if (event->player_event == SAME_TRACK || event->player_event == NEW_TRACK)
+    {
+        spotify_track_unref(event->payload);
+    }
+}
+
+/* Removes the i-th pending event (0 = oldest), keeping the others' order. */
+static void remove_at(event_queue_t *queue, int i)
+{
+    for (; i < queue->count - 1; i++)
+    {
+        queue->events[(queue->head + i) % EVENT_QUEUE_DEPTH] = queue->events[(queue->head + i + 1) % EVENT_QUEUE_DEPTH];
+    }
+    queue->count--;
+}
@@ -14,6 +14,46 @@
 /* Locally scoped variables --------------------------------------------------*/
 static const char* TAG = "SPOTIFY_CLIENT_EXAMPLE";
 
+/* Private functions ---------------------------------------------------------*/
+/* Heap and TLS handshake cost so far. Run the example once with
+ * CONFIG_SPOTIFY_GLOBAL_CA_STORE enabled and once without to compare
+ * per-connection certificate parsing against the shared CA store. */
+static void log_connection_cost(esp_spotify_client_handle_t client, const char* label, uint32_t heap_start)
+{
+    ESP_LOGI(TAG, "[%s] Free heap: %" PRIu32 " bytes (%" PRIi32 " used since startup), min ever: %" PRIu32,
+             label, esp_get_free_heap_size(), (int32_t)(heap_start - esp_get_free_heap_size()), esp_get_minimum_free_heap_size());
+    spotify_http_stats_t stats;
+    if (spotify_client_get_http_stats(client, SPOTIFY_HTTP_HOST_API, &stats) == ESP_OK) {
+        const spotify_handshake_stats_t* hs = &stats.handshakes;
+        ESP_LOGI(TAG, "[%s] API handshakes: %" PRIu32 " full (avg %" PRIu32 " ms), %" PRIu32 " offered a session (avg %" PRIu32 " ms)",
+                 label, hs->full, hs->full ? hs->full_ms_total / hs->full : 0,
+                 hs->offered, hs->offered ? hs->offered_ms_total / hs->offered : 0);
+    }
+    spotify_parse_stats_t parse_stats;
+    if (spotify_client_get_parse_stats(client, &parse_stats) == ESP_OK) {
+        ESP_LOGI(TAG, "[%s] JSON tokens allocated: %" PRIu32 " (peak per kind: token %u, playlist %u, devices %u, conn id %u, state %u)",
+                 label, parse_stats.arena_tokens,
+                 parse_stats.peak_tokens[SPOTIFY_PARSE_ACCESS_TOKEN], parse_stats.peak_tokens[SPOTIFY_PARSE_PLAYLIST],
+                 parse_stats.peak_tokens[SPOTIFY_PARSE_DEVICES], parse_stats.peak_tokens[SPOTIFY_PARSE_CONNECTION_ID],
+                 parse_stats.peak_tokens[SPOTIFY_PARSE_PLAYER_STATE]);
+    }
+    spotify_ws_queue_stats_t ws_stats;
+    if (spotify_client_get_ws_queue_stats(client, &ws_stats) == ESP_OK) {
+        ESP_LOGI(TAG, "[%s] WebSocket queue: %" PRIu32 " queued, high water %" PRIu32 ", dropped %" PRIu32 " same-track / %" PRIu32 " other / %" PRIu32 " oversized",
+                 label, ws_stats.queued, ws_stats.high_water, ws_stats.dropped_same_track, ws_stats.dropped_other,
+                 ws_stats.dropped_oversized);
+    }
+    static const char* const class_names[SPOTIFY_REQ_CLASS_MAX] = {"transport", "state", "volume/seek", "browse", "image"};
+    for (int c = 0; c < SPOTIFY_REQ_CLASS_MAX; c++) {
+        spotify_sched_stats_t sched;
+        if (spotify_client_get_sched_stats(client, c, &sched) == ESP_OK && sched.requests) {
+            ESP_LOGI(TAG, "[%s] %s requests: %" PRIu32 " (%" PRIu32 " queued, %" PRIu32 " ahead of less urgent ones), wait avg %" PRIu32 " ms / max %" PRIu32 " ms, held max %" PRIu32 " ms",
+                     label, class_names[c], sched.requests, sched.queued, sched.bypassed,
+                     sched.wait_ms_total / sched.requests, sched.wait_ms_max, sched.hold_ms_max);
+        }
+    }
+}
+
 void app_main(void)
 {
     ESP_LOGI(TAG, "[APP] Startup..");
@@ -34,12 +74,14 @@ void app_main(void)
     ESP_ERROR_CHECK(example_connect());
 
     // Initialize the Spotify client
+    uint32_t heap_start = esp_get_free_heap_size();
     esp_spotify_client_handle_t client = spotify_client_init(5);
     if (!client)
     {
         ESP_LOGE(TAG, "Error initializing Spotify client");
         return;
     }
+    log_connection_cost(client, "init", heap_start);
 
     // obtain the user playlists
     List* playlists = spotify_user_playlists(client);
@@ -74,45 +116,43 @@ void app_main(void)
         ESP_LOGW(TAG, "No available devices found");
     }
     assert(available_devices->count == 0);
+    log_connection_cost(client, "requests", heap_start);
 
     // enable the player and wait for events
     player_dispatch_event(client, ENABLE_PLAYER_EVENT);
-    SpotifyEvent_t spotify_evt;
-    TrackInfo      track = { .artists.type = STRING_LIST };
-    assert(track.name = calloc(1, 1));
+    SpotifyEvent_t   spotify_evt;
+    const TrackInfo* track = NULL; // last snapshot seen, one reference held
     while (1) {
         spotify_wait_event(client, &spotify_evt, portMAX_DELAY);
         if (spotify_evt.player_event == NEW_TRACK) {
             ESP_LOGI(TAG, "#");
-            spotify_clear_track(&track);
-            spotify_clone_track(&track, (TrackInfo*)spotify_evt.payload);
-            ESP_LOGI(TAG, "Track: \"%s\"", track.name);
-            ESP_LOGI(TAG, "Album: \"%s\"", track.album);
-            Node* artist_n = track.artists.first;
-            if (track.artists.count == 1) {
-                ESP_LOGI(TAG, "Artist: \"%s\"", (char*)artist_n->data);
+            spotify_track_unref(track);
+            track = spotify_evt.payload;
+            ESP_LOGI(TAG, "Track: \"%s\"", spotify_track_name(track));
+            ESP_LOGI(TAG, "Album: \"%s\"", spotify_track_album_name(track));
+            int artists = spotify_track_artist_count(track);
+            if (artists == 1) {
+                ESP_LOGI(TAG, "Artist: \"%s\"", spotify_track_artist(track, 0));
             } else {
                 ESP_LOGI(TAG, "Artists:");
-                while (artist_n) {
-                    ESP_LOGI(TAG, " \"%s\"", (char*)artist_n->data);
-                    artist_n = artist_n->next;
+                for (int i = 0; i < artists; i++) {
+                    ESP_LOGI(TAG, " \"%s\"", spotify_track_artist(track, i));
                 }
             }
         } else if (spotify_evt.player_event == SAME_TRACK) {
-            TrackInfo* track_updated = spotify_evt.payload;
-            if (track.isPlaying != track_updated->isPlaying) {
-                track.isPlaying = track_updated->isPlaying;
-                if (track.isPlaying) {
+            const TrackInfo* track_updated = spotify_evt.payload;
+            if (track && track->isPlaying != track_updated->isPlaying) {
+                if (track_updated->isPlaying) {
                     ESP_LOGW(TAG, "Unpaused");
                 } else {
                     ESP_LOGW(TAG, "Paused");
                 }
             }
-            if (track_updated->progress_ms != track.progress_ms) {
-                track.progress_ms = track_updated->progress_ms;
-                ESP_LOGW(TAG, "progress: %lld", track.progress_ms);
+            if (track && track_updated->progress_ms != track->progress_ms) {
+                ESP_LOGW(TAG, "progress: %lld", track_updated->progress_ms);
             }
+            spotify_track_unref(track);
+            track = track_updated;
         }
-        player_dispatch_event(client, DATA_PROCESSED_EVENT);
     }
 }
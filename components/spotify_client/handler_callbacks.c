@@ -10,6 +10,9 @@
 #include <string.h>
 #include "spotify_utils.h"
 #include "parse_objects.h"
+#include "json_stream.h"
+#include "json_filter.h"
+#include "json_minify.h"
 
 /* Private macro -------------------------------------------------------------*/
 #ifndef MIN
@@ -24,7 +27,6 @@ static const char *TAG = "HANDLER_CALLBACKS";
 /* External variables declarations -------------------------------------------*/
 
 /* Private function prototypes -----------------------------------------------*/
-size_t static inline memcpy_trimmed(char *dest, int dest_size, const char *src, size_t src_len);
 
 /* Exported functions --------------------------------------------------------*/
 esp_err_t json_http_event_cb(esp_http_client_event_t *evt)
@@ -35,15 +37,29 @@ esp_err_t json_http_event_cb(esp_http_client_event_t *evt)
 
     switch (evt->event_id)
     {
+    case HTTP_EVENT_HEADERS_SENT:
+        // a new attempt (first try, retry or 401 re-auth): new document
+        user_data->output_len = 0;
+        json_minify_reset(&user_data->minify);
+        break;
     case HTTP_EVENT_ON_DATA:
         ESP_LOGD(TAG, "CHUNK DATA:\n%.*s", evt->data_len, (char *)evt->data);
-        size_t stored = memcpy_trimmed(buffer + user_data->output_len, buffer_size - user_data->output_len, evt->data, evt->data_len);
-        user_data->output_len += stored;
+        // Spotify pretty-prints: only the tokens are stored, string
+        // contents untouched (a compact body is copied as it comes). The
+        // last byte is kept for the NUL.
+        bool overflowed = user_data->minify.overflow;
+        user_data->output_len += json_minify(&user_data->minify, buffer + user_data->output_len,
+                                             buffer_size - 1 - user_data->output_len, evt->data, evt->data_len);
         user_data->current_size = user_data->output_len;
+        if (user_data->minify.overflow && !overflowed)
+        {
+            ESP_LOGE(TAG, "Buffer overflow, stoping writing!");
+        }
         break;
     case HTTP_EVENT_ON_FINISH:
         buffer[user_data->output_len] = 0;
         user_data->output_len = 0;
+        json_minify_reset(&user_data->minify);
         break;
     case HTTP_EVENT_DISCONNECTED:
         int mbedtls_err = 0;
@@ -54,6 +70,7 @@ esp_err_t json_http_event_cb(esp_http_client_event_t *evt)
             ESP_LOGI(TAG, "Last mbedtls failure: 0x%x", mbedtls_err);
             buffer[user_data->output_len] = 0;
             user_data->output_len = 0;
+            json_minify_reset(&user_data->minify);
         }
         break;
     default:
@@ -62,13 +79,41 @@ esp_err_t json_http_event_cb(esp_http_client_event_t *evt)
     return ESP_OK;
 }
 
+esp_err_t json_stream_http_event_cb(esp_http_client_event_t *evt)
+{
+    evt_user_data_t *user_data = evt->user_data;
+    json_stream_t *stream = user_data->ctx;
+
+    switch (evt->event_id)
+    {
+    case HTTP_EVENT_HEADERS_SENT:
+        // a new attempt (first try, retry or 401 re-auth): new document
+        json_stream_reset(stream);
+        break;
+    case HTTP_EVENT_ON_DATA:
+        // a stream that already failed stays failed; only report it once
+        if (json_stream_feed(stream, NULL, 0) == OS_SUCCESS &&
+            json_stream_feed(stream, evt->data, evt->data_len) == -OS_FAIL)
+        {
+            ESP_LOGE(TAG, "Malformed JSON in response at byte %" PRIu32, json_stream_offset(stream));
+        }
+        break;
+    default:
+        break;
+    }
+    return ESP_OK;
+}
+
+/* Registered by player_task with the client as handler_args. Runs on the
+ * websocket task and never waits for player_task: complete messages go into
+ * ws_client.ring, which drops one itself if player_task has fallen behind,
+ * so reading (pings included) goes on whatever the UI is doing. */
 void default_ws_event_cb(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
 {
+    esp_spotify_client_handle_t client = handler_args;
     esp_websocket_event_data_t *data = (esp_websocket_event_data_t *)event_data;
-    evt_user_data_t *user_data = data->user_context;
-    char *buffer = (char *)user_data->buffer;
-    size_t buffer_size = user_data->buffer_size;
-    EventGroupHandle_t event_group = user_data->ctx;
+    ws_ring_t *ring = &client->ws_client.ring;
+    EventGroupHandle_t event_group = client->ws_client.event_group;
     
     switch (event_id)
     {
@@ -78,10 +123,12 @@ void default_ws_event_cb(void *handler_args, esp_event_base_t base, int32_t even
         break;
     case WEBSOCKET_EVENT_DISCONNECTED:
         ESP_LOGD(TAG, "WebSocket Disconnected");
+        ws_ring_abort(ring);
         xEventGroupSetBits(event_group, WS_DISCONNECT_EVENT);
         break;
     case WEBSOCKET_EVENT_CLOSED:
         ESP_LOGD(TAG, "WebSocket Closed cleanly");
+        ws_ring_abort(ring);
         xEventGroupSetBits(event_group, WS_DISCONNECT_EVENT);
         break;
     case WEBSOCKET_EVENT_DATA:
@@ -95,31 +142,21 @@ void default_ws_event_cb(void *handler_args, esp_event_base_t base, int32_t even
         {
             if (data->payload_offset == 0) // first chunk of the message
             {
-                xEventGroupWaitBits(
-                    event_group,
-                    WS_READY_FOR_DATA,
-                    pdTRUE,
-                    pdFALSE,
-                    portMAX_DELAY);
-                user_data->current_size = 0;
-            }
-            if ((size_t)(data->payload_len) + 1 > buffer_size)
-            {
-                ESP_LOGE(TAG, "WebSocket message too big for buffer (%d > %d), dropping it", data->payload_len, buffer_size - 1);
-                if (data->payload_offset + data->data_len == data->payload_len)
+                esp_err_t err = ws_ring_begin(ring, data->payload_len);
+                if (err == ESP_ERR_INVALID_SIZE)
                 {
-                    // last chunk of the oversized message: let the next message through
-                    xEventGroupSetBits(event_group, WS_READY_FOR_DATA);
+                    ESP_LOGE(TAG, "WebSocket message too big for buffer (%d > %d), dropping it", data->payload_len, (int)ring->msg_size - 1);
+                }
+                else if (err != ESP_OK)
+                {
+                    ESP_LOGW(TAG, "WebSocket queue full, dropping incoming message");
                 }
-                break;
             }
-            memcpy(buffer + data->payload_offset, data->data_ptr, data->data_len);
-            if (data->payload_offset + data->data_len == data->payload_len)
+            // fragments of a dropped message are ignored
+            ws_ring_append(ring, data->payload_offset, data->data_ptr, data->data_len);
+            if (data->payload_offset + data->data_len == data->payload_len && ws_ring_commit(ring))
             {
                 ESP_LOGD(TAG, "Complete message received. Length: %d", data->payload_len);
-                buffer[data->payload_len] = 0;
-                user_data->current_size = data->payload_len;
-                ESP_LOGD(TAG, "%s", buffer);
                 xEventGroupSetBits(event_group, WS_DATA_EVENT);
             }
         }
@@ -188,161 +225,24 @@ esp_err_t default_http_event_cb(esp_http_client_event_t *evt)
     return ESP_OK;
 }
 
-/**
- * @brief We don't have enough memory to store the whole JSON. So the
- * approach is to process the "items" array one playlist at a time.
- *
- */
-esp_err_t playlist_http_event_cb(esp_http_client_event_t *evt)
+esp_err_t json_filter_http_event_cb(esp_http_client_event_t *evt)
 {
     evt_user_data_t *user_data = evt->user_data;
-    char *buffer = (char *)user_data->buffer;
-    List * playlists = user_data->ctx;
-
-    static const char *items_key = "\"items\"";
-    // Playlist-scan-only state (in_items/brace_count/item_overflow/
-    // in_string/escaped) lives grouped in user_data->playlist_scan - see
-    // playlist_scan_state_t in spotify_client_priv.h - so it's scoped to
-    // this client instance and can be reset in one line.
-    playlist_scan_state_t *scan = &user_data->playlist_scan;
-
-    char *src = (char *)evt->data;
-    int src_len = evt->data_len;
+    json_filter_t *filter = user_data->ctx;
 
     switch (evt->event_id)
     {
+    case HTTP_EVENT_HEADERS_SENT:
+        // a new attempt (first try, retry or 401 re-auth): new document
+        json_filter_reset(filter);
+        break;
     case HTTP_EVENT_ON_DATA:
-        if (!scan->in_items)
+        if (json_filter_feed(filter, NULL, 0) == OS_SUCCESS &&
+            json_filter_feed(filter, evt->data, evt->data_len) == -OS_FAIL)
         {
-            char *match_found = memmem(src, src_len, items_key, strlen(items_key));
-            if (!match_found)
-                break;
-            scan->in_items = 1;
-            match_found += strlen(items_key);
-            src_len -= match_found - src;
-            src = match_found;
-        }
-        for (int i = 0; i < src_len; i++)
-        {
-            char c = src[i];
-
-            // Track whether we're inside a JSON string value: playlist
-            // names/descriptions are free text and can legitimately contain
-            // '{', '}', or whitespace that the heuristics below would
-            // otherwise mistake for JSON structure.
-            if (scan->in_string)
-            {
-                if (scan->escaped)
-                {
-                    scan->escaped = false;
-                }
-                else if (c == '\\')
-                {
-                    scan->escaped = true;
-                }
-                else if (c == '\"')
-                {
-                    scan->in_string = false;
-                }
-            }
-            else if (c == '\"')
-            {
-                scan->in_string = true;
-            }
-
-            // Skip unnecessary spaces (only outside of string values: a
-            // literal space inside a name/description must be preserved)
-            if (!scan->in_string && isspace((unsigned char)c))
-            {
-                char prev = i ? src[i - 1] : 0;
-                char next = (i < src_len - 1) ? src[i + 1] : 0;
-                if (prev == ',' && next == '\"')
-                    continue;
-                if (prev == ':' && (user_data->current_size) > 1)
-                {
-                    if (buffer[(user_data->current_size) - 2] == '\"')
-                        continue;
-                }
-                if (strchr(" \"[]{}", prev) || strchr(" \"[]{}", next))
-                    continue;
-            }
-            if (!scan->in_string && c == '{')
-            {
-                if (scan->brace_count == 0)
-                {
-                    // Start of new playlist
-                    (user_data->current_size) = 0;
-                    scan->item_overflow = 0;
-                }
-                scan->brace_count++;
-            }
-            if (scan->brace_count > 0)
-            {
-                if ((user_data->current_size) < (user_data->buffer_size) - 1)
-                {
-                    buffer[(user_data->current_size)++] = c;
-                }
-                else if (!scan->item_overflow)
-                {
-                    scan->item_overflow = 1;
-                    ESP_LOGE(TAG, "Playlist item too big for buffer, discarding it");
-                }
-            }
-            if (!scan->in_string && c == '}' && scan->brace_count > 0)
-            {
-                // Guarded by `brace_count > 0`: once the real "items" array
-                // ends, scanning continues into the rest of the response
-                // (e.g. the closing '}' of Spotify's own top-level wrapper
-                // object, `{"href":...,"items":[...],"limit":50,...}`).
-                // Without this guard, that extra '}' would decrement
-                // brace_count below 0 with nothing to bring it back up,
-                // leaving depth-tracking permanently offset for the rest of
-                // this request - every nested sub-object of the next
-                // playlist (external_urls/images/owner/tracks) then looks
-                // like a fresh top-level item.
-                scan->brace_count--;
-                if (scan->brace_count == 0 && user_data->current_size > 0)
-                {
-                    // End of playlist
-                    if (!scan->item_overflow)
-                    {
-                        buffer[(user_data->current_size)] = '\0';
-                        ESP_LOGD(TAG, "Playlist (len: %d):\n%s", strlen(buffer), buffer);
-                        PlaylistItem_t *item = malloc(sizeof(*item));
-                        if (!item)
-                        {
-                            ESP_LOGE(TAG, "Out of memory allocating playlist item, skipping it");
-                        }
-                        else if (parse_playlist(buffer, item, (json_tok_t *)user_data->tokens) != ESP_OK)
-                        {
-                            // parse_playlist() already logged why (missing
-                            // "name"/"uri", or the fragment wasn't valid
-                            // JSON); discard instead of appending garbage.
-                            free(item->name);
-                            free(item->uri);
-                            free(item);
-                        }
-                        else if (!spotify_append_item_to_list(playlists, (void *)item))
-                        {
-                            ESP_LOGE(TAG, "Out of memory appending playlist item, skipping it");
-                            free(item->name);
-                            free(item->uri);
-                            free(item);
-                        }
-                    }
-                    (user_data->current_size) = 0;
-                }
-            }
+            ESP_LOGE(TAG, "Response JSON nested too deep, ignoring the rest of it");
         }
         break;
-    case HTTP_EVENT_ON_FINISH:
-        user_data->current_size = 0;
-        user_data->playlist_scan = (playlist_scan_state_t){0};
-        break;
-    case HTTP_EVENT_DISCONNECTED:
-        user_data->current_size = 0;
-        user_data->playlist_scan = (playlist_scan_state_t){0};
-        break;
     default:
         break;
     }
@@ -350,32 +250,3 @@ esp_err_t playlist_http_event_cb(esp_http_client_event_t *evt)
 }
 
 /* Private functions ---------------------------------------------------------*/
-size_t static inline memcpy_trimmed(char *dest, int dest_size, const char *src, size_t src_len)
-{
-    size_t chars_stored = 0;
-    for (size_t i = 0; i < src_len; i++)
-    {
-        // Skip unnecessary spaces
-        if (isspace((unsigned char)src[i]))
-        {
-            char prev = i ? src[i - 1] : 0;
-            char next = (i < src_len - 1) ? src[i + 1] : 0;
-            if (prev == ',' && next == '\"')
-                continue;
-            if (prev == ':' && chars_stored > 1)
-            {
-                if (dest[chars_stored - 2] == '\"')
-                    continue;
-            }
-            if (strchr(" \"[]{}", prev) || strchr(" \"[]{}", next))
-                continue;
-        }
-        if ((int)chars_stored > dest_size - 1)
-        {
-            ESP_LOGE(TAG, "Buffer overflow, stoping writing!");
-            return chars_stored;
-        }
-        dest[chars_stored++] = src[i];
-    }
-    return chars_stored;
-}
\ No newline at end of file
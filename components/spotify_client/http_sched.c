@@ -0,0 +1,160 @@
+/* Includes ------------------------------------------------------------------*/
+#include "http_sched.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "spotify_client_priv.h"
+#include <string.h>
+
+/* Private function prototypes -----------------------------------------------*/
+static void record_wait(spotify_sched_stats_t *stats, int64_t waited_us, bool queued);
+
+/* Locally scoped variables --------------------------------------------------*/
+static const char *TAG = "spotify_client";
+
+/* Exported functions --------------------------------------------------------*/
+esp_err_t http_sched_init(http_sched_t *sched)
+{
+    memset(sched, 0, sizeof(*sched));
+    for (int l = 0; l < HTTP_LANE_MAX; l++)
+    {
+        http_lane_t *lane = &sched->lanes[l];
+        if (!(lane->lock = xSemaphoreCreateMutex()))
+        {
+            http_sched_deinit(sched);
+            return ESP_ERR_NO_MEM;
+        }
+        for (int cls = 0; cls < HTTP_SCHED_QUEUES; cls++)
+        {
+            if (!(lane->grant[cls] = xSemaphoreCreateBinary()))
+            {
+                http_sched_deinit(sched);
+                return ESP_ERR_NO_MEM;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+void http_sched_deinit(http_sched_t *sched)
+{
+    for (int l = 0; l < HTTP_LANE_MAX; l++)
+    {
+        http_lane_t *lane = &sched->lanes[l];
+        if (lane->lock)
+        {
+            vSemaphoreDelete(lane->lock);
+            lane->lock = NULL;
+        }
+        for (int cls = 0; cls < HTTP_SCHED_QUEUES; cls++)
+        {
+            if (lane->grant[cls])
+            {
+                vSemaphoreDelete(lane->grant[cls]);
+                lane->grant[cls] = NULL;
+            }
+        }
+    }
+}
+
+/* Waits for `lane` and takes it for a request of class cls
+ * (spotify_req_class_t, or HTTP_SCHED_UNMETERED): SPOTIFY_REQ_IMAGE on
+ * HTTP_LANE_IMAGE, every other class on HTTP_LANE_SHARED. A request
+ * already on the wire is never cut short: a pause tap still waits for the
+ * transfer in progress, but then goes before any browsing queued behind
+ * it. Not recursive, same as the mutex it replaces. */
+void http_sched_acquire(http_sched_t *sched, http_lane_id_t lane_id, int cls)
+{
+    http_lane_t *lane = &sched->lanes[lane_id];
+    int64_t start_us = esp_timer_get_time();
+    ACQUIRE_LOCK(lane->lock);
+    bool queued = lane->busy;
+    if (queued)
+    {
+        lane->waiting[cls]++;
+        RELEASE_LOCK(lane->lock);
+        // http_sched_release() leaves busy set: the lane is already ours
+        xSemaphoreTake(lane->grant[cls], portMAX_DELAY);
+        ACQUIRE_LOCK(lane->lock);
+    }
+    lane->busy = true;
+    lane->owner = cls;
+    lane->granted_us = esp_timer_get_time();
+    if (cls < SPOTIFY_REQ_CLASS_MAX)
+    {
+        record_wait(&sched->stats[cls], lane->granted_us - start_us, queued);
+    }
+    RELEASE_LOCK(lane->lock);
+}
+
+/* Hands `lane` over to the most urgent class with a waiter, if any. */
+void http_sched_release(http_sched_t *sched, http_lane_id_t lane_id)
+{
+    http_lane_t *lane = &sched->lanes[lane_id];
+    ACQUIRE_LOCK(lane->lock);
+    if (lane->owner < SPOTIFY_REQ_CLASS_MAX)
+    {
+        uint32_t held_ms = (uint32_t)((esp_timer_get_time() - lane->granted_us) / 1000);
+        spotify_sched_stats_t *stats = &sched->stats[lane->owner];
+        if (held_ms > stats->hold_ms_max)
+        {
+            stats->hold_ms_max = held_ms;
+        }
+    }
+    int next = 0;
+    while (next < HTTP_SCHED_QUEUES && !lane->waiting[next])
+    {
+        next++;
+    }
+    if (next == HTTP_SCHED_QUEUES)
+    {
+        lane->busy = false;
+    }
+    else
+    {
+        lane->waiting[next]--;
+        if (next < SPOTIFY_REQ_CLASS_MAX)
+        {
+            for (int cls = next + 1; cls < SPOTIFY_REQ_CLASS_MAX; cls++)
+            {
+                if (lane->waiting[cls])
+                {
+                    sched->stats[next].bypassed++;
+                    ESP_LOGD(TAG, "HTTP lane %d: class %d goes ahead of class %d", lane_id, next, cls);
+                    break;
+                }
+            }
+        }
+        xSemaphoreGive(lane->grant[next]);
+    }
+    RELEASE_LOCK(lane->lock);
+}
+
+http_lane_id_t http_sched_lane_of(spotify_http_host_t host)
+{
+    return host == SPOTIFY_HTTP_HOST_IMAGE ? HTTP_LANE_IMAGE : HTTP_LANE_SHARED;
+}
+
+/* Only takes the lane's own lock: doesn't wait for the request holding it. */
+void http_sched_get_stats(http_sched_t *sched, spotify_req_class_t cls, spotify_sched_stats_t *stats)
+{
+    http_lane_t *lane = &sched->lanes[cls == SPOTIFY_REQ_IMAGE ? HTTP_LANE_IMAGE : HTTP_LANE_SHARED];
+    ACQUIRE_LOCK(lane->lock);
+    *stats = sched->stats[cls];
+    RELEASE_LOCK(lane->lock);
+}
+
+/* Private functions ---------------------------------------------------------*/
+static void record_wait(spotify_sched_stats_t *stats, int64_t waited_us, bool queued)
+{
+    uint32_t ms = (uint32_t)(waited_us / 1000);
+    stats->requests++;
+    if (queued)
+    {
+        stats->queued++;
+    }
+    stats->wait_ms_total += ms;
+    if (ms > stats->wait_ms_max)
+    {
+        stats->wait_ms_max = ms;
+    }
+}
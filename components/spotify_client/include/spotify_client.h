@@ -16,7 +16,7 @@
  * an HTTP-level failure (e.g. 404 "no active device") using status_code
  * alone, without needing ANOTHER out-param just for that. */
 #define HTTP_STATUS_NO_CONTENT 204
-/* Desired Album.url_cover/Album.cover_size resolution: parse_track()
+/* Desired spotify_track_cover_url()/Album.cover_size resolution: parse_track()
  * (parse_objects.c) picks the "images" entry closest to this size when the
  * response doesn't offer an exact match (episodes and some releases don't).
  * Public because the display pipeline (main/player_screen.c) needs the same
@@ -54,10 +54,7 @@ typedef enum {
 
 typedef struct
 {
-    char* id;
     bool  is_active;
-    char* name;
-    char* type;
     int   volume_percent; /* 0-100, or -1 if not known yet (device.volume_percent
                             * is only populated once parse_track() has seen at
                             * least one player-state response). */
@@ -65,33 +62,42 @@ typedef struct
 
 typedef struct
 {
-    char* name;
-    char* url_cover;
-    /* Actual (square) side length in px of url_cover's image, or 0 if
-     * url_cover is NULL (no usable image at all). Not necessarily
+    /* Actual (square) side length in px of the spotify_track_cover_url()
+     * image, or 0 if there is none (no usable image at all). Not necessarily
      * ALBUM_COVER_PREFERRED_SIZE: parse_track() falls back to the closest
      * size available when there's no exact match, and consumers that assume
      * a fixed decode resolution (main/player_screen.c) need this to tell
      * "usable at our expected size" apart from "usable, but not a size we
-     * can safely decode" without guessing from url_cover alone. */
+     * can safely decode" without guessing from the URL alone. */
     int   cover_size;
 } Album;
 
+/* A track's strings (name, artists, album name, cover URL) packed into one
+ * block, referred to by offsets within it: built with one allocation,
+ * copied with one memcpy. Read through the spotify_track_*() accessors. */
+typedef struct TrackStrings TrackStrings;
+
 typedef struct
 {
     char   id[SPOTIFY_ID_BUF_SIZE];
-    char*  name;
-    List   artists;
     Album  album;
     time_t duration_ms;
     time_t progress_ms;
     bool   isPlaying;
     Device device;
+    /* NULL before the first track. Belongs to the snapshot for the ones in
+     * events, to the copy for spotify_clone_track()'s. */
+    const TrackStrings* strings;
 } TrackInfo;
 
 typedef struct {
     PlayerEvent_t player_event;
-    void*   payload;
+    void*   payload;    /* SAME_TRACK/NEW_TRACK: a const TrackInfo*, a read-only
+                         * snapshot the consumer holds one reference to and
+                         * must spotify_track_unref() when done with it (keep
+                         * it as long as needed: player_task never changes a
+                         * published snapshot, it publishes a new one).
+                         * NULL for every other event type. */
     int     error_code; /* for PLAYER_ERROR: the HTTP status code that caused
                           * it (e.g. 403 == Premium required for playback
                           * control), or 0 if the failure wasn't HTTP-level
@@ -99,10 +105,140 @@ typedef struct {
                           * every other event type. */
 } SpotifyEvent_t;
 
+/* Hosts the component talks HTTP(S) to. Each one gets its own pooled
+ * connection (handle, receive buffer, TLS session), so e.g. fetching cover
+ * art never tears down the api.spotify.com connection. */
+typedef enum {
+    SPOTIFY_HTTP_HOST_API = 0, /* api.spotify.com (Web API) */
+    SPOTIFY_HTTP_HOST_IMAGE,   /* i.scdn.co (album art, fetch_album_art()) */
+    SPOTIFY_HTTP_HOST_DISCORD, /* discord.com (access token endpoint) */
+    SPOTIFY_HTTP_HOST_MAX
+} spotify_http_host_t;
+
+/* TLS handshake counters for one connection. "Offered" handshakes are the
+ * ones that offered a cached session ticket (CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS).
+ * Neither esp-tls nor esp_http_client reports whether the server accepted
+ * it, so a declined ticket (a full handshake after all) is still counted
+ * here: it shows up as offered_ms_total/offered no longer being well below
+ * full_ms_total/full. Durations cover the whole connect (DNS + TCP + TLS, and
+ * the HTTP upgrade for the WebSocket), measured with esp_timer. */
+typedef struct {
+    uint32_t full;             /* handshakes with no cached session to offer */
+    uint32_t offered;          /* handshakes that offered a cached session */
+    uint32_t full_ms_total;
+    uint32_t offered_ms_total;
+    uint32_t last_ms;          /* duration of the most recent handshake */
+    bool     last_offered;     /* ...and whether it offered a cached session */
+} spotify_handshake_stats_t;
+
+/* Connection-reuse counters for one pooled host connection, cumulative
+ * since spotify_client_init() - see spotify_client_get_http_stats(). Meant
+ * for field/latency testing: reused/requests is the fraction of calls that
+ * skipped the TCP+TLS handshake entirely (CONFIG_SPOTIFY_HTTP_KEEP_ALIVE). */
+typedef struct {
+    uint32_t requests;         /* logical requests sent (retries not counted twice) */
+    uint32_t reused;           /* ...of which completed on an already-open connection */
+    uint32_t connects;         /* fresh TCP+TLS connections opened */
+    uint32_t stale_reconnects; /* kept-alive connections found closed by the
+                                * server on use, and transparently reopened */
+    spotify_handshake_stats_t handshakes; /* one per connect */
+} spotify_http_stats_t;
+
+/* Kinds of response parse_objects.c tokenizes (jsmn), for
+ * spotify_parse_stats_t. Search and the playlist list itself are streamed
+ * and never tokenized whole. */
+typedef enum {
+    SPOTIFY_PARSE_ACCESS_TOKEN = 0, /* Discord access token response */
+    SPOTIFY_PARSE_PLAYLIST,         /* one /me/playlists item at a time */
+    SPOTIFY_PARSE_DEVICES,          /* /me/player/devices */
+    SPOTIFY_PARSE_CONNECTION_ID,    /* first WebSocket message */
+    SPOTIFY_PARSE_PLAYER_STATE,     /* GET_STATE responses and WebSocket player events */
+    SPOTIFY_PARSE_MAX
+} spotify_parse_kind_t;
+
+/* Token usage since spotify_client_init() - see
+ * spotify_client_get_parse_stats(). Tokens are allocated on demand, to
+ * exactly the largest response seen so far, so peak_tokens from the field
+ * is what sizes this memory: each of the two arenas is simply the largest
+ * of the kinds that go through it. */
+typedef struct {
+    uint16_t peak_tokens[SPOTIFY_PARSE_MAX]; /* most tokens one response of each kind needed */
+    uint32_t arena_tokens;                   /* tokens currently allocated: HTTP responses' arena
+                                              * plus WebSocket messages' */
+    uint32_t failed;                         /* responses that couldn't be tokenized: invalid,
+                                              * over the MAX_TOKENS cap, or out of memory */
+} spotify_parse_stats_t;
+
+/* WebSocket messages queued between the websocket task and player_task
+ * (CONFIG_SPOTIFY_WS_QUEUE_DEPTH buffers) since spotify_client_init() - see
+ * spotify_client_get_ws_queue_stats(). A full queue never holds the
+ * websocket task up: it drops a message instead, as counted here. */
+typedef struct {
+    uint32_t queued;             /* complete messages handed to player_task's queue */
+    uint32_t dropped_same_track; /* queue full: dropped a player state followed by a
+                                  * newer one for the same track */
+    uint32_t dropped_other;      /* queue full with no such pair: dropped the incoming
+                                  * message (queued ones other than player states
+                                  * are never dropped) */
+    uint32_t dropped_oversized;  /* longer than a buffer (MAX_WS_BUFFER) */
+    uint32_t high_water;         /* most buffers in use at once, including the one
+                                  * player_task is parsing */
+} spotify_ws_queue_stats_t;
+
+/* What an HTTP request is for, most urgent first. Requests wait for their
+ * connection in this order rather than in arrival order: a pause tap goes
+ * before a playlist fetch queued ahead of it, although it still waits for a
+ * transfer already under way. Cover art has a connection of its own, so it
+ * only ever queues behind other cover art. */
+typedef enum {
+    SPOTIFY_REQ_TRANSPORT = 0, /* play/pause/next/previous, playing a URI, transfer_playback */
+    SPOTIFY_REQ_STATE,         /* GET_STATE and starting the dealer session */
+    SPOTIFY_REQ_ADJUST,        /* volume, seek */
+    SPOTIFY_REQ_BROWSE,        /* playlists, devices, search */
+    SPOTIFY_REQ_IMAGE,         /* fetch_album_art() */
+    SPOTIFY_REQ_CLASS_MAX
+} spotify_req_class_t;
+
+/* Queueing for one spotify_req_class_t since spotify_client_init() - see
+ * spotify_client_get_sched_stats(). wait_ms_total/requests is the mean
+ * delay a request of the class spent waiting for its connection before
+ * being sent; hold_ms_max shows which class is the one making others wait. */
+typedef struct {
+    uint32_t requests;      /* times the connection was taken for this class (a 401
+                             * retry or token refresh is part of the same one) */
+    uint32_t queued;        /* ...of which found it busy and had to wait */
+    uint32_t bypassed;      /* ...of which got it ahead of a less urgent class
+                             * that was waiting too */
+    uint32_t wait_ms_total;
+    uint32_t wait_ms_max;
+    uint32_t hold_ms_max;   /* longest this class kept the connection */
+} spotify_sched_stats_t;
+
+/* An _async request, from the call that made it until its callback
+ * returns. 0 is never one. */
+typedef uint32_t spotify_request_t;
+
+/* What an _async request got: what the blocking call it stands for would
+ * have returned. */
+typedef struct {
+    esp_err_t       err;         /* the call's return value; for the List ones, ESP_OK
+                                  * if list isn't NULL and ESP_FAIL otherwise */
+    HttpStatus_Code status_code; /* play/transfer calls' status_code, 0 for the others */
+    List*           list;        /* playlists/devices/search: the list, the callback's
+                                  * to spotify_free_nodes() and free() (or keep), or
+                                  * NULL on failure */
+} spotify_async_result_t;
+
+/* Runs on the component's worker task once the request is done, unless it
+ * was cancelled. Shouldn't block for long: the next request waits for it. */
+typedef void (*spotify_async_cb_t)(spotify_request_t req, spotify_async_result_t* result, void* user_ctx);
+
 /* Exported functions prototypes ---------------------------------------------*/
 esp_spotify_client_handle_t  spotify_client_init(UBaseType_t priority);
 esp_err_t  spotify_client_deinit(esp_spotify_client_handle_t client);
 esp_err_t  player_dispatch_event(esp_spotify_client_handle_t client, SendEvent_t event);
+esp_err_t  player_dispatch_volume(esp_spotify_client_handle_t client, int volume_percent);
+esp_err_t  player_dispatch_seek(esp_spotify_client_handle_t client, int position_ms);
 BaseType_t spotify_wait_event(esp_spotify_client_handle_t client, SpotifyEvent_t* event, TickType_t xTicksToWait);
 esp_err_t  spotify_play_context_uri(esp_spotify_client_handle_t client, const char* uri, HttpStatus_Code* status_code);
 esp_err_t  spotify_play_track_uri(esp_spotify_client_handle_t client, const char* uri, HttpStatus_Code* status_code);
@@ -112,6 +248,25 @@ esp_err_t  spotify_transfer_playback(esp_spotify_client_handle_t client, const c
 List*      spotify_user_playlists(esp_spotify_client_handle_t client);
 List*      spotify_available_devices(esp_spotify_client_handle_t client);
 List*      spotify_search_tracks(esp_spotify_client_handle_t client, const char* query);
+esp_err_t  spotify_user_playlists_async(esp_spotify_client_handle_t client, spotify_async_cb_t cb, void* user_ctx, spotify_request_t* req);
+esp_err_t  spotify_available_devices_async(esp_spotify_client_handle_t client, spotify_async_cb_t cb, void* user_ctx, spotify_request_t* req);
+esp_err_t  spotify_search_tracks_async(esp_spotify_client_handle_t client, const char* query, spotify_async_cb_t cb, void* user_ctx, spotify_request_t* req);
+esp_err_t  spotify_play_context_uri_async(esp_spotify_client_handle_t client, const char* uri, spotify_async_cb_t cb, void* user_ctx, spotify_request_t* req);
+esp_err_t  spotify_play_track_uri_async(esp_spotify_client_handle_t client, const char* uri, spotify_async_cb_t cb, void* user_ctx, spotify_request_t* req);
+esp_err_t  spotify_transfer_playback_async(esp_spotify_client_handle_t client, const char* device_id, spotify_async_cb_t cb, void* user_ctx, spotify_request_t* req);
+esp_err_t  spotify_request_cancel(esp_spotify_client_handle_t client, spotify_request_t req);
+const TrackInfo* spotify_track_ref(const TrackInfo* track);
+void       spotify_track_unref(const TrackInfo* track);
+const char* spotify_track_name(const TrackInfo* track);
+const char* spotify_track_album_name(const TrackInfo* track);
+const char* spotify_track_cover_url(const TrackInfo* track);
+int        spotify_track_artist_count(const TrackInfo* track);
+const char* spotify_track_artist(const TrackInfo* track, int index);
 void       spotify_clear_track(TrackInfo* track);
 esp_err_t  spotify_clone_track(TrackInfo* dest, const TrackInfo* src);
-ssize_t    fetch_album_art(esp_spotify_client_handle_t client, TrackInfo *track, uint8_t *out_buf, size_t buf_size);
+ssize_t    fetch_album_art(esp_spotify_client_handle_t client, const TrackInfo *track, uint8_t *out_buf, size_t buf_size);
+esp_err_t  spotify_client_get_http_stats(esp_spotify_client_handle_t client, spotify_http_host_t host, spotify_http_stats_t* stats);
+esp_err_t  spotify_client_get_parse_stats(esp_spotify_client_handle_t client, spotify_parse_stats_t* stats);
+esp_err_t  spotify_client_get_ws_handshake_stats(esp_spotify_client_handle_t client, spotify_handshake_stats_t* stats);
+esp_err_t  spotify_client_get_ws_queue_stats(esp_spotify_client_handle_t client, spotify_ws_queue_stats_t* stats);
+esp_err_t  spotify_client_get_sched_stats(esp_spotify_client_handle_t client, spotify_req_class_t req_class, spotify_sched_stats_t* stats);
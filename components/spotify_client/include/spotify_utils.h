@@ -28,6 +28,9 @@ typedef struct {
     NodeType_t type;
 } List;
 
+/* PlaylistItem_t and DeviceItem_t are each a single allocation, with the
+ * strings stored right after the struct: free() the item only (as
+ * spotify_free_nodes() does), never its fields. */
 typedef struct {
     char* name;
     char* uri;
@@ -44,10 +47,10 @@ typedef struct {
     char* name;
     char* uri;
     /* Every "artists[].name" joined into a single ", "-separated string at
-     * parse time (parse_search_results, parse_objects.c) - a search result
-     * row only needs to display this, not walk it as a list like
-     * TrackInfo.artists does, so a nested List would be unused complexity
-     * here. NULL if the result had no artists array or none parsed. */
+     * parse time (search_results_stream_cb, parse_objects.c) - a search result
+     * row only needs to display this, not walk the artists one by one like
+     * spotify_track_artist() does, so anything more would be unused
+     * complexity here. NULL if the result had no artists array or none parsed. */
     char* artists;
 } TrackSearchItem_t;
 
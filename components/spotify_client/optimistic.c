@@ -0,0 +1,244 @@
+/* Includes ------------------------------------------------------------------*/
+#include "optimistic.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "spotify_client_priv.h"
+#include <stdlib.h>
+
+/* Private macro -------------------------------------------------------------*/
+#define PREDICT_PLAYING  (1 << 0)
+#define PREDICT_PROGRESS (1 << 1)
+#define PREDICT_VOLUME   (1 << 2)
+#define PREDICT_FIELDS   OPTIMISTIC_FIELDS
+
+/* Private function prototypes -----------------------------------------------*/
+static uint8_t field_of(int cmd);
+static time_t progress_now(const optimistic_t *opt, bool playing, int64_t now_us);
+
+/* Locally scoped variables --------------------------------------------------*/
+static const char *TAG = "spotify_client";
+
+/* Exported functions --------------------------------------------------------*/
+/* What a PAUSE_UNPAUSE tap on `track` means, decided when it's given rather
+ * than when it runs (by then isPlaying already is the prediction): PLAY or
+ * PAUSE, or 0 to leave it to player_cmd() if there's no track yet. */
+int optimistic_resolve_toggle(const TrackInfo *track)
+{
+    if (!track->id[0])
+    {
+        return 0;
+    }
+    return track->isPlaying ? PAUSE : PLAY;
+}
+
+/* Applies what cmd (with arg, as queued) is about to do to the producer's
+ * snapshot *track (track_snapshot_writable()), and holds it against the
+ * server's state until confirmed or OPTIMISTIC_HOLD_MS have passed. Returns
+ * a new reference to the predicted snapshot, to publish as SAME_TRACK, or
+ * NULL if there's nothing to predict (no track yet, out of memory, or a
+ * command with no visible effect). */
+const TrackInfo *optimistic_predict(optimistic_t *opt, TrackInfo **track, int cmd, int arg)
+{
+    uint8_t field = field_of(cmd);
+    if (!field || !(*track)->id[0])
+    {
+        return NULL;
+    }
+    TrackInfo *t = track_snapshot_writable(track);
+    if (!t)
+    {
+        return NULL;
+    }
+    int64_t now_us = esp_timer_get_time();
+    // where the bar is right now, which whatever comes next starts from
+    t->progress_ms = progress_now(opt, t->isPlaying, now_us);
+    opt->progress_ms = t->progress_ms;
+    opt->progress_at_us = now_us;
+    switch (cmd)
+    {
+    case PLAY:
+    case PAUSE:
+        opt->is_playing = (cmd == PLAY);
+        t->isPlaying = opt->is_playing;
+        break;
+    case PAUSE_UNPAUSE:
+        opt->is_playing = arg ? (arg == PLAY) : !t->isPlaying;
+        t->isPlaying = opt->is_playing;
+        break;
+    case NEXT:
+    case PREVIOUS:
+        opt->progress_ms = 0;
+        t->progress_ms = 0;
+        break;
+    case SEEK:
+        opt->progress_ms = arg < 0 ? 0 : arg;
+        t->progress_ms = opt->progress_ms;
+        break;
+    case SET_VOLUME:
+        opt->volume_percent = arg < 0 ? 0 : arg > 100 ? 100 : arg;
+        t->device.volume_percent = opt->volume_percent;
+        break;
+    }
+    opt->fields |= field;
+    for (int i = 0; i < PREDICT_FIELDS; i++)
+    {
+        if (field & (1 << i))
+        {
+            opt->hold_until_us[i] = now_us + (int64_t)OPTIMISTIC_HOLD_MS * 1000;
+        }
+    }
+    ESP_LOGD(TAG, "Predicted command %d: playing=%d progress=%ld volume=%d", cmd, t->isPlaying, (long)t->progress_ms, t->device.volume_percent);
+    return spotify_track_ref(t);
+}
+
+/* Called on every snapshot parsed from the server, before it's published
+ * (*track is then only the producer's and the unpublished event's). Records
+ * it as the state to roll back to, then patches in every prediction it
+ * contradicts - most likely it was sent before the command reached
+ * Spotify - as long as they hold. A prediction the server agrees with is
+ * confirmed and dropped; a new track confirms a next/previous. */
+void optimistic_reconcile(optimistic_t *opt, TrackInfo *track, bool new_track)
+{
+    int64_t now_us = esp_timer_get_time();
+    opt->server.is_playing = track->isPlaying;
+    opt->server.progress_ms = track->progress_ms;
+    opt->server.progress_at_us = now_us;
+    opt->server.volume_percent = track->device.volume_percent;
+    if (!opt->fields)
+    {
+        return;
+    }
+    uint8_t expired = 0;
+    for (int i = 0; i < PREDICT_FIELDS; i++)
+    {
+        if ((opt->fields & (1 << i)) && now_us >= opt->hold_until_us[i])
+        {
+            expired |= 1 << i;
+        }
+    }
+    if (expired)
+    {
+        ESP_LOGW(TAG, "Server never confirmed predicted state 0x%x, taking its own", expired);
+        opt->fields &= ~expired;
+    }
+    if (opt->fields & PREDICT_PLAYING)
+    {
+        if (track->isPlaying == opt->is_playing)
+        {
+            opt->fields &= ~PREDICT_PLAYING;
+        }
+        track->isPlaying = opt->is_playing;
+    }
+    if (opt->fields & PREDICT_PROGRESS)
+    {
+        time_t predicted = progress_now(opt, track->isPlaying, now_us);
+        // a position from before a pause or play reached the server
+        // doesn't confirm where that left the bar
+        bool stale = opt->fields & PREDICT_PLAYING;
+        if (new_track || (!stale && llabs((long long)(track->progress_ms - predicted)) <= OPTIMISTIC_PROGRESS_SLACK_MS))
+        {
+            opt->fields &= ~PREDICT_PROGRESS;
+        }
+        else
+        {
+            track->progress_ms = predicted;
+        }
+    }
+    if (opt->fields & PREDICT_VOLUME)
+    {
+        if (track->device.volume_percent == opt->volume_percent)
+        {
+            opt->fields &= ~PREDICT_VOLUME;
+        }
+        track->device.volume_percent = opt->volume_percent;
+    }
+}
+
+/* cmd went through: give the server's echo time again to confirm the
+ * fields cmd predicted, while other predictions keep their own deadline. */
+void optimistic_settle(optimistic_t *opt, int cmd)
+{
+    uint8_t field = field_of(cmd) & opt->fields;
+    int64_t until_us = esp_timer_get_time() + (int64_t)OPTIMISTIC_HOLD_MS * 1000;
+    for (int i = 0; i < PREDICT_FIELDS; i++)
+    {
+        if ((field & (1 << i)) && until_us > opt->hold_until_us[i])
+        {
+            opt->hold_until_us[i] = until_us;
+        }
+    }
+}
+
+/* cmd failed: puts back what the server last said about the fields it
+ * predicted, leaving other commands' predictions be. A new reference to
+ * the corrected snapshot, to publish as SAME_TRACK, or NULL if there was
+ * nothing to undo. */
+const TrackInfo *optimistic_rollback(optimistic_t *opt, TrackInfo **track, int cmd)
+{
+    uint8_t field = field_of(cmd) & opt->fields;
+    if (!field)
+    {
+        return NULL;
+    }
+    opt->fields &= ~field;
+    TrackInfo *t = track_snapshot_writable(track);
+    if (!t)
+    {
+        return NULL;
+    }
+    if (field & PREDICT_PLAYING)
+    {
+        t->isPlaying = opt->server.is_playing;
+    }
+    if (field & PREDICT_VOLUME)
+    {
+        t->device.volume_percent = opt->server.volume_percent;
+    }
+    t->progress_ms = progress_now(opt, t->isPlaying, esp_timer_get_time());
+    ESP_LOGI(TAG, "Command %d failed, rolled back to playing=%d progress=%ld volume=%d", cmd, t->isPlaying, (long)t->progress_ms, t->device.volume_percent);
+    return spotify_track_ref(t);
+}
+
+/* Private functions ---------------------------------------------------------*/
+static uint8_t field_of(int cmd)
+{
+    switch (cmd)
+    {
+    case PLAY:
+    case PAUSE:
+    case PAUSE_UNPAUSE:
+        // the bar stops or starts where it is
+        return PREDICT_PLAYING | PREDICT_PROGRESS;
+    case NEXT:
+    case PREVIOUS:
+    case SEEK:
+        return PREDICT_PROGRESS;
+    case SET_VOLUME:
+        return PREDICT_VOLUME;
+    default:
+        return 0;
+    }
+}
+
+/* Where the bar is now: the predicted position moved on since it was
+ * predicted, or else the server's since it was received. */
+static time_t progress_now(const optimistic_t *opt, bool playing, int64_t now_us)
+{
+    time_t ms;
+    int64_t since_us;
+    if (opt->fields & PREDICT_PROGRESS)
+    {
+        ms = opt->progress_ms;
+        since_us = opt->progress_at_us;
+    }
+    else
+    {
+        ms = opt->server.progress_ms;
+        since_us = opt->server.progress_at_us;
+    }
+    if (playing && since_us)
+    {
+        ms += (now_us - since_us) / 1000;
+    }
+    return ms;
+}
@@ -1,6 +1,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "parse_objects.h"
 #include "esp_log.h"
+#include "extract_objects.h"
 #include "json_parser.h"
 #include "spotify_client_priv.h"
 #include <limits.h>
@@ -11,247 +12,383 @@
 // early check of unrecoverable error
 #define ERR_CHECK(x) ESP_ERROR_CHECK(x)
 
+/* Depths (json_stream_evt_t.depth) of the parts of a /v1/search response
+ * search_results_stream_cb() picks out:
+ * {"tracks": {"items": [{"name", "uri", "artists": [{"name"}]}]}} */
+#define SEARCH_DEPTH_TRACKS  2
+#define SEARCH_DEPTH_ITEMS   3
+#define SEARCH_DEPTH_ITEM    4
+#define SEARCH_DEPTH_ARTISTS 5
+#define SEARCH_DEPTH_ARTIST  6
+#define KEY_IS(evt, name) ((evt)->key && strcmp((evt)->key, (name)) == 0)
+
+/* Where parse_ws_track_id() finds things in a dealer message (depths as
+ * in json_stream_evt_t): "uri" in the root, "type" in payloads[0].events[0]
+ * and "id" in its "event"."state"."item". */
+#define WS_DEPTH_URI      1
+#define WS_LEVEL_EVENT0   3  /* ws_path[] index of events[0] */
+#define WS_DEPTH_EVENT0   (WS_LEVEL_EVENT0 + 2)
+#define WS_DEPTH_STATE    (WS_PATH_LEVELS + 1)
+#define WS_DEPTH_IN_STATE (WS_DEPTH_STATE + 1)
+#define WS_PATH_LEVELS    (sizeof(ws_path) / sizeof(ws_path[0]))
+/* Only has to hold the short values compared: uri, type, item id. */
+#define WS_CLASSIFY_BUF_SIZE 64
+
 /* Private types -------------------------------------------------------------*/
+/* parse_ws_track_id()'s view of the message so far. */
+typedef struct {
+    char id[SPOTIFY_ID_BUF_SIZE];  /* item.id, if it fit */
+    uint8_t matched;               /* ws_path[] levels the stream is inside */
+    uint8_t taken;                 /* bit i: ws_path[i] (an array element) already seen */
+    bool in_item;
+    bool uri_ok;
+    bool type_ok;
+    bool id_seen;
+    bool id_ok;
+    bool mismatch;                 /* not a PLAYER_STATE_CHANGED event (or can't tell) */
+} ws_classify_t;
 
 /* Private function prototypes -----------------------------------------------*/
-static void parse_device_volume(jparse_ctx_t *jctx, TrackInfo *track);
+static int  parse_start(jparse_ctx_t *jctx, const char *js, parse_scratch_t *scratch, spotify_parse_kind_t kind);
+static SpotifyEvent_t parse_player_state(const char *js, const jparse_ctx_t *jctx, int root, TrackInfo **track);
+static bool parse_same_track_push(const char *js, TrackInfo **current, SpotifyEvent_t *evt);
+static const char *find_once(const char *js, const char *needle);
+static SpotifyEvent_t same_track_event(TrackInfo **current, const ex_player_state_t *state);
+static void ws_classify(const char *js, ws_classify_t *st);
+static int  ws_classify_cb(const json_stream_evt_t *evt, void *arg);
+static void parse_device_volume(bool has_device, const ex_player_state_device_t *device, TrackInfo *track);
+static bool view_copy(json_str_t view, char *buf, int size);
+static uint16_t view_pack(TrackStrings *strings, json_str_t view);
+static void view_decode(json_str_t *view);
+static char *item_str(char **tail, const char *src, int len);
+static void free_search_item(TrackSearchItem_t *item);
 
 /* Locally scoped variables --------------------------------------------------*/
 static const char* TAG = "PARSE_OBJECT";
+static const char *const parse_kind_names[SPOTIFY_PARSE_MAX] = {
+    [SPOTIFY_PARSE_ACCESS_TOKEN] = "access token",
+    [SPOTIFY_PARSE_PLAYLIST] = "playlist item",
+    [SPOTIFY_PARSE_DEVICES] = "devices",
+    [SPOTIFY_PARSE_CONNECTION_ID] = "connection id",
+    [SPOTIFY_PARSE_PLAYER_STATE] = "player state",
+};
+/* Containers from a dealer message's root down to the player state:
+ * {"payloads": [{"events": [{"event": {"state": {...}}}]}]}. Level i is
+ * the container at depth i + 2; a NULL key means the array's first
+ * element. */
+static const struct {
+    json_stream_evt_type_t begin;
+    const char *key;
+} ws_path[] = {
+    { JSON_STREAM_ARRAY_BEGIN, "payloads" },
+    { JSON_STREAM_OBJECT_BEGIN, NULL },
+    { JSON_STREAM_ARRAY_BEGIN, "events" },
+    { JSON_STREAM_OBJECT_BEGIN, NULL },
+    { JSON_STREAM_OBJECT_BEGIN, "event" },
+    { JSON_STREAM_OBJECT_BEGIN, "state" },
+};
 
 /* Globally scoped variables definitions -------------------------------------*/
 
 /* Exported functions --------------------------------------------------------*/
-esp_err_t parse_access_token(const char* js, char* access_token, int size, json_tok_t *tokens, int *expires_in)
+void parse_scratch_init(parse_scratch_t *scratch)
+{
+    // No key index: the generated extractors (extract_objects.h) read each
+    // response in one pass, the few json_obj_get_*() lookups left are into
+    // small objects.
+    json_tok_arena_init(&scratch->arena, MAX_TOKENS, false);
+    scratch->stats = (spotify_parse_stats_t){0};
+}
+
+void parse_scratch_free(parse_scratch_t *scratch)
+{
+    json_tok_arena_free(&scratch->arena);
+    scratch->stats.arena_tokens = 0;
+}
+
+esp_err_t parse_access_token(const char* js, char* access_token, int size, parse_scratch_t *scratch, int *expires_in)
 {
     jparse_ctx_t jctx;
     // Not ERR_CHECK: Discord's response is external data (rate-limit/error
     // bodies etc. are plausible) - must not crash the device on a
     // missing/malformed field (ANALYSIS.md 3.2).
-    if (json_parse_start_static(&jctx, js, strlen(js), tokens, MAX_TOKENS) != OS_SUCCESS)
+    if (parse_start(&jctx, js, scratch, SPOTIFY_PARSE_ACCESS_TOKEN) != OS_SUCCESS)
     {
         ESP_LOGE(TAG, "Failed to parse access token response JSON:\n%s", js);
         return ESP_FAIL;
     }
-    if (json_obj_get_string(&jctx, "access_token", access_token, size) != OS_SUCCESS)
+    ex_access_token_t resp;
+    if (extract_access_token(js, jctx.tokens, jctx.num_tokens, 0, &resp) != OS_SUCCESS)
     {
         ESP_LOGE(TAG, "\"access_token\" missing from access token response:\n%s", js);
         json_parse_end_static(&jctx);
         return ESP_FAIL;
     }
+    if (!view_copy(resp.access_token, access_token, size))
+    {
+        ESP_LOGE(TAG, "\"access_token\" too long (%d bytes, buffer: %d)", resp.access_token.len, size);
+        json_parse_end_static(&jctx);
+        return ESP_FAIL;
+    }
     if (expires_in)
     {
-        if (json_obj_get_int(&jctx, "expires_in", expires_in) != OS_SUCCESS)
+        if (!resp.has_expires_in)
         {
             ESP_LOGW(TAG, "\"expires_in\" missing from access token response, only reactive refresh will work");
-            *expires_in = 0;
         }
+        *expires_in = resp.has_expires_in ? resp.expires_in : 0;
     }
     json_parse_end_static(&jctx);
     return ESP_OK;
 }
 
-esp_err_t parse_available_devices(const char* js, List* devices_list, json_tok_t *tokens)
+esp_err_t parse_available_devices(char* js, List* devices_list, parse_scratch_t *scratch)
 {
     jparse_ctx_t jctx;
     // Not ERR_CHECK anywhere: malformed data means a shorter/empty list,
     // not a crashed device (ANALYSIS.md 1.21, same reasoning as
     // parse_access_token).
-    if (json_parse_start_static(&jctx, js, strlen(js), tokens, MAX_TOKENS) != OS_SUCCESS)
+    if (parse_start(&jctx, js, scratch, SPOTIFY_PARSE_DEVICES) != OS_SUCCESS)
     {
         ESP_LOGE(TAG, "Failed to parse available devices response JSON:\n%s", js);
         return ESP_FAIL;
     }
-    int num_elem;
-    if (json_obj_get_array(&jctx, "devices", &num_elem) != OS_SUCCESS)
+    // Entries without "name"/"id" are left out by the extractor already.
+    ex_device_list_t resp;
+    if (extract_device_list(js, jctx.tokens, jctx.num_tokens, 0, &resp) != OS_SUCCESS)
     {
         ESP_LOGE(TAG, "\"devices\" array missing from available devices response:\n%s", js);
         json_parse_end_static(&jctx);
         return ESP_FAIL;
     }
-    for (int i = 0; i < num_elem; i++) {
-        if (json_arr_get_object(&jctx, i) != OS_SUCCESS) {
-            ESP_LOGE(TAG, "Device %d in \"devices\" array isn't an object, skipping it", i);
-            continue;
-        }
-        // calloc, not malloc: name/id/is_active must start NULL/false so
-        // that if name or id fails to parse below, freeing whichever of
-        // the two DID get allocated is safe (free(NULL) is a no-op)
-        // instead of freeing an uninitialized garbage pointer.
-        DeviceItem_t* item = calloc(1, sizeof(*item));
+    for (int i = 0; i < resp.devices_count; i++) {
+        ex_device_list_devices_t *dev = &resp.devices[i];
+        // Decoded in place in the response, then copied along with the
+        // struct in a single allocation (see item_str()).
+        view_decode(&dev->name);
+        view_decode(&dev->id);
+        DeviceItem_t* item = malloc(sizeof(*item) + dev->name.len + dev->id.len + 2);
         if (!item) {
             ESP_LOGE(TAG, "Out of memory allocating device item, truncating device list");
-            json_arr_leave_object(&jctx);
             break;
         }
-        if (json_obj_dup_string(&jctx, "name", &item->name) != OS_SUCCESS ||
-            json_obj_dup_string(&jctx, "id", &item->id) != OS_SUCCESS) {
-            ESP_LOGE(TAG, "\"name\"/\"id\" missing from a device entry, skipping it");
-            free(item->name);
-            free(item->id);
-            free(item);
-            json_arr_leave_object(&jctx);
-            continue;
-        }
-        // Defensive, not ERR_CHECK: "is_active" is only used to highlight
-        // the current device in a picker UI, not worth discarding the
-        // whole entry over if a future response shape ever omits it.
-        if (json_obj_get_bool(&jctx, "is_active", &item->is_active) != OS_SUCCESS) {
-            item->is_active = false;
-        }
+        char *tail = (char *)(item + 1);
+        item->name = item_str(&tail, dev->name.str, dev->name.len);
+        item->id = item_str(&tail, dev->id.str, dev->id.len);
+        // Defensive: "is_active" is only used to highlight the current
+        // device in a picker UI, not worth discarding the whole entry over
+        // if a future response shape ever omits it.
+        item->is_active = dev->has_is_active && dev->is_active;
         if (!spotify_append_item_to_list(devices_list, (void*)item)) {
             ESP_LOGE(TAG, "Out of memory appending device item, truncating device list");
-            free(item->name);
-            free(item->id);
             free(item);
-            json_arr_leave_object(&jctx);
             break;
         }
-        json_arr_leave_object(&jctx);
     }
     json_parse_end_static(&jctx);
     return ESP_OK;
 }
 
-esp_err_t parse_playlist(const char* js, PlaylistItem_t* playlist_item, json_tok_t *tokens)
+PlaylistItem_t *parse_playlist(char* js, parse_scratch_t *scratch)
 {
-    playlist_item->name = NULL;
-    playlist_item->uri = NULL;
-
     jparse_ctx_t jctx;
-    if (json_parse_start_static(&jctx, js, strlen(js), tokens, MAX_TOKENS) != OS_SUCCESS)
+    if (parse_start(&jctx, js, scratch, SPOTIFY_PARSE_PLAYLIST) != OS_SUCCESS)
     {
         ESP_LOGE(TAG, "Failed to parse playlist item JSON, skipping it:\n%s", js);
-        return ESP_FAIL;
+        return NULL;
     }
 
-    esp_err_t err = ESP_OK;
-    if (json_obj_dup_string(&jctx, "name", &playlist_item->name) != OS_SUCCESS)
+    ex_playlist_t pl;
+    if (extract_playlist(js, jctx.tokens, jctx.num_tokens, 0, &pl) != OS_SUCCESS)
     {
-        ESP_LOGE(TAG, "\"name\" missing from playlist item, skipping it:\n%s", js);
-        err = ESP_FAIL;
+        ESP_LOGE(TAG, "\"name\"/\"uri\" missing from playlist item, skipping it:\n%s", js);
+        json_parse_end_static(&jctx);
+        return NULL;
     }
-    else if (json_obj_dup_string(&jctx, "uri", &playlist_item->uri) != OS_SUCCESS)
+    view_decode(&pl.name);
+    view_decode(&pl.uri);
+    PlaylistItem_t *item = malloc(sizeof(*item) + pl.name.len + pl.uri.len + 2);
+    if (!item)
     {
-        ESP_LOGE(TAG, "\"uri\" missing from playlist item, skipping it:\n%s", js);
-        err = ESP_FAIL;
+        ESP_LOGE(TAG, "Out of memory allocating playlist item, skipping it");
+    }
+    else
+    {
+        char *tail = (char *)(item + 1);
+        item->name = item_str(&tail, pl.name.str, pl.name.len);
+        item->uri = item_str(&tail, pl.uri.str, pl.uri.len);
     }
     json_parse_end_static(&jctx);
-    return err;
+    return item;
 }
 
-esp_err_t parse_search_results(const char* js, List* tracks_list, json_tok_t *tokens, int max_tokens)
+int playlist_filter_cb(char *json, int len, int index, void *arg)
 {
-    jparse_ctx_t jctx;
-    // Same "never abort on external data" reasoning as parse_available_devices.
-    if (json_parse_start_static(&jctx, js, strlen(js), tokens, max_tokens) != OS_SUCCESS)
+    playlist_filter_state_t *st = arg;
+    if (index == 0)
     {
-        ESP_LOGE(TAG, "Failed to parse search results response JSON");
-        return ESP_FAIL;
+        // new document (request retried): drop what the last one left
+        spotify_free_nodes(st->playlists);
     }
-    if (json_obj_get_object(&jctx, "tracks") != OS_SUCCESS)
+    if (!json)
     {
-        ESP_LOGE(TAG, "\"tracks\" object missing from search response");
-        json_parse_end_static(&jctx);
-        return ESP_FAIL;
+        ESP_LOGE(TAG, "Playlist item %d too big for the buffer, skipping it", index);
+        return 0;
     }
-    int num_elem;
-    if (json_obj_get_array(&jctx, "items", &num_elem) != OS_SUCCESS)
+    ESP_LOGD(TAG, "Playlist (len: %d):\n%s", len, json);
+    PlaylistItem_t *item = parse_playlist(json, st->scratch);
+    // NULL: parse_playlist() already logged why
+    if (item && !spotify_append_item_to_list(st->playlists, (void *)item))
     {
-        ESP_LOGE(TAG, "\"items\" array missing from search response");
-        json_parse_end_static(&jctx);
-        return ESP_FAIL;
+        ESP_LOGE(TAG, "Out of memory appending playlist item, skipping it");
+        free(item);
     }
-    for (int i = 0; i < num_elem; i++) {
-        if (json_arr_get_object(&jctx, i) != OS_SUCCESS) {
-            ESP_LOGE(TAG, "Track %d in \"items\" isn't an object, skipping it", i);
-            continue;
+    return 0;
+}
+
+int search_results_stream_cb(const json_stream_evt_t *evt, void *arg)
+{
+    search_results_state_t *st = arg;
+    switch (evt->type) {
+    case JSON_STREAM_OBJECT_BEGIN:
+        if (evt->depth == 1) {
+            // new document (request retried): drop what the last one left
+            spotify_free_nodes(st->tracks);
+            free_search_item(st->item);
+            *st = (search_results_state_t){.tracks = st->tracks};
+        } else if (evt->depth == SEARCH_DEPTH_TRACKS && KEY_IS(evt, "tracks")) {
+            st->in_tracks = true;
+        } else if (evt->depth == SEARCH_DEPTH_ITEM && st->in_items) {
+            // calloc, not malloc: name/uri/artists must start NULL so a
+            // skipped item can free whichever of the three DID get set.
+            st->item = calloc(1, sizeof(*st->item));
+            if (!st->item) {
+                ESP_LOGE(TAG, "Out of memory allocating search result item, truncating results");
+                return 1;
+            }
         }
-        // calloc, not malloc: name/uri/artists must start NULL so a partial
-        // failure below can free whichever of the three DID get allocated
-        // without touching uninitialized garbage.
-        TrackSearchItem_t* item = calloc(1, sizeof(*item));
-        if (!item) {
-            ESP_LOGE(TAG, "Out of memory allocating search result item, truncating results");
-            json_arr_leave_object(&jctx);
-            break;
+        break;
+    case JSON_STREAM_OBJECT_END:
+        if (evt->depth == SEARCH_DEPTH_TRACKS) {
+            st->in_tracks = false;
+        } else if (evt->depth == SEARCH_DEPTH_ITEM && st->item) {
+            TrackSearchItem_t *item = st->item;
+            st->item = NULL;
+            if (!item->name || !item->uri) {
+                ESP_LOGW(TAG, "\"name\"/\"uri\" missing from a search result, skipping it");
+                free_search_item(item);
+            } else if (!spotify_append_item_to_list(st->tracks, (void*)item)) {
+                ESP_LOGE(TAG, "Out of memory appending search result item, truncating results");
+                free_search_item(item);
+                return 1;
+            }
         }
-        if (json_obj_dup_string(&jctx, "name", &item->name) != OS_SUCCESS ||
-            json_obj_dup_string(&jctx, "uri", &item->uri) != OS_SUCCESS) {
-            ESP_LOGW(TAG, "\"name\"/\"uri\" missing from a search result, skipping it");
-            free(item->name);
-            free(item->uri);
-            free(item);
-            json_arr_leave_object(&jctx);
-            continue;
+        break;
+    case JSON_STREAM_ARRAY_BEGIN:
+        if (evt->depth == SEARCH_DEPTH_ITEMS && st->in_tracks && KEY_IS(evt, "items")) {
+            st->in_items = st->seen_items = true;
+        } else if (evt->depth == SEARCH_DEPTH_ARTISTS && st->item && KEY_IS(evt, "artists")) {
+            st->in_artists = true;
         }
-        // Join every artist's "name" into item->artists (", "-separated) -
-        // defensive, not fatal if "artists" is missing/malformed: a track
-        // without a visible artist list is still worth showing/playing.
-        int num_artists;
-        if (json_obj_get_array(&jctx, "artists", &num_artists) == OS_SUCCESS) {
-            for (int a = 0; a < num_artists; a++) {
-                if (json_arr_get_object(&jctx, a) != OS_SUCCESS) {
-                    continue;
-                }
-                char* artist_name;
-                if (json_obj_dup_string(&jctx, "name", &artist_name) == OS_SUCCESS) {
-                    if (!item->artists) {
-                        item->artists = artist_name;
-                    } else {
-                        size_t old_len = strlen(item->artists);
-                        size_t add_len = strlen(artist_name);
-                        char* joined = realloc(item->artists, old_len + 2 + add_len + 1);
-                        if (joined) {
-                            memcpy(joined + old_len, ", ", 2);
-                            memcpy(joined + old_len + 2, artist_name, add_len + 1);
-                            item->artists = joined;
-                        }
-                        free(artist_name);
-                    }
-                }
-                json_arr_leave_object(&jctx);
-            }
-            json_obj_leave_array(&jctx);
+        break;
+    case JSON_STREAM_ARRAY_END:
+        if (evt->depth == SEARCH_DEPTH_ITEMS) {
+            st->in_items = false;
+        } else if (evt->depth == SEARCH_DEPTH_ARTISTS) {
+            st->in_artists = false;
         }
-        if (!spotify_append_item_to_list(tracks_list, (void*)item)) {
-            ESP_LOGE(TAG, "Out of memory appending search result item, truncating results");
-            free(item->name);
-            free(item->uri);
-            free(item->artists);
-            free(item);
-            json_arr_leave_object(&jctx);
+        break;
+    case JSON_STREAM_STRING:
+        if (!st->item) {
             break;
         }
-        json_arr_leave_object(&jctx);
+        if (evt->depth == SEARCH_DEPTH_ITEM && KEY_IS(evt, "name") && !st->item->name) {
+            // a cut-short name still displays fine
+            st->item->name = strdup(evt->value);
+        } else if (evt->depth == SEARCH_DEPTH_ITEM && KEY_IS(evt, "uri") && !st->item->uri && !evt->truncated) {
+            st->item->uri = strdup(evt->value);
+        } else if (evt->depth == SEARCH_DEPTH_ARTIST && st->in_artists && KEY_IS(evt, "name")) {
+            // Join every artist's "name" into item->artists (", "-separated)
+            // - not fatal if it fails: a track without a visible artist list
+            // is still worth showing/playing.
+            if (!st->item->artists) {
+                st->item->artists = strdup(evt->value);
+            } else {
+                size_t old_len = strlen(st->item->artists);
+                char* joined = realloc(st->item->artists, old_len + 2 + evt->value_len + 1);
+                if (joined) {
+                    memcpy(joined + old_len, ", ", 2);
+                    memcpy(joined + old_len + 2, evt->value, evt->value_len + 1);
+                    st->item->artists = joined;
+                }
+            }
+        }
+        break;
+    default:
+        break;
+    }
+    return 0;
+}
+
+esp_err_t parse_search_results_finish(search_results_state_t *state)
+{
+    free_search_item(state->item);
+    state->item = NULL;
+    if (!state->seen_items) {
+        ESP_LOGE(TAG, "\"tracks\".\"items\" array missing from search response");
+        return ESP_FAIL;
     }
-    json_parse_end_static(&jctx);
     return ESP_OK;
 }
 
-void parse_connection_id(const char* js, char** data, json_tok_t *tokens)
+esp_err_t parse_connection_id(const char* js, char** data, parse_scratch_t *scratch)
 {
     jparse_ctx_t jctx;
-    ERR_CHECK(json_parse_start_static(&jctx, js, strlen(js), tokens, MAX_TOKENS));
-    ERR_CHECK(json_obj_get_object(&jctx, "headers"));
-    ERR_CHECK(json_obj_dup_string(&jctx, "Spotify-Connection-Id", data));
+    // Not ERR_CHECK anywhere: this is whatever message the dealer sent
+    // first, and the tokens are allocated now, so this can also fail for
+    // lack of memory; the caller disables the player on an error.
+    if (parse_start(&jctx, js, scratch, SPOTIFY_PARSE_CONNECTION_ID) != OS_SUCCESS) {
+        ESP_LOGE(TAG, "Failed to parse websocket connection message:\n%s", js);
+        return ESP_FAIL;
+    }
+    esp_err_t err = ESP_OK;
+    char *id = NULL;
+    if (json_obj_get_object(&jctx, "headers") != OS_SUCCESS ||
+        json_obj_dup_string(&jctx, "Spotify-Connection-Id", &id) != OS_SUCCESS) {
+        ESP_LOGE(TAG, "No headers.\"Spotify-Connection-Id\" in websocket connection message:\n%s", js);
+        free(id); // allocated if only unescaping it failed
+        err = ESP_FAIL;
+    } else {
+        *data = id;
+    }
     json_parse_end_static(&jctx);
+    return err;
 }
 
-SpotifyEvent_t parse_track(const char* js, TrackInfo** track, int initial_state, json_tok_t *tokens)
+SpotifyEvent_t parse_track(const char* js, TrackInfo** track, int initial_state, parse_scratch_t *scratch)
 {
     // ESP_LOGW(TAG, "%s", js);
     assert(track && *track);
 
     SpotifyEvent_t spotify_evt = { .player_event = UNKNOW };
 
+    if (!initial_state && parse_same_track_push(js, track, &spotify_evt)) {
+        return spotify_evt;
+    }
+
     jparse_ctx_t jctx;
-    ERR_CHECK(json_parse_start_static(&jctx, js, strlen(js), tokens, MAX_TOKENS));
+    // Not ERR_CHECK: the tokens are allocated now, so this can also fail
+    // for lack of memory, which shouldn't take the device down.
+    if (parse_start(&jctx, js, scratch, SPOTIFY_PARSE_PLAYER_STATE) != OS_SUCCESS) {
+        ESP_LOGE(TAG, "Failed to tokenize player state JSON (%d bytes)", (int)strlen(js));
+        return spotify_evt;
+    }
 
     if (initial_state) {
         // this function was called for the purpose of initial state,
-        // that is, a request via http was made, not really an event from ws
-        goto initial_state;
+        // that is, a request via http was made, not really an event from ws:
+        // the state object is the whole document
+        return parse_player_state(js, &jctx, 0, track);
     }
 
     bool is_event;
@@ -312,128 +449,305 @@ SpotifyEvent_t parse_track(const char* js, TrackInfo** track, int initial_state,
         return spotify_evt;
     }
     ERR_CHECK(json_obj_match_string(&jctx, "type", "PLAYER_STATE_CHANGED", &match));
-    // TODO: continue relaxing the code by printing useful info of the error before returning
     if (match) {
-        ERR_CHECK(json_obj_get_object(&jctx, "event"));
-        ERR_CHECK(json_obj_get_object(&jctx, "state"));
-    initial_state:
-        ERR_CHECK(json_obj_get_object(&jctx, "item"));
-        ERR_CHECK(json_obj_match_string(&jctx, "id", (*track)->id, &match));
-        if (match) {
-            ERR_CHECK(json_obj_leave_object(&jctx));
-            spotify_evt.player_event = SAME_TRACK;
-            spotify_evt.payload = *track;
-            int64_t progress;
-            ERR_CHECK(json_obj_get_int64(&jctx, "progress_ms", &progress));
-            if (progress != (*track)->progress_ms) {
-                (*track)->progress_ms = progress;
-            }
-            bool is_playing;
-            ERR_CHECK(json_obj_get_bool(&jctx, "is_playing", &is_playing));
-            if (is_playing != (*track)->isPlaying) {
-                (*track)->isPlaying = is_playing;
-            }
-            parse_device_volume(&jctx, *track);
-        } else {
-            spotify_evt.player_event = NEW_TRACK;
-            spotify_evt.payload = *track;
-            spotify_clear_track(*track);
-            ERR_CHECK(json_obj_get_string(&jctx, "id", (*track)->id, SPOTIFY_ID_BUF_SIZE));
-            ERR_CHECK(json_obj_dup_string(&jctx, "name", &(*track)->name));
-            ERR_CHECK(json_obj_get_int64(&jctx, "duration_ms", &(*track)->duration_ms));
-            ERR_CHECK(json_obj_get_array(&jctx, "artists", &num_elem));
-            for (int i = 0; i < num_elem; i++) {
-                ERR_CHECK(json_arr_get_object(&jctx, i));
-                char* artist_name;
-                ERR_CHECK(json_obj_dup_string(&jctx, "name", &artist_name));
-                if (!spotify_append_item_to_list(&(*track)->artists, artist_name)) {
-                    ESP_LOGE(TAG, "Out of memory appending artist, track will have a partial artist list");
-                    free(artist_name);
-                    ERR_CHECK(json_arr_leave_object(&jctx));
-                    break;
-                }
-                ERR_CHECK(json_arr_leave_object(&jctx));
-            }
-            ERR_CHECK(json_obj_leave_array(&jctx));
-            ERR_CHECK(json_obj_get_object(&jctx, "album"));
-            ERR_CHECK(json_obj_dup_string(&jctx, "name", &(*track)->album.name));
-            ERR_CHECK(json_obj_get_array(&jctx, "images", &num_elem));
-            // Pick the image closest to ALBUM_COVER_PREFERRED_SIZE instead of
-            // requiring an exact match (episodes and some releases don't
-            // offer every size) - first pass just finds the best index/height,
-            // second pass re-enters that one index to dup its "url" (jsmn's
-            // parent-linked tokens support random access, so this is safe).
-            int best_idx = -1, best_height = 0, best_diff = INT_MAX;
-            for (int i = 0; i < num_elem; i++) {
-                ERR_CHECK(json_arr_get_object(&jctx, i));
-                int h;
-                ERR_CHECK(json_obj_get_int(&jctx, "height", &h));
-                int diff = abs(h - ALBUM_COVER_PREFERRED_SIZE);
-                if (diff < best_diff) {
-                    best_diff = diff;
-                    best_idx = i;
-                    best_height = h;
-                }
-                ERR_CHECK(json_arr_leave_object(&jctx));
-                if (diff == 0) {
-                    break;
-                }
-            }
-            if (best_idx >= 0) {
-                ERR_CHECK(json_arr_get_object(&jctx, best_idx));
-                ERR_CHECK(json_obj_dup_string(&jctx, "url", &(*track)->album.url_cover));
-                ERR_CHECK(json_arr_leave_object(&jctx));
-                (*track)->album.cover_size = best_height;
-                if (best_height != ALBUM_COVER_PREFERRED_SIZE) {
-                    ESP_LOGW(TAG, "No %dpx cover among %d image(s) for track \"%s\"; using closest available (%dpx)",
-                             ALBUM_COVER_PREFERRED_SIZE, num_elem, (*track)->name, best_height);
-                }
-            } else {
-                ESP_LOGW(TAG, "No usable cover image among %d image(s) for track \"%s\"",
-                         num_elem, (*track)->name);
-            }
-            ERR_CHECK(json_obj_leave_array(&jctx));
-            ERR_CHECK(json_obj_leave_object(&jctx));
-            ERR_CHECK(json_obj_leave_object(&jctx));
-            ERR_CHECK(json_obj_get_int64(&jctx, "progress_ms", &(*track)->progress_ms));
-            ERR_CHECK(json_obj_get_bool(&jctx, "is_playing", &(*track)->isPlaying));
-            parse_device_volume(&jctx, *track);
+        if (json_obj_get_object(&jctx, "event") != OS_SUCCESS ||
+            json_obj_get_object(&jctx, "state") != OS_SUCCESS) {
+            ESP_LOGE(TAG, "PLAYER_STATE_CHANGED without an \"event\".\"state\" object:\n%s", js);
+            return spotify_evt;
         }
-
-        return spotify_evt;
+        return parse_player_state(js, &jctx, jctx.cur - jctx.tokens, track);
     }
     // unknow event
     spotify_evt.player_event = UNKNOW;
     return spotify_evt;
 }
 
+bool parse_ws_track_id(const char *js, char *id)
+{
+    ws_classify_t st = { .matched = 0 };
+    ws_classify(js, &st);
+    if (st.mismatch || !st.uri_ok || !st.type_ok || !st.id_ok) {
+        return false;
+    }
+    strcpy(id, st.id);
+    return true;
+}
+
 /* Private functions ---------------------------------------------------------*/
-/* "device" is a sibling of "item" at the state level (both branches of
- * parse_track() are back there after leaving "item"). Some payloads omit
+/* json_parse_start_arena() plus the per-kind peak bookkeeping behind
+ * spotify_client_get_parse_stats(). A new peak is logged, so undersized
+ * caps and unexpectedly large responses show up in field logs too. */
+static int parse_start(jparse_ctx_t *jctx, const char *js, parse_scratch_t *scratch, spotify_parse_kind_t kind)
+{
+    if (json_parse_start_arena(jctx, js, strlen(js), &scratch->arena) != OS_SUCCESS) {
+        scratch->stats.failed++;
+        return -OS_FAIL;
+    }
+    if (jctx->num_tokens > scratch->stats.peak_tokens[kind]) {
+        scratch->stats.peak_tokens[kind] = jctx->num_tokens;
+        ESP_LOGI(TAG, "New peak for %s responses: %d tokens (arena: %d of max %d)",
+                 parse_kind_names[kind], jctx->num_tokens, scratch->arena.capacity, MAX_TOKENS);
+    }
+    scratch->stats.arena_tokens = scratch->arena.capacity;
+    return OS_SUCCESS;
+}
+
+/* Second half of parse_track(): the player state object at token `root`
+ * (GET /me/player's whole response, or a WS event's "state"), pulled out
+ * in one pass by the generated extract_player_state(). A state without a
+ * usable "item" (e.g. an ad, or nothing playing) is UNKNOW, the track is
+ * then left as it was. A new track gets a new snapshot in *track; the same
+ * one only gets its progress/play state/volume changed, in a copy if the
+ * current snapshot was published (track_snapshot_writable()). */
+static SpotifyEvent_t parse_player_state(const char *js, const jparse_ctx_t *jctx, int root, TrackInfo **current)
+{
+    SpotifyEvent_t spotify_evt = { .player_event = UNKNOW };
+    ex_player_state_t state;
+    if (extract_player_state(js, jctx->tokens, jctx->num_tokens, root, &state) != OS_SUCCESS) {
+        ESP_LOGE(TAG, "Player state without the expected fields (%d bytes):\n%s", (int)strlen(js), js);
+        return spotify_evt;
+    }
+    ex_player_state_item_t *item = &state.item;
+    TrackInfo *track;
+    if ((size_t)item->id.len == strlen((*current)->id) && memcmp(item->id.str, (*current)->id, item->id.len) == 0) {
+        return same_track_event(current, &state);
+    }
+
+    // Pick the image closest to ALBUM_COVER_PREFERRED_SIZE instead of
+    // requiring an exact match (episodes and some releases don't offer
+    // every size).
+    int num_images = item->album.images_count;
+    int best_idx = -1, best_diff = INT_MAX;
+    for (int i = 0; i < num_images && best_diff; i++) {
+        int diff = abs(item->album.images[i].height - ALBUM_COVER_PREFERRED_SIZE);
+        if (diff < best_diff) {
+            best_diff = diff;
+            best_idx = i;
+        }
+    }
+
+    // Every string goes into the snapshot's own block: sized from the
+    // escaped lengths, which unescaping only ever shortens.
+    size_t text_size = item->name.len + 1 + item->album.name.len + 1;
+    for (int i = 0; i < item->artists_count; i++) {
+        text_size += item->artists[i].name.len + 1;
+    }
+    if (best_idx >= 0) {
+        text_size += item->album.images[best_idx].url.len + 1;
+    }
+    TrackStrings *strings;
+    if (!(track = track_snapshot_new(item->artists_count, text_size, &strings))) {
+        return spotify_evt;
+    }
+    spotify_evt.player_event = NEW_TRACK;
+    // the device didn't change with the track
+    track->device.volume_percent = (*current)->device.volume_percent;
+    // max_len in the schema already keeps the id within SPOTIFY_ID_BUF_SIZE
+    view_copy(item->id, track->id, SPOTIFY_ID_BUF_SIZE);
+    track->duration_ms = item->duration_ms;
+    strings->name = view_pack(strings, item->name);
+    strings->album_name = view_pack(strings, item->album.name);
+    for (int i = 0; i < item->artists_count; i++) {
+        strings->artists[i] = view_pack(strings, item->artists[i].name);
+    }
+    if (best_idx >= 0) {
+        int best_height = item->album.images[best_idx].height;
+        strings->url_cover = view_pack(strings, item->album.images[best_idx].url);
+        track->album.cover_size = best_height;
+        if (best_height != ALBUM_COVER_PREFERRED_SIZE) {
+            ESP_LOGW(TAG, "No %dpx cover among %d image(s) for track \"%s\"; using closest available (%dpx)",
+                     ALBUM_COVER_PREFERRED_SIZE, num_images, spotify_track_name(track), best_height);
+        }
+    } else {
+        ESP_LOGW(TAG, "No usable cover image among %d image(s) for track \"%s\"",
+                 num_images, spotify_track_name(track));
+    }
+    track->progress_ms = state.progress_ms;
+    track->isPlaying = state.is_playing;
+    parse_device_volume(state.has_device, &state.device, track);
+    spotify_track_unref(*current);
+    *current = track;
+    spotify_evt.payload = (void *)spotify_track_ref(track);
+    return spotify_evt;
+}
+
+/* parse_track()'s shortcut for the push that keeps coming while a track
+ * plays: a PLAYER_STATE_CHANGED for the current track, of which only
+ * progress/play state/volume are read. Plain substring searches instead of
+ * tokenizing the whole message, ~80% of which is the "item" that goes
+ * unused then. The current id must be an "id" after "item" (no other id in
+ * the message is ever a track's), and every key read must occur exactly
+ * once, so it can only be the one state's. Anything else - a NEW_TRACK,
+ * which only pays the search for the id, whitespace between tokens, a
+ * null, several events in one message - returns false and gets the full
+ * parse. */
+static bool parse_same_track_push(const char *js, TrackInfo **current, SpotifyEvent_t *evt)
+{
+    char needle[sizeof("\"id\":\"\"") + SPOTIFY_ID_BUF_SIZE];
+    if (!(*current)->id[0]) {
+        return false;
+    }
+    snprintf(needle, sizeof(needle), "\"id\":\"%s\"", (*current)->id);
+    const char *id = strstr(js, needle);
+    if (!id) {
+        return false;
+    }
+    const char *item = find_once(js, "\"item\":");
+    if (!item || *item != '{' || (id < item && !(id = strstr(item, needle)))) {
+        return false;
+    }
+
+    const char *progress = find_once(js, "\"progress_ms\":");
+    const char *playing = find_once(js, "\"is_playing\":");
+    if (!find_once(js, "\"uri\":\"wss://event\"") || !find_once(js, "\"type\":\"PLAYER_STATE_CHANGED\"") ||
+        !progress || !playing) {
+        return false;
+    }
+    ex_player_state_t state = { .has_device = find_once(js, "\"device\":{") != NULL };
+    // a value up to the next ',' or '}' that's exactly an integer
+    int len = strcspn(progress, ",}");
+    if (!progress[len] || json_str_to_int64(progress, len, &state.progress_ms) != OS_SUCCESS) {
+        return false;
+    }
+    if (strncmp(playing, "true", 4) == 0) {
+        state.is_playing = true;
+    } else if (strncmp(playing, "false", 5) != 0) {
+        return false;
+    }
+    const char *volume = find_once(js, "\"volume_percent\":");
+    if (volume) {
+        len = strcspn(volume, ",}");
+        if (!state.has_device || !volume[len] ||
+            json_str_to_int(volume, len, &state.device.volume_percent) != OS_SUCCESS) {
+            return false;
+        }
+        state.device.has_volume_percent = true;
+    }
+    *evt = same_track_event(current, &state);
+    return true;
+}
+
+/* What follows needle, if the message has it exactly once. A needle that
+ * starts with a key ("key":) can't match inside a string value: there its
+ * quotes would be escaped. */
+static const char *find_once(const char *js, const char *needle)
+{
+    const char *at = strstr(js, needle);
+    size_t len = strlen(needle);
+    if (!at || strstr(at + len, needle)) {
+        return NULL;
+    }
+    return at + len;
+}
+
+/* A SAME_TRACK: the state's progress/play state/volume applied to the
+ * current snapshot, or to a copy if it was published
+ * (track_snapshot_writable()). */
+static SpotifyEvent_t same_track_event(TrackInfo **current, const ex_player_state_t *state)
+{
+    SpotifyEvent_t spotify_evt = { .player_event = UNKNOW };
+    TrackInfo *track = track_snapshot_writable(current);
+    if (!track) {
+        return spotify_evt;
+    }
+    spotify_evt.player_event = SAME_TRACK;
+    track->progress_ms = state->progress_ms;
+    track->isPlaying = state->is_playing;
+    parse_device_volume(state->has_device, &state->device, track);
+    spotify_evt.payload = (void *)spotify_track_ref(track);
+    return spotify_evt;
+}
+
+static void ws_classify(const char *js, ws_classify_t *st)
+{
+    char buf[WS_CLASSIFY_BUF_SIZE];
+    json_stream_t stream;
+    json_stream_init(&stream, buf, sizeof(buf), ws_classify_cb, st);
+    json_stream_feed(&stream, js, strlen(js));
+}
+
+/* json_stream_cb_t of ws_classify(). Same first-wins and
+ * wrong-type-is-missing rules as the generated extractors. */
+static int ws_classify_cb(const json_stream_evt_t *evt, void *arg)
+{
+    ws_classify_t *st = arg;
+    int level = evt->depth - 2;
+    switch (evt->type) {
+    case JSON_STREAM_OBJECT_BEGIN:
+    case JSON_STREAM_ARRAY_BEGIN:
+        if (level == st->matched && level < (int)WS_PATH_LEVELS) {
+            bool match = evt->type == ws_path[level].begin;
+            if (!ws_path[level].key) {
+                match = match && !(st->taken & (1u << level));
+                st->taken |= 1u << level;
+            } else {
+                match = match && KEY_IS(evt, ws_path[level].key);
+            }
+            if (match) {
+                st->matched++;
+            }
+        } else if (st->matched == WS_PATH_LEVELS && evt->depth == WS_DEPTH_IN_STATE &&
+                   evt->type == JSON_STREAM_OBJECT_BEGIN) {
+            st->in_item = KEY_IS(evt, "item");
+        }
+        break;
+    case JSON_STREAM_OBJECT_END:
+    case JSON_STREAM_ARRAY_END:
+        if (st->matched && evt->depth == st->matched + 1) {
+            // the innermost matched container closed
+            st->matched--;
+        } else if (evt->depth == WS_DEPTH_IN_STATE) {
+            st->in_item = false;
+        }
+        break;
+    default:
+        if (!evt->key && st->matched < WS_PATH_LEVELS && !ws_path[st->matched].key &&
+            evt->depth == st->matched + 1) {
+            // a scalar is that array's first element
+            st->taken |= 1u << st->matched;
+        } else if (evt->depth == WS_DEPTH_URI && KEY_IS(evt, "uri")) {
+            st->uri_ok = evt->type == JSON_STREAM_STRING && strcmp(evt->value, "wss://event") == 0;
+            st->mismatch |= !st->uri_ok;
+        } else if (st->matched == WS_LEVEL_EVENT0 + 1 && evt->depth == WS_DEPTH_EVENT0 && KEY_IS(evt, "type") &&
+                   !st->type_ok) {
+            st->type_ok = evt->type == JSON_STREAM_STRING && strcmp(evt->value, "PLAYER_STATE_CHANGED") == 0;
+            st->mismatch |= !st->type_ok;
+        } else if (st->in_item && evt->depth == WS_DEPTH_IN_STATE && KEY_IS(evt, "id") && !st->id_seen) {
+            st->id_seen = true;
+            st->id_ok = evt->type == JSON_STREAM_STRING && !evt->truncated && strlen(evt->value) < sizeof(st->id);
+            if (st->id_ok) {
+                strcpy(st->id, evt->value);
+            }
+        }
+        break;
+    }
+    // done once it's ruled out, or everything asked for is in
+    return st->mismatch || (st->uri_ok && st->type_ok && st->id_ok);
+}
+
+/* "device" is a sibling of "item" at the state level. Some payloads omit
  * "device"/"volume_percent" (e.g. a device without volume control) - skip
  * silently rather than crash (ANALYSIS.md 3.2). volume_percent is left
  * untouched (-1 if never seen, else the last known value) when either key
  * is missing. */
-static void parse_device_volume(jparse_ctx_t *jctx, TrackInfo *track)
+static void parse_device_volume(bool has_device, const ex_player_state_device_t *device, TrackInfo *track)
 {
-    if (json_obj_get_object(jctx, "device") != OS_SUCCESS) {
+    if (!has_device) {
         ESP_LOGI(TAG, "parse_device_volume: no \"device\" object in this payload");
         return;
     }
-    int volume_percent;
-    if (json_obj_get_int(jctx, "volume_percent", &volume_percent) == OS_SUCCESS) {
+    if (device->has_volume_percent) {
         // ESP_LOGI (not D): "PARSE_OBJECT" isn't bumped to DEBUG in main.c,
         // only "spotify_client" is - temporary diagnostic logging for the
         // "does a WS push from another client's volume change carry an
         // updated volume_percent too" question, remove once answered.
-        ESP_LOGI(TAG, "parse_device_volume: volume_percent=%d (was %d)", volume_percent, track->device.volume_percent);
-        track->device.volume_percent = volume_percent;
+        ESP_LOGI(TAG, "parse_device_volume: volume_percent=%d (was %d)", device->volume_percent, track->device.volume_percent);
+        track->device.volume_percent = device->volume_percent;
     }
     else
     {
         ESP_LOGI(TAG, "parse_device_volume: \"device\" present but no \"volume_percent\"");
     }
-    json_obj_leave_object(jctx);
 }
 
 /* static void onDevicePlaying(const char* js)
@@ -492,7 +806,64 @@ static void parse_device_volume(jparse_ctx_t *jctx, TrackInfo *track)
     }
     (*str)[str_len + obj_len] = '\0';
 
-    ESP_LOGI(TAG, "str len: %d", strlen(*str));
+    ESP_LOGI(TAG, "str len: %d", (int)strlen(*str));
 
     return ESP_OK;
 } */
+
+/* The extractors (extract_objects.h) hand out strings as still-escaped
+ * json_str_t views into the response; these turn them into C strings. */
+/* Decoded and NUL-terminated into buf; false (buf untouched) if it
+ * doesn't fit. */
+static bool view_copy(json_str_t view, char *buf, int size)
+{
+    int len = json_unescape(NULL, view.str, view.len);
+    if (len >= size) {
+        return false;
+    }
+    json_unescape(buf, view.str, view.len);
+    buf[len] = '\0';
+    return true;
+}
+
+/* Unescapes view to the end of a TrackStrings block sized for it (see
+ * track_snapshot_new()) and returns its offset. */
+static uint16_t view_pack(TrackStrings *strings, json_str_t view)
+{
+    uint16_t offset = strings->size;
+    char *str = (char *)strings + offset;
+    int len = json_unescape(str, view.str, view.len);
+    str[len] = '\0';
+    strings->size += len + 1;
+    return offset;
+}
+
+/* Decodes in place and shortens the view to match. Only for responses
+ * parsed from a writable buffer (parse_playlist(),
+ * parse_available_devices()). */
+static void view_decode(json_str_t *view)
+{
+    view->len = json_unescape((char *)view->str, view->str, view->len);
+}
+
+/* List items (PlaylistItem_t, DeviceItem_t) are one allocation each: the
+ * struct followed by its strings, copied here one after another from where
+ * view_decode() decoded them. Returns the copy and moves *tail past it. */
+static char *item_str(char **tail, const char *src, int len)
+{
+    char *str = *tail;
+    memcpy(str, src, len);
+    str[len] = '\0';
+    *tail += len + 1;
+    return str;
+}
+
+static void free_search_item(TrackSearchItem_t *item)
+{
+    if (item) {
+        free(item->name);
+        free(item->uri);
+        free(item->artists);
+        free(item);
+    }
+}
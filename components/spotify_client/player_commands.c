@@ -1,6 +1,5 @@
 /* Includes ------------------------------------------------------------------*/
 #include "spotify_client.h"
-#include "esp_heap_caps.h"
 #include "esp_log.h"
 #include "handler_callbacks.h"
 #include "parse_objects.h"
@@ -23,8 +22,7 @@
 #define VOLUME PLAYER "/volume?volume_percent="
 #define SEEK PLAYER "/seek?position_ms="
 #define PLAYERURL(ENDPOINT) "https://api.spotify.com/v1" ENDPOINT
-/* How many results to request from /v1/search - fits a touch-list, keeps
- * SEARCH_HTTP_BUF_SIZE/SEARCH_MAX_TOKENS below from needing to be huge
+/* How many results to request from /v1/search - fits a touch-list
  * (ANALYSIS.md 3.7). */
 #define SEARCH_RESULT_LIMIT 6
 /* "market=from_token" makes Spotify omit each item's bulky
@@ -35,16 +33,14 @@
 /* Max length of the percent-encoded query (encoding only ever grows the
  * raw typed text) - generous for an on-screen keyboard. */
 #define SEARCH_QUERY_ENCODED_MAX 256
-/* Dedicated, on-demand buffer/tokens for spotify_search_tracks() only -
- * full track objects are far bigger than anything else this component
- * parses, so reusing the shared 8KB/1000-token budget would silently
- * truncate results. Freed right after each call (ANALYSIS.md 1.23/3.7). */
-#define SEARCH_HTTP_BUF_SIZE (40 * 1024)
-#define SEARCH_MAX_TOKENS 4000
+/* Scratch for the single string value json_stream holds at a time while
+ * spotify_search_tracks() streams the response (the whole body is never
+ * buffered, see search_results_stream_cb()). Longer names are cut short. */
+#define SEARCH_STREAM_VALUE_MAX 512
 
 /* Private function prototypes -----------------------------------------------*/
-static void free_track(TrackInfo *track_info);
-static inline char *dup_or_null(const char *s);
+static esp_err_t api_acquire(esp_spotify_client_handle_t client, spotify_req_class_t req_class);
+static void api_release(esp_spotify_client_handle_t client);
 static int url_encode(const char *str, char *out, size_t out_size);
 
 /* Locally scoped variables --------------------------------------------------*/
@@ -55,7 +51,7 @@ esp_err_t spotify_play_context_uri(esp_spotify_client_handle_t client, const cha
 {
     esp_err_t err;
     HttpStatus_Code s_code = 0;
-    if (access_token_needs_refresh(client) && (err = get_access_token(client)) != ESP_OK)
+    if ((err = api_acquire(client, SPOTIFY_REQ_TRANSPORT)) != ESP_OK)
     {
         if (status_code)
         {
@@ -63,35 +59,34 @@ esp_err_t spotify_play_context_uri(esp_spotify_client_handle_t client, const cha
         }
         return err;
     }
-    ACQUIRE_LOCK(client->http_buf_lock);
     int str_len = snprintf(client->sprintf_buf, SPRINTF_BUF_SIZE, "{\"context_uri\":\"%s\"}", uri);
     if (str_len < 0 || str_len >= SPRINTF_BUF_SIZE)
     {
         // snprintf already stopped safely at the buffer boundary; bail out
         // instead of sending a truncated/malformed JSON body
         ESP_LOGE(TAG, "Context URI too long for buffer (uri len=%d)", (int)strlen(uri));
-        RELEASE_LOCK(client->http_buf_lock);
+        api_release(client);
         if (status_code)
         {
             *status_code = 0;
         }
         return ESP_ERR_INVALID_SIZE;
     }
-    esp_http_client_set_post_field(client->http_client.handle, client->sprintf_buf, str_len);
-    client->http_client.http_event_cb = json_http_event_cb;
-    err = perform_http_request(client, client->access_token.value, "application/json", PLAYERURL(PLAY_TRACK), HTTP_METHOD_PUT, &s_code);
+    esp_http_client_set_post_field(client->http_pool[SPOTIFY_HTTP_HOST_API].handle, client->sprintf_buf, str_len);
+    client->http_pool[SPOTIFY_HTTP_HOST_API].http_event_cb = json_http_event_cb;
+    err = perform_http_request(client, SPOTIFY_HTTP_HOST_API, client->access_token.value, "application/json", PLAYERURL(PLAY_TRACK), HTTP_METHOD_PUT, &s_code);
     if (err == ESP_OK && s_code == HttpStatus_Unauthorized && get_access_token_locked(client) == ESP_OK)
     {
         // token expired/invalid mid-flight: refresh and retry once, same
         // post field (still set on the handle, unchanged since the first attempt)
-        err = perform_http_request(client, client->access_token.value, "application/json", PLAYERURL(PLAY_TRACK), HTTP_METHOD_PUT, &s_code);
+        err = perform_http_request(client, SPOTIFY_HTTP_HOST_API, client->access_token.value, "application/json", PLAYERURL(PLAY_TRACK), HTTP_METHOD_PUT, &s_code);
     }
-    esp_http_client_set_post_field(client->http_client.handle, NULL, 0);
+    esp_http_client_set_post_field(client->http_pool[SPOTIFY_HTTP_HOST_API].handle, NULL, 0);
     if (status_code)
     {
         *status_code = s_code;
     }
-    RELEASE_LOCK(client->http_buf_lock);
+    api_release(client);
     return err;
 }
 
@@ -103,7 +98,7 @@ esp_err_t spotify_play_track_uri(esp_spotify_client_handle_t client, const char
 {
     esp_err_t err;
     HttpStatus_Code s_code = 0;
-    if (access_token_needs_refresh(client) && (err = get_access_token(client)) != ESP_OK)
+    if ((err = api_acquire(client, SPOTIFY_REQ_TRANSPORT)) != ESP_OK)
     {
         if (status_code)
         {
@@ -111,31 +106,30 @@ esp_err_t spotify_play_track_uri(esp_spotify_client_handle_t client, const char
         }
         return err;
     }
-    ACQUIRE_LOCK(client->http_buf_lock);
     int str_len = snprintf(client->sprintf_buf, SPRINTF_BUF_SIZE, "{\"uris\":[\"%s\"]}", uri);
     if (str_len < 0 || str_len >= SPRINTF_BUF_SIZE)
     {
         ESP_LOGE(TAG, "Track URI too long for buffer (uri len=%d)", (int)strlen(uri));
-        RELEASE_LOCK(client->http_buf_lock);
+        api_release(client);
         if (status_code)
         {
             *status_code = 0;
         }
         return ESP_ERR_INVALID_SIZE;
     }
-    esp_http_client_set_post_field(client->http_client.handle, client->sprintf_buf, str_len);
-    client->http_client.http_event_cb = json_http_event_cb;
-    err = perform_http_request(client, client->access_token.value, "application/json", PLAYERURL(PLAY_TRACK), HTTP_METHOD_PUT, &s_code);
+    esp_http_client_set_post_field(client->http_pool[SPOTIFY_HTTP_HOST_API].handle, client->sprintf_buf, str_len);
+    client->http_pool[SPOTIFY_HTTP_HOST_API].http_event_cb = json_http_event_cb;
+    err = perform_http_request(client, SPOTIFY_HTTP_HOST_API, client->access_token.value, "application/json", PLAYERURL(PLAY_TRACK), HTTP_METHOD_PUT, &s_code);
     if (err == ESP_OK && s_code == HttpStatus_Unauthorized && get_access_token_locked(client) == ESP_OK)
     {
-        err = perform_http_request(client, client->access_token.value, "application/json", PLAYERURL(PLAY_TRACK), HTTP_METHOD_PUT, &s_code);
+        err = perform_http_request(client, SPOTIFY_HTTP_HOST_API, client->access_token.value, "application/json", PLAYERURL(PLAY_TRACK), HTTP_METHOD_PUT, &s_code);
     }
-    esp_http_client_set_post_field(client->http_client.handle, NULL, 0);
+    esp_http_client_set_post_field(client->http_pool[SPOTIFY_HTTP_HOST_API].handle, NULL, 0);
     if (status_code)
     {
         *status_code = s_code;
     }
-    RELEASE_LOCK(client->http_buf_lock);
+    api_release(client);
     return err;
 }
 
@@ -151,7 +145,7 @@ esp_err_t spotify_set_volume(esp_spotify_client_handle_t client, int volume_perc
     {
         volume_percent = 100;
     }
-    if (access_token_needs_refresh(client) && (err = get_access_token(client)) != ESP_OK)
+    if ((err = api_acquire(client, SPOTIFY_REQ_ADJUST)) != ESP_OK)
     {
         if (status_code)
         {
@@ -159,27 +153,34 @@ esp_err_t spotify_set_volume(esp_spotify_client_handle_t client, int volume_perc
         }
         return err;
     }
-    ACQUIRE_LOCK(client->http_buf_lock);
     snprintf(client->sprintf_buf, SPRINTF_BUF_SIZE, "%s%d", PLAYERURL(VOLUME), volume_percent);
-    client->http_client.http_event_cb = json_http_event_cb;
-    err = perform_http_request(client, client->access_token.value, "application/json", client->sprintf_buf, HTTP_METHOD_PUT, &s_code);
+    client->http_pool[SPOTIFY_HTTP_HOST_API].http_event_cb = json_http_event_cb;
+    err = perform_http_request(client, SPOTIFY_HTTP_HOST_API, client->access_token.value, "application/json", client->sprintf_buf, HTTP_METHOD_PUT, &s_code);
     if (err == ESP_OK && s_code == HttpStatus_Unauthorized && get_access_token_locked(client) == ESP_OK)
     {
-        err = perform_http_request(client, client->access_token.value, "application/json", client->sprintf_buf, HTTP_METHOD_PUT, &s_code);
+        err = perform_http_request(client, SPOTIFY_HTTP_HOST_API, client->access_token.value, "application/json", client->sprintf_buf, HTTP_METHOD_PUT, &s_code);
     }
     /* Optimistic update: Spotify's PUT /volume returns 204 with no body, so
      * there's nothing to parse the new value back out of. Only commit it on
      * success, so a failed call doesn't make Device.volume_percent lie about
-     * what the device is actually set to. */
+     * what the device is actually set to. It goes into player_task's next
+     * snapshot, not into one already published (track_lock serializes this
+     * with parse_track()). */
     if (err == ESP_OK && (s_code == HttpStatus_Ok || s_code == HTTP_STATUS_NO_CONTENT))
     {
-        client->track_info->device.volume_percent = volume_percent;
+        ACQUIRE_LOCK(client->track_lock);
+        TrackInfo *track = track_snapshot_writable(&client->track_info);
+        if (track)
+        {
+            track->device.volume_percent = volume_percent;
+        }
+        RELEASE_LOCK(client->track_lock);
     }
     if (status_code)
     {
         *status_code = s_code;
     }
-    RELEASE_LOCK(client->http_buf_lock);
+    api_release(client);
     return err;
 }
 
@@ -191,7 +192,7 @@ esp_err_t spotify_seek_to_position(esp_spotify_client_handle_t client, int posit
     {
         position_ms = 0;
     }
-    if (access_token_needs_refresh(client) && (err = get_access_token(client)) != ESP_OK)
+    if ((err = api_acquire(client, SPOTIFY_REQ_ADJUST)) != ESP_OK)
     {
         if (status_code)
         {
@@ -199,25 +200,30 @@ esp_err_t spotify_seek_to_position(esp_spotify_client_handle_t client, int posit
         }
         return err;
     }
-    ACQUIRE_LOCK(client->http_buf_lock);
     snprintf(client->sprintf_buf, SPRINTF_BUF_SIZE, "%s%d", PLAYERURL(SEEK), position_ms);
-    client->http_client.http_event_cb = json_http_event_cb;
-    err = perform_http_request(client, client->access_token.value, "application/json", client->sprintf_buf, HTTP_METHOD_PUT, &s_code);
+    client->http_pool[SPOTIFY_HTTP_HOST_API].http_event_cb = json_http_event_cb;
+    err = perform_http_request(client, SPOTIFY_HTTP_HOST_API, client->access_token.value, "application/json", client->sprintf_buf, HTTP_METHOD_PUT, &s_code);
     if (err == ESP_OK && s_code == HttpStatus_Unauthorized && get_access_token_locked(client) == ESP_OK)
     {
-        err = perform_http_request(client, client->access_token.value, "application/json", client->sprintf_buf, HTTP_METHOD_PUT, &s_code);
+        err = perform_http_request(client, SPOTIFY_HTTP_HOST_API, client->access_token.value, "application/json", client->sprintf_buf, HTTP_METHOD_PUT, &s_code);
     }
     // Same optimistic-update reasoning as spotify_set_volume: PUT /seek
     // returns 204 with no body.
     if (err == ESP_OK && (s_code == HttpStatus_Ok || s_code == HTTP_STATUS_NO_CONTENT))
     {
-        client->track_info->progress_ms = position_ms;
+        ACQUIRE_LOCK(client->track_lock);
+        TrackInfo *track = track_snapshot_writable(&client->track_info);
+        if (track)
+        {
+            track->progress_ms = position_ms;
+        }
+        RELEASE_LOCK(client->track_lock);
     }
     if (status_code)
     {
         *status_code = s_code;
     }
-    RELEASE_LOCK(client->http_buf_lock);
+    api_release(client);
     return err;
 }
 
@@ -225,7 +231,7 @@ esp_err_t spotify_transfer_playback(esp_spotify_client_handle_t client, const ch
 {
     esp_err_t err;
     HttpStatus_Code s_code = 0;
-    if (access_token_needs_refresh(client) && (err = get_access_token(client)) != ESP_OK)
+    if ((err = api_acquire(client, SPOTIFY_REQ_TRANSPORT)) != ESP_OK)
     {
         if (status_code)
         {
@@ -233,7 +239,6 @@ esp_err_t spotify_transfer_playback(esp_spotify_client_handle_t client, const ch
         }
         return err;
     }
-    ACQUIRE_LOCK(client->http_buf_lock);
     // Deliberately no "play" field: per Spotify's API, omitting it keeps
     // whatever play/pause state playback was already in, just moves it to
     // the new device - confirmed with the user as the wanted behavior
@@ -242,26 +247,26 @@ esp_err_t spotify_transfer_playback(esp_spotify_client_handle_t client, const ch
     if (str_len < 0 || str_len >= SPRINTF_BUF_SIZE)
     {
         ESP_LOGE(TAG, "Device id too long for buffer (len=%d)", (int)strlen(device_id));
-        RELEASE_LOCK(client->http_buf_lock);
+        api_release(client);
         if (status_code)
         {
             *status_code = 0;
         }
         return ESP_ERR_INVALID_SIZE;
     }
-    esp_http_client_set_post_field(client->http_client.handle, client->sprintf_buf, str_len);
-    client->http_client.http_event_cb = json_http_event_cb;
-    err = perform_http_request(client, client->access_token.value, "application/json", PLAYERURL(PLAYER), HTTP_METHOD_PUT, &s_code);
+    esp_http_client_set_post_field(client->http_pool[SPOTIFY_HTTP_HOST_API].handle, client->sprintf_buf, str_len);
+    client->http_pool[SPOTIFY_HTTP_HOST_API].http_event_cb = json_http_event_cb;
+    err = perform_http_request(client, SPOTIFY_HTTP_HOST_API, client->access_token.value, "application/json", PLAYERURL(PLAYER), HTTP_METHOD_PUT, &s_code);
     if (err == ESP_OK && s_code == HttpStatus_Unauthorized && get_access_token_locked(client) == ESP_OK)
     {
-        err = perform_http_request(client, client->access_token.value, "application/json", PLAYERURL(PLAYER), HTTP_METHOD_PUT, &s_code);
+        err = perform_http_request(client, SPOTIFY_HTTP_HOST_API, client->access_token.value, "application/json", PLAYERURL(PLAYER), HTTP_METHOD_PUT, &s_code);
     }
-    esp_http_client_set_post_field(client->http_client.handle, NULL, 0);
+    esp_http_client_set_post_field(client->http_pool[SPOTIFY_HTTP_HOST_API].handle, NULL, 0);
     if (status_code)
     {
         *status_code = s_code;
     }
-    RELEASE_LOCK(client->http_buf_lock);
+    api_release(client);
     return err;
 }
 
@@ -274,26 +279,37 @@ List *spotify_user_playlists(esp_spotify_client_handle_t client)
         return NULL;
     }
     playlists->type = PLAYLIST_LIST;
-    if (access_token_needs_refresh(client) && get_access_token(client) != ESP_OK)
+    if (api_acquire(client, SPOTIFY_REQ_BROWSE) != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to obtain access token");
         free(playlists);
         return NULL;
     }
-    ACQUIRE_LOCK(client->http_buf_lock);
-    client->http_client.user_data.ctx = playlists; // pass the playlists as context to event handler
-    client->http_client.http_event_cb = playlist_http_event_cb;
-    // Defensive: playlist_http_event_cb's scratch state should already be
-    // reset by the previous request's ON_FINISH/DISCONNECTED, but force a
-    // clean slate here too so a second playlist fetch can never start from
-    // state left over by an earlier one.
-    client->http_client.user_data.current_size = 0;
-    client->http_client.user_data.playlist_scan = (playlist_scan_state_t){0};
+    http_conn_t *conn = &client->http_pool[SPOTIFY_HTTP_HOST_API];
+    // The whole response doesn't fit in memory, so only the "items"
+    // elements are cut out of the stream, one at a time, into the API
+    // connection's buffer. Members parse_playlist() never reads are dropped
+    // on the way in so a playlist with a long description or many images
+    // still fits.
+    static const char *const drop_keys[] = {"images", "owner", "tracks", "description", "external_urls", NULL};
+    playlist_filter_state_t state = {.playlists = playlists, .scratch = &client->parse_scratch};
+    json_filter_t filter;
+    json_filter_config_t filter_cfg = {
+        .path = "items[*]",
+        .drop_keys = drop_keys,
+        .buf = (char *)conn->user_data.buffer,
+        .buf_size = (int)conn->user_data.buffer_size,
+        .cb = playlist_filter_cb,
+        .arg = &state,
+    };
+    json_filter_init(&filter, &filter_cfg);
+    conn->user_data.ctx = &filter;
+    conn->http_event_cb = json_filter_http_event_cb;
     HttpStatus_Code status_code;
-    esp_err_t err = perform_http_request(client, client->access_token.value, "application/json", PLAYERURL("/me/playlists?offset=0&limit=50"), HTTP_METHOD_GET, &status_code);
+    esp_err_t err = perform_http_request(client, SPOTIFY_HTTP_HOST_API, client->access_token.value, "application/json", PLAYERURL("/me/playlists?offset=0&limit=50"), HTTP_METHOD_GET, &status_code);
     if (err == ESP_OK && status_code == HttpStatus_Unauthorized && get_access_token_locked(client) == ESP_OK)
     {
-        err = perform_http_request(client, client->access_token.value, "application/json", PLAYERURL("/me/playlists?offset=0&limit=50"), HTTP_METHOD_GET, &status_code);
+        err = perform_http_request(client, SPOTIFY_HTTP_HOST_API, client->access_token.value, "application/json", PLAYERURL("/me/playlists?offset=0&limit=50"), HTTP_METHOD_GET, &status_code);
     }
     if (err != ESP_OK || status_code != HttpStatus_Ok)
     {
@@ -301,11 +317,12 @@ List *spotify_user_playlists(esp_spotify_client_handle_t client)
         {
             ESP_LOGE(TAG, "Error. HTTP Status Code = %d", status_code);
         }
+        spotify_free_nodes(playlists);
         free(playlists);
         playlists = NULL;
     }
-    client->http_client.user_data.ctx = NULL;
-    RELEASE_LOCK(client->http_buf_lock);
+    conn->user_data.ctx = NULL;
+    api_release(client);
     return playlists;
 }
 
@@ -318,24 +335,23 @@ List *spotify_available_devices(esp_spotify_client_handle_t client)
         return NULL;
     }
     devices->type = DEVICE_LIST;
-    if (access_token_needs_refresh(client) && get_access_token(client) != ESP_OK)
+    if (api_acquire(client, SPOTIFY_REQ_BROWSE) != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to obtain access token");
         free(devices);
         return NULL;
     }
-    ACQUIRE_LOCK(client->http_buf_lock);
-    client->http_client.http_event_cb = json_http_event_cb;
+    client->http_pool[SPOTIFY_HTTP_HOST_API].http_event_cb = json_http_event_cb;
     HttpStatus_Code status_code;
-    esp_err_t err = perform_http_request(client, client->access_token.value, "application/json", PLAYERURL(PLAYER "/devices"), HTTP_METHOD_GET, &status_code);
+    esp_err_t err = perform_http_request(client, SPOTIFY_HTTP_HOST_API, client->access_token.value, "application/json", PLAYERURL(PLAYER "/devices"), HTTP_METHOD_GET, &status_code);
     if (err == ESP_OK && status_code == HttpStatus_Unauthorized && get_access_token_locked(client) == ESP_OK)
     {
-        err = perform_http_request(client, client->access_token.value, "application/json", PLAYERURL(PLAYER "/devices"), HTTP_METHOD_GET, &status_code);
+        err = perform_http_request(client, SPOTIFY_HTTP_HOST_API, client->access_token.value, "application/json", PLAYERURL(PLAYER "/devices"), HTTP_METHOD_GET, &status_code);
     }
     if (err == ESP_OK && status_code == HttpStatus_Ok)
     {
-        ESP_LOGD(TAG, "Active devices:\n%s", client->http_client.user_data.buffer);
-        if (parse_available_devices((char *)(client->http_client.user_data.buffer), devices, client->json_tokens) != ESP_OK)
+        ESP_LOGD(TAG, "Active devices:\n%s", client->http_pool[SPOTIFY_HTTP_HOST_API].user_data.buffer);
+        if (parse_available_devices((char *)(client->http_pool[SPOTIFY_HTTP_HOST_API].user_data.buffer), devices, &client->parse_scratch) != ESP_OK)
         {
             spotify_free_nodes(devices);
             free(devices);
@@ -351,7 +367,7 @@ List *spotify_available_devices(esp_spotify_client_handle_t client)
         free(devices);
         devices = NULL;
     }
-    RELEASE_LOCK(client->http_buf_lock);
+    api_release(client);
     return devices;
 }
 
@@ -364,12 +380,6 @@ List *spotify_search_tracks(esp_spotify_client_handle_t client, const char *quer
         return NULL;
     }
     tracks->type = TRACK_LIST;
-    if (access_token_needs_refresh(client) && get_access_token(client) != ESP_OK)
-    {
-        ESP_LOGE(TAG, "Failed to obtain access token");
-        free(tracks);
-        return NULL;
-    }
 
     char encoded_query[SEARCH_QUERY_ENCODED_MAX];
     if (url_encode(query, encoded_query, sizeof(encoded_query)) < 0)
@@ -389,39 +399,44 @@ List *spotify_search_tracks(esp_spotify_client_handle_t client, const char *quer
         return NULL;
     }
 
-    // Dedicated, on-demand buffer/tokens (see SEARCH_HTTP_BUF_SIZE/
-    // SEARCH_MAX_TOKENS above) - freed at the end of this call, never held
-    // onto like the shared per-client buffer/json_tokens are.
-    uint8_t *search_buf = heap_caps_malloc(SEARCH_HTTP_BUF_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    json_tok_t *search_tokens = heap_caps_malloc(SEARCH_MAX_TOKENS * sizeof(json_tok_t), MALLOC_CAP_SPIRAM);
-    if (!search_buf || !search_tokens)
-    {
-        ESP_LOGE(TAG, "Out of memory allocating search buffers");
-        free(search_buf);
-        free(search_tokens);
+    char *value_buf = malloc(SEARCH_STREAM_VALUE_MAX);
+    if (!value_buf)
+    {
+        ESP_LOGE(TAG, "Out of memory allocating search buffer");
         free(tracks);
         return NULL;
     }
+    search_results_state_t search = {.tracks = tracks};
+    json_stream_t stream;
+    json_stream_init(&stream, value_buf, SEARCH_STREAM_VALUE_MAX, search_results_stream_cb, &search);
 
-    ACQUIRE_LOCK(client->http_buf_lock);
-    // Same buffer-swap technique as fetch_album_art: temporarily point the
-    // client's HTTP buffer at our bigger, search-specific one instead of
-    // growing the shared MAX_HTTP_BUFFER every other endpoint uses.
-    uint8_t *buff_backup = client->http_client.user_data.buffer;
-    size_t buff_size_backup = client->http_client.user_data.buffer_size;
-    client->http_client.http_event_cb = json_http_event_cb;
-    client->http_client.user_data.buffer = search_buf;
-    client->http_client.user_data.buffer_size = SEARCH_HTTP_BUF_SIZE;
+    if (api_acquire(client, SPOTIFY_REQ_BROWSE) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to obtain access token");
+        free(value_buf);
+        free(tracks);
+        return NULL;
+    }
+    http_conn_t *conn = &client->http_pool[SPOTIFY_HTTP_HOST_API];
+    conn->http_event_cb = json_stream_http_event_cb;
+    conn->user_data.ctx = &stream;
 
     HttpStatus_Code status_code;
-    esp_err_t err = perform_http_request(client, client->access_token.value, "application/json", url, HTTP_METHOD_GET, &status_code);
+    esp_err_t err = perform_http_request(client, SPOTIFY_HTTP_HOST_API, client->access_token.value, "application/json", url, HTTP_METHOD_GET, &status_code);
     if (err == ESP_OK && status_code == HttpStatus_Unauthorized && get_access_token_locked(client) == ESP_OK)
     {
-        err = perform_http_request(client, client->access_token.value, "application/json", url, HTTP_METHOD_GET, &status_code);
+        err = perform_http_request(client, SPOTIFY_HTTP_HOST_API, client->access_token.value, "application/json", url, HTTP_METHOD_GET, &status_code);
     }
+    conn->user_data.ctx = NULL;
+    api_release(client);
+
     if (err == ESP_OK && status_code == HttpStatus_Ok)
     {
-        if (parse_search_results((char *)search_buf, tracks, search_tokens, SEARCH_MAX_TOKENS) != ESP_OK)
+        if (json_stream_finish(&stream) == -OS_FAIL)
+        {
+            ESP_LOGW(TAG, "Search response incomplete or malformed, keeping the %d results parsed", (int)tracks->count);
+        }
+        if (parse_search_results_finish(&search) != ESP_OK)
         {
             spotify_free_nodes(tracks);
             free(tracks);
@@ -434,20 +449,17 @@ List *spotify_search_tracks(esp_spotify_client_handle_t client, const char *quer
         {
             ESP_LOGE(TAG, "Error. HTTP Status Code = %d", status_code);
         }
+        parse_search_results_finish(&search);
+        spotify_free_nodes(tracks);
         free(tracks);
         tracks = NULL;
     }
 
-    client->http_client.user_data.buffer = buff_backup;
-    client->http_client.user_data.buffer_size = buff_size_backup;
-    RELEASE_LOCK(client->http_buf_lock);
-
-    free(search_buf);
-    free(search_tokens);
+    free(value_buf);
     return tracks;
 }
 
-ssize_t fetch_album_art(esp_spotify_client_handle_t client, TrackInfo *track, uint8_t *out_buf, size_t buf_size)
+ssize_t fetch_album_art(esp_spotify_client_handle_t client, const TrackInfo *track, uint8_t *out_buf, size_t buf_size)
 {
     if (!out_buf)
     {
@@ -455,25 +467,30 @@ ssize_t fetch_album_art(esp_spotify_client_handle_t client, TrackInfo *track, ui
         return ESP_FAIL;
     }
 
-    ACQUIRE_LOCK(client->http_buf_lock);
-    if (!track->album.url_cover)
+    const char *url = spotify_track_cover_url(track);
+    if (!url)
     {
         ESP_LOGE(TAG, "No cover url");
-        RELEASE_LOCK(client->http_buf_lock);
         return ESP_FAIL;
     }
-    uint8_t *buff_backup = client->http_client.user_data.buffer;
-    size_t buff_size_backup = client->http_client.user_data.buffer_size;
-    client->http_client.http_event_cb = default_http_event_cb;
-    client->http_client.user_data.buffer = out_buf;
-    client->http_client.user_data.buffer_size = buf_size;
+    /* Cover art has its own connection (i.scdn.co) with no buffer of its
+     * own: the caller's out_buf is lent to it for the duration of the
+     * request, and the API connection is left untouched (and open). It's
+     * also a lane of its own, so API requests and player_task go on while
+     * a cover downloads. */
+    http_sched_acquire(&client->http_sched, HTTP_LANE_IMAGE, SPOTIFY_REQ_IMAGE);
+    http_conn_t *conn = &client->http_pool[SPOTIFY_HTTP_HOST_IMAGE];
+    conn->http_event_cb = default_http_event_cb;
+    conn->user_data.buffer = out_buf;
+    conn->user_data.buffer_size = buf_size;
+    conn->user_data.current_size = 0;
     ssize_t data_read = ESP_FAIL;
 
     HttpStatus_Code status_code;
-    esp_err_t err = perform_http_request(client, NULL, NULL, track->album.url_cover, HTTP_METHOD_GET, &status_code);
+    esp_err_t err = perform_http_request(client, SPOTIFY_HTTP_HOST_IMAGE, NULL, NULL, url, HTTP_METHOD_GET, &status_code);
     if (err == ESP_OK)
     {
-        int64_t length = esp_http_client_get_content_length(client->http_client.handle);
+        int64_t length = esp_http_client_get_content_length(conn->handle);
         ESP_LOGD(TAG, "content_length = %" PRId64, length);
         if (length > buf_size)
         {
@@ -485,87 +502,38 @@ ssize_t fetch_album_art(esp_spotify_client_handle_t client, TrackInfo *track, ui
         }
         else
         {
-            data_read = client->http_client.user_data.current_size;
+            data_read = conn->user_data.current_size;
         }
     }
-    // restore the buffer
-    client->http_client.user_data.buffer = buff_backup;
-    client->http_client.user_data.buffer_size = buff_size_backup;
-    RELEASE_LOCK(client->http_buf_lock);
+    // out_buf is the caller's again
+    conn->user_data.buffer = NULL;
+    conn->user_data.buffer_size = 0;
+    http_sched_release(&client->http_sched, HTTP_LANE_IMAGE);
     return data_read;
 }
 
-void spotify_clear_track(TrackInfo *track)
-{
-    if (!track)
-    {
-        return;
-    }
-    free_track(track);
-    track->id[0] = 0;
-    track->isPlaying = false;
-    track->progress_ms = 0;
-    track->duration_ms = 0;
-}
-
-esp_err_t spotify_clone_track(TrackInfo *dest, const TrackInfo *src)
-{
-    strcpy(dest->id, src->id);
-    dest->name = dup_or_null(src->name);
-    dest->album.name = dup_or_null(src->album.name);
-    dest->album.url_cover = dup_or_null(src->album.url_cover);
-    dest->album.cover_size = src->album.cover_size;
-    dest->isPlaying = src->isPlaying;
-    dest->progress_ms = src->progress_ms;
-    dest->duration_ms = src->duration_ms;
-    dest->device.volume_percent = src->device.volume_percent;
-    /* dest->device.id = strdup(src->device.id);
-    dest->device.type = strdup(src->device.type); */
-    Node *node = src->artists.first;
-    while (node)
-    {
-        char *artist = strdup((char *)node->data);
-        if (!artist || !spotify_append_item_to_list(&dest->artists, (void *)artist))
-        {
-            ESP_LOGE(TAG, "Out of memory cloning artist list, clone will be partial");
-            free(artist);
-            break;
-        }
-        node = node->next;
-    }
-    return ESP_OK;
-}
-
-/* player_task.c */
-bool bits_to_player_cmd(uint32_t bit, PlayerCommand_t *out_cmd)
+/* player_task.c. A PAUSE_UNPAUSE's payload is an int, PLAY or PAUSE (NULL:
+ * whichever the current track calls for); when a 403 makes it fall back to
+ * the other one, it's updated to the one actually sent. */
+esp_err_t player_cmd(esp_spotify_client_handle_t client, PlayerCommand_t cmd, void *payload, HttpStatus_Code *status_code)
 {
-    switch (bit)
-    {
-    case DO_PLAY:
-        *out_cmd = PLAY;
-        return true;
-    case DO_PAUSE:
-        *out_cmd = PAUSE;
-        return true;
-    case DO_PAUSE_UNPAUSE:
-        *out_cmd = PAUSE_UNPAUSE;
-        return true;
-    case DO_PREVIOUS:
-        *out_cmd = PREVIOUS;
-        return true;
-    case DO_NEXT:
-        *out_cmd = NEXT;
-        return true;
-    default:
-        return false;
-    }
+    http_sched_acquire(&client->http_sched, HTTP_LANE_SHARED, cmd == GET_STATE ? SPOTIFY_REQ_STATE : SPOTIFY_REQ_TRANSPORT);
+    esp_err_t err = player_cmd_locked(client, cmd, payload, status_code);
+    api_release(client);
+    return err;
 }
 
-esp_err_t player_cmd(esp_spotify_client_handle_t client, PlayerCommand_t cmd, void *payload, HttpStatus_Code *status_code)
+/**
+ * @brief Same as player_cmd(), but assumes HTTP_LANE_SHARED is already held
+ * by the caller. For GET_STATE, whose response is parsed straight out of
+ * the API connection's buffer: the lane has to stay held until that's
+ * done, or another request (an _async one, say) could overwrite the buffer
+ * in between.
+ */
+esp_err_t player_cmd_locked(esp_spotify_client_handle_t client, PlayerCommand_t cmd, void *payload, HttpStatus_Code *status_code)
 {
     esp_err_t err;
     HttpStatus_Code s_code = 0;
-    ACQUIRE_LOCK(client->http_buf_lock);
     esp_http_client_method_t method = HTTP_METHOD_GET;
     const char *url = NULL;
     switch (cmd)
@@ -580,14 +548,16 @@ esp_err_t player_cmd(esp_spotify_client_handle_t client, PlayerCommand_t cmd, vo
         break;
     case PAUSE_UNPAUSE:
         method = HTTP_METHOD_PUT;
-        if (client->track_info->isPlaying)
+        if (payload)
         {
-            url = PLAYERURL(PAUSE_TRACK);
-        }
-        else
-        {
-            url = PLAYERURL(PLAY_TRACK);
+            // PLAY or PAUSE, as decided when the tap was given
+            // (optimistic_resolve_toggle())
+            url = *(const int *)payload == PLAY ? PLAYERURL(PLAY_TRACK) : PLAYERURL(PAUSE_TRACK);
+            break;
         }
+        ACQUIRE_LOCK(client->track_lock);
+        url = client->track_info->isPlaying ? PLAYERURL(PAUSE_TRACK) : PLAYERURL(PLAY_TRACK);
+        RELEASE_LOCK(client->track_lock);
         break;
     case PREVIOUS:
         method = HTTP_METHOD_POST;
@@ -608,35 +578,62 @@ esp_err_t player_cmd(esp_spotify_client_handle_t client, PlayerCommand_t cmd, vo
         {
             *status_code = s_code;
         }
-        RELEASE_LOCK(client->http_buf_lock);
         return err;
     }
-    client->http_client.http_event_cb = json_http_event_cb;
-    err = perform_http_request(client, client->access_token.value, "application/json", url, method, &s_code);
+    client->http_pool[SPOTIFY_HTTP_HOST_API].http_event_cb = json_http_event_cb;
+    err = perform_http_request(client, SPOTIFY_HTTP_HOST_API, client->access_token.value, "application/json", url, method, &s_code);
     if (err == ESP_OK)
     {
-        ESP_LOGD(TAG, "%s", client->http_client.user_data.buffer);
-        ESP_LOGD(TAG, "curr size %d", client->http_client.user_data.current_size);
+        ESP_LOGD(TAG, "%s", client->http_pool[SPOTIFY_HTTP_HOST_API].user_data.buffer);
+        ESP_LOGD(TAG, "curr size %d", client->http_pool[SPOTIFY_HTTP_HOST_API].user_data.current_size);
         /* Swap play<->pause and retry exactly once: a non-Premium account (or
          * any persistent condition) may return 403 on both endpoints, so this
          * must not loop back on itself (unlike the goto-based version this
          * replaced, which could hang player_task forever holding
-         * http_buf_lock). */
+         * the API connection). */
         if (s_code == HttpStatus_Forbidden && cmd == PAUSE_UNPAUSE)
         {
-            url = (strcmp(url, PLAYERURL(PAUSE_TRACK)) == 0) ? PLAYERURL(PLAY_TRACK) : PLAYERURL(PAUSE_TRACK);
-            err = perform_http_request(client, client->access_token.value, "application/json", url, method, &s_code);
+            bool pause = strcmp(url, PLAYERURL(PAUSE_TRACK)) != 0;
+            url = pause ? PLAYERURL(PAUSE_TRACK) : PLAYERURL(PLAY_TRACK);
+            if (payload)
+            {
+                // tell the caller, whose prediction was the other one
+                *(int *)payload = pause ? PAUSE : PLAY;
+            }
+            err = perform_http_request(client, SPOTIFY_HTTP_HOST_API, client->access_token.value, "application/json", url, method, &s_code);
         }
     }
     if (status_code)
     {
         *status_code = s_code;
     }
-    RELEASE_LOCK(client->http_buf_lock);
     return err;
 }
 
 /* Private functions ---------------------------------------------------------*/
+/* Waits for the API connection (HTTP_LANE_SHARED) in req_class's turn, then
+ * gets a new access token if it's due, without letting go of it in
+ * between. Nothing is held on failure. */
+static esp_err_t api_acquire(esp_spotify_client_handle_t client, spotify_req_class_t req_class)
+{
+    http_sched_acquire(&client->http_sched, HTTP_LANE_SHARED, req_class);
+    if (access_token_needs_refresh(client))
+    {
+        esp_err_t err = get_access_token_locked(client);
+        if (err != ESP_OK)
+        {
+            http_sched_release(&client->http_sched, HTTP_LANE_SHARED);
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+static void api_release(esp_spotify_client_handle_t client)
+{
+    http_sched_release(&client->http_sched, HTTP_LANE_SHARED);
+}
+
 /* Percent-encodes str into out (RFC 3986 unreserved chars pass through
  * as-is, everything else becomes %XX) for embedding as a URL query value -
  * needed for spotify_search_tracks()'s free-text query (spaces, accents,
@@ -674,54 +671,3 @@ static int url_encode(const char *str, char *out, size_t out_size)
     return (int)j;
 }
 
-/* strdup(NULL) is undefined behavior; album.url_cover in particular is
- * legitimately NULL whenever none of the album's images is exactly 300px
- * (see parse_track), so callers can't assume these fields are non-NULL. */
-static inline char *dup_or_null(const char *s)
-{
-    return s ? strdup(s) : NULL;
-}
-
-static inline void free_track(TrackInfo *track)
-{
-    if (!track)
-    {
-        return;
-    }
-    if (track->name)
-    {
-        free(track->name);
-        track->name = NULL;
-    }
-    if (track->album.name)
-    {
-        free(track->album.name);
-        track->album.name = NULL;
-    }
-    if (track->album.url_cover)
-    {
-        free(track->album.url_cover);
-        track->album.url_cover = NULL;
-        track->album.cover_size = 0;
-    }
-    if (track->artists.first)
-    {
-        spotify_free_nodes(&track->artists);
-    }
-    if (track->device.id)
-    {
-        free(track->device.id);
-        track->device.id = NULL;
-    }
-    if (track->device.name)
-    {
-        free(track->device.name);
-        track->device.name = NULL;
-    }
-    if (track->device.type)
-    {
-        free(track->device.type);
-        track->device.type = NULL;
-    }
-    track->device.volume_percent = -1;
-}
@@ -10,6 +10,10 @@
 
 /* Private function prototypes -----------------------------------------------*/
 static esp_err_t confirm_ws_session(esp_spotify_client_handle_t client, char *conn_id);
+static void run_command(esp_spotify_client_handle_t client, const queued_cmd_t *cmd);
+static void reconcile(esp_spotify_client_handle_t client, const SpotifyEvent_t *evt);
+static void undo_prediction(esp_spotify_client_handle_t client, int cmd);
+static void repredict(esp_spotify_client_handle_t client, int cmd, int sent);
 
 /* Locally scoped variables --------------------------------------------------*/
 static const char *TAG = "spotify_client";
@@ -20,14 +24,14 @@ void player_task(void *pvParameters)
     esp_spotify_client_handle_t client = pvParameters;
     int first_msg = 1;
     int enabled = 0;
+    int volume;
     SpotifyEvent_t spotify_evt;
     EventBits_t uxBits;
-    int player_bits = DO_PLAY | DO_PAUSE | DO_PREVIOUS | DO_NEXT | DO_PAUSE_UNPAUSE;
     while (1)
     {
         uxBits = xEventGroupWaitBits(
             client->ws_client.event_group,
-            ENABLE_PLAYER | DISABLE_PLAYER | WS_DATA_EVENT | WS_DISCONNECT_EVENT | WS_DATA_CONSUMED | player_bits,
+            ENABLE_PLAYER | DISABLE_PLAYER | WS_DATA_EVENT | WS_DISCONNECT_EVENT | PLAYER_CMD_EVENT,
             pdTRUE,
             pdFALSE,
             portMAX_DELAY);
@@ -36,43 +40,25 @@ void player_task(void *pvParameters)
         // event freeze) - remove once resolved.
         ESP_LOGI(TAG, "player_task woke up, uxBits=0x%04lx", (unsigned long)uxBits);
 
-        if (uxBits & player_bits)
+        if (uxBits & PLAYER_CMD_EVENT)
         {
-            if (!enabled)
+            /* Everything queued since the last wake-up, in order and back
+             * to back (the API connection is kept alive in between). Not
+             * a `continue` afterwards: whatever else woke us up is handled
+             * below, its bit is already cleared. */
+            queued_cmd_t cmd;
+            while (cmd_queue_pop(&client->cmd_queue, &cmd))
             {
-                ESP_LOGW(TAG, "Task disabled");
-                continue;
-            }
-            uint32_t n = uxBits & player_bits;
-            PlayerCommand_t cmd;
-            if ((n & (n - 1)) != 0 || !bits_to_player_cmd(n, &cmd))
-            { // check that only a bit was set, and that it maps to a command
-                ESP_LOGW(TAG, "Invalid command");
-                continue;
-            }
-            HttpStatus_Code s_code;
-            esp_err_t err = player_cmd(client, cmd, NULL, &s_code);
-            if (err == ESP_OK && s_code == HttpStatus_Unauthorized)
-            {
-                if ((err = get_access_token(client)) == ESP_OK)
+                if (!enabled)
                 {
-                    err = player_cmd(client, cmd, NULL, &s_code);
+                    ESP_LOGW(TAG, "Task disabled, dropping command %d", cmd.cmd);
+                    undo_prediction(client, cmd.cmd);
+                    continue;
                 }
+                run_command(client, &cmd);
             }
-            // s_code >= HttpStatus_BadRequest also catches e.g. 403 Forbidden
-            // (non-Premium accounts) - report it instead of silently doing
-            // nothing (ANALYSIS.md 3.4).
-            if (err != ESP_OK || s_code >= HttpStatus_BadRequest)
-            {
-                ESP_LOGE(TAG, "Player command failed (cmd=%d, http_status=%d)", cmd, s_code);
-                spotify_evt.player_event = PLAYER_ERROR;
-                spotify_evt.payload = NULL;
-                spotify_evt.error_code = (err == ESP_OK) ? s_code : 0;
-                xQueueSend(client->event_queue, &spotify_evt, portMAX_DELAY);
-            }
-            continue;
         }
-        else if (uxBits & (ENABLE_PLAYER | WS_DISCONNECT_EVENT))
+        if (uxBits & (ENABLE_PLAYER | WS_DISCONNECT_EVENT))
         {
             if (uxBits & ENABLE_PLAYER)
             {
@@ -84,45 +70,57 @@ void player_task(void *pvParameters)
                 enabled = 1;
             }
             first_msg = 1;
+            // whatever the previous session left queued is stale now
+            ws_ring_flush(&client->ws_client.ring);
             if (get_access_token(client) != ESP_OK)
             {
                 ESP_LOGE(TAG, "Failed to obtain access token, player left disabled");
                 spotify_evt.player_event = PLAYER_ERROR;
                 spotify_evt.payload = NULL;
                 spotify_evt.error_code = 0;
-                xQueueSend(client->event_queue, &spotify_evt, portMAX_DELAY);
+                event_queue_push(&client->event_queue, &spotify_evt);
                 enabled = 0;
                 continue;
             }
             // if there is a device atached to playback,
             // instead of wait for an event from ws, we
-            // send a "fake" NEW_TRACK event
+            // send a "fake" NEW_TRACK event. The lane is held from the
+            // request until the response is parsed out of the API buffer.
             HttpStatus_Code status_code;
-            if (player_cmd(client, GET_STATE, NULL, &status_code) != ESP_OK)
+            http_sched_acquire(&client->http_sched, HTTP_LANE_SHARED, SPOTIFY_REQ_STATE);
+            if (player_cmd_locked(client, GET_STATE, NULL, &status_code) != ESP_OK)
             {
+                http_sched_release(&client->http_sched, HTTP_LANE_SHARED);
                 ESP_LOGE(TAG, "Failed to fetch player state, player left disabled");
                 spotify_evt.player_event = PLAYER_ERROR;
                 spotify_evt.payload = NULL;
                 spotify_evt.error_code = 0;
-                xQueueSend(client->event_queue, &spotify_evt, portMAX_DELAY);
+                event_queue_push(&client->event_queue, &spotify_evt);
                 enabled = 0;
                 continue;
             }
             if (status_code == HttpStatus_Ok)
             {
                 // maybe free track??
-                ACQUIRE_LOCK(client->http_buf_lock);
-                spotify_evt = parse_track((char *)(client->http_client.user_data.buffer), &client->track_info, 1, client->json_tokens);
-                RELEASE_LOCK(client->http_buf_lock);
-                ESP_LOGI(TAG, "GET_STATE -> parse_track type=%d, volume_percent=%d", spotify_evt.player_event, client->track_info->device.volume_percent);
-                xQueueSend(client->event_queue, &spotify_evt, portMAX_DELAY);
+                ACQUIRE_LOCK(client->track_lock);
+                spotify_evt = parse_track((char *)(client->http_pool[SPOTIFY_HTTP_HOST_API].user_data.buffer), &client->track_info, 1, &client->parse_scratch);
+                reconcile(client, &spotify_evt);
+                volume = client->track_info->device.volume_percent;
+                RELEASE_LOCK(client->track_lock);
+            }
+            http_sched_release(&client->http_sched, HTTP_LANE_SHARED);
+            if (status_code == HttpStatus_Ok)
+            {
+                ESP_LOGI(TAG, "GET_STATE -> parse_track type=%d, volume_percent=%d", spotify_evt.player_event, volume);
+                event_queue_push(&client->event_queue, &spotify_evt);
             }
             else if (status_code == HTTP_STATUS_NO_CONTENT)
             {
                 // no device is atached to playback,
                 // fire an event of no device playing
                 spotify_evt.player_event = NO_PLAYER_ACTIVE;
-                xQueueSend(client->event_queue, &spotify_evt, portMAX_DELAY);
+                spotify_evt.payload = NULL;
+                event_queue_push(&client->event_queue, &spotify_evt);
             }
             else
             {
@@ -135,7 +133,7 @@ void player_task(void *pvParameters)
                 spotify_evt.player_event = PLAYER_ERROR;
                 spotify_evt.payload = NULL;
                 spotify_evt.error_code = status_code;
-                xQueueSend(client->event_queue, &spotify_evt, portMAX_DELAY);
+                event_queue_push(&client->event_queue, &spotify_evt);
                 enabled = 0;
                 continue;
             }
@@ -145,19 +143,15 @@ void player_task(void *pvParameters)
 
             esp_websocket_client_set_uri(client->ws_client.handle, uri); // TODO: fix, on WebSocket Error
             free(uri);
-            esp_websocket_register_events(client->ws_client.handle, WEBSOCKET_EVENT_ANY, default_ws_event_cb, NULL);
+            esp_websocket_register_events(client->ws_client.handle, WEBSOCKET_EVENT_ANY, default_ws_event_cb, client);
             esp_err_t err = esp_websocket_client_start(client->ws_client.handle);
-            if (err == ESP_OK)
-            {
-                xEventGroupSetBits(client->ws_client.event_group, WS_READY_FOR_DATA);
-            }
-            else
+            if (err != ESP_OK)
             {
                 ESP_LOGE(TAG, "Failed to start websocket client, player left disabled");
                 spotify_evt.player_event = PLAYER_ERROR;
                 spotify_evt.payload = NULL;
                 spotify_evt.error_code = 0;
-                xQueueSend(client->event_queue, &spotify_evt, portMAX_DELAY);
+                event_queue_push(&client->event_queue, &spotify_evt);
                 enabled = 0;
                 continue;
             }
@@ -169,80 +163,188 @@ void player_task(void *pvParameters)
         }
         else if (uxBits & WS_DATA_EVENT)
         {
-
-            // now the ws buff is our
-            // analize data of ws event
-
-            if (first_msg)
+            /* No need to wait for the UI between messages: each event carries
+             * its own TrackInfo snapshot, and parse_track() never touches one
+             * it has published. */
+            int msg;
+            const char *js;
+            while ((js = ws_ring_take(&client->ws_client.ring, &msg)))
             {
-                first_msg = 0;
-                char *conn_id = NULL;
-                /* client->json_tokens is also used by the HTTP-side parse_*
-                 * calls under http_buf_lock; take the same lock here so
-                 * this client's own HTTP and WS pipelines don't race on it. */
-                ACQUIRE_LOCK(client->http_buf_lock);
-                parse_connection_id((char *)client->ws_client.user_data.buffer, &conn_id, client->json_tokens);
-                RELEASE_LOCK(client->http_buf_lock);
-                if (!conn_id)
+                if (first_msg)
                 {
-                    ESP_LOGE(TAG, "Failed to parse websocket connection id, disabling player");
-                    spotify_evt.player_event = PLAYER_ERROR;
-                    spotify_evt.payload = NULL;
-                    spotify_evt.error_code = 0;
-                    xQueueSend(client->event_queue, &spotify_evt, portMAX_DELAY);
-                    enabled = 0;
-                    esp_websocket_client_close(client->ws_client.handle, portMAX_DELAY);
-                    continue;
+                    first_msg = 0;
+                    char *conn_id = NULL;
+                    /* WebSocket messages have their own scratch: parsing them
+                     * never waits for a request holding HTTP_LANE_SHARED. */
+                    ACQUIRE_LOCK(client->track_lock);
+                    esp_err_t err = parse_connection_id(js, &conn_id, &client->ws_parse_scratch);
+                    RELEASE_LOCK(client->track_lock);
+                    ws_ring_release(&client->ws_client.ring, msg);
+                    if (err != ESP_OK)
+                    {
+                        ESP_LOGE(TAG, "Failed to parse websocket connection id, disabling player");
+                        spotify_evt.player_event = PLAYER_ERROR;
+                        spotify_evt.payload = NULL;
+                        spotify_evt.error_code = 0;
+                        event_queue_push(&client->event_queue, &spotify_evt);
+                        enabled = 0;
+                        esp_websocket_client_close(client->ws_client.handle, portMAX_DELAY);
+                        break;
+                    }
+                    ESP_LOGD(TAG, "Connection id: '%s'", conn_id);
+                    if (confirm_ws_session(client, conn_id) != ESP_OK)
+                    {
+                        ESP_LOGE(TAG, "Failed to confirm websocket session, disabling player");
+                        spotify_evt.player_event = PLAYER_ERROR;
+                        spotify_evt.payload = NULL;
+                        spotify_evt.error_code = 0;
+                        event_queue_push(&client->event_queue, &spotify_evt);
+                        enabled = 0;
+                        esp_websocket_client_close(client->ws_client.handle, portMAX_DELAY);
+                        break;
+                    }
                 }
-                ESP_LOGD(TAG, "Connection id: '%s'", conn_id);
-                if (confirm_ws_session(client, conn_id) != ESP_OK)
+                else
                 {
-                    ESP_LOGE(TAG, "Failed to confirm websocket session, disabling player");
-                    spotify_evt.player_event = PLAYER_ERROR;
-                    spotify_evt.payload = NULL;
-                    spotify_evt.error_code = 0;
-                    xQueueSend(client->event_queue, &spotify_evt, portMAX_DELAY);
-                    enabled = 0;
-                    esp_websocket_client_close(client->ws_client.handle, portMAX_DELAY);
-                    continue;
+                    ACQUIRE_LOCK(client->track_lock);
+                    spotify_evt = parse_track(js, &client->track_info, 0, &client->ws_parse_scratch);
+                    reconcile(client, &spotify_evt);
+                    volume = client->track_info->device.volume_percent;
+                    RELEASE_LOCK(client->track_lock);
+                    ws_ring_release(&client->ws_client.ring, msg);
+                    ESP_LOGI(TAG, "WS_DATA_EVENT -> parse_track type=%d, volume_percent=%d", spotify_evt.player_event, volume);
+                    event_queue_push(&client->event_queue, &spotify_evt);
                 }
-                xEventGroupSetBits(client->ws_client.event_group, WS_READY_FOR_DATA);
             }
-            else
+        }
+    }
+}
+
+/* Private functions ---------------------------------------------------------*/
+/* One command from cmd_queue. Failures are reported as PLAYER_ERROR, the
+ * caller of player_dispatch_*() having long moved on. */
+static void run_command(esp_spotify_client_handle_t client, const queued_cmd_t *cmd)
+{
+    HttpStatus_Code s_code = 0;
+    esp_err_t err;
+    switch (cmd->cmd)
+    {
+    case SET_VOLUME:
+        err = spotify_set_volume(client, cmd->arg, &s_code);
+        break;
+    case SEEK:
+        err = spotify_seek_to_position(client, cmd->arg, &s_code);
+        break;
+    default:
+    {
+        // a PAUSE_UNPAUSE's arg: which of the two it is, if already known;
+        // player_cmd() changes it if it had to send the other one
+        int sent = cmd->arg;
+        void *payload = sent ? (void *)&sent : NULL;
+        err = player_cmd(client, cmd->cmd, payload, &s_code);
+        if (err == ESP_OK && s_code == HttpStatus_Unauthorized)
+        {
+            if ((err = get_access_token(client)) == ESP_OK)
             {
-                ACQUIRE_LOCK(client->http_buf_lock);
-                spotify_evt = parse_track((char *)client->ws_client.user_data.buffer, &client->track_info, 0, client->json_tokens);
-                RELEASE_LOCK(client->http_buf_lock);
-                ESP_LOGI(TAG, "WS_DATA_EVENT -> parse_track type=%d, volume_percent=%d", spotify_evt.player_event, client->track_info->device.volume_percent);
-                xQueueSend(client->event_queue, &spotify_evt, portMAX_DELAY);
+                err = player_cmd(client, cmd->cmd, payload, &s_code);
             }
         }
-        else if (uxBits & WS_DATA_CONSUMED)
+        if (sent != cmd->arg && err == ESP_OK && s_code < HttpStatus_BadRequest)
         {
-            xEventGroupSetBits(client->ws_client.event_group, WS_READY_FOR_DATA);
-            // now the ws buff isn't our anymore
+            repredict(client, cmd->cmd, sent);
         }
+        break;
+    }
+    }
+    bool failed = err != ESP_OK || s_code >= HttpStatus_BadRequest;
+    /* What the UI was shown when the command was given either holds a
+     * little longer, for the dealer's echo to confirm it, or is undone. */
+    if (failed)
+    {
+        undo_prediction(client, cmd->cmd);
+    }
+    else
+    {
+        ACQUIRE_LOCK(client->track_lock);
+        optimistic_settle(&client->optimistic, cmd->cmd);
+        RELEASE_LOCK(client->track_lock);
+    }
+    // s_code >= HttpStatus_BadRequest also catches e.g. 403 Forbidden
+    // (non-Premium accounts) - report it instead of silently doing
+    // nothing (ANALYSIS.md 3.4).
+    if (failed)
+    {
+        ESP_LOGE(TAG, "Player command failed (cmd=%d, http_status=%d)", cmd->cmd, s_code);
+        SpotifyEvent_t spotify_evt = {
+            .player_event = PLAYER_ERROR,
+            .payload = NULL,
+            .error_code = (err == ESP_OK) ? s_code : 0,
+        };
+        event_queue_push(&client->event_queue, &spotify_evt);
+    }
+}
+
+/* A play/pause went through as the opposite of what dispatch_command()
+ * predicted for it (player_cmd()'s 403 fallback): predicts again, with the
+ * one actually sent, and publishes that - rather than hold the wrong
+ * isPlaying until the server contradicts it for OPTIMISTIC_HOLD_MS. */
+static void repredict(esp_spotify_client_handle_t client, int cmd, int sent)
+{
+    ACQUIRE_LOCK(client->track_lock);
+    const TrackInfo *predicted = optimistic_predict(&client->optimistic, &client->track_info, cmd, sent);
+    if (predicted)
+    {
+        // still under track_lock, so it can't overtake a newer snapshot
+        SpotifyEvent_t evt = {.player_event = SAME_TRACK, .payload = (void *)predicted};
+        event_queue_push(&client->event_queue, &evt);
+    }
+    RELEASE_LOCK(client->track_lock);
+}
+
+/* cmd won't reach Spotify (it failed, or was dropped): takes back what
+ * dispatch_command() predicted for it and publishes the correction, rather
+ * than leave it on screen until the next server snapshot. */
+static void undo_prediction(esp_spotify_client_handle_t client, int cmd)
+{
+    ACQUIRE_LOCK(client->track_lock);
+    const TrackInfo *undone = optimistic_rollback(&client->optimistic, &client->track_info, cmd);
+    RELEASE_LOCK(client->track_lock);
+    if (undone)
+    {
+        SpotifyEvent_t rollback_evt = {.player_event = SAME_TRACK, .payload = (void *)undone};
+        event_queue_push(&client->event_queue, &rollback_evt);
+    }
+}
+
+/* Lets the optimistic layer check a snapshot parse_track() just made
+ * against what it predicted, and patch it, before it's published. Under
+ * track_lock. */
+static void reconcile(esp_spotify_client_handle_t client, const SpotifyEvent_t *evt)
+{
+    if (evt->player_event == SAME_TRACK || evt->player_event == NEW_TRACK)
+    {
+        // evt->payload is client->track_info, not seen by anyone yet
+        optimistic_reconcile(&client->optimistic, client->track_info, evt->player_event == NEW_TRACK);
     }
 }
 
-/* Private functions ---------------------------------------------------------*/
 /* Confirms the WebSocket connection just opened (identified by conn_id, from
  * parse_connection_id) with the REST API, so Spotify starts pushing
  * PLAYER_STATE_CHANGED events over it. Only ever called from player_task
  * above, right after the dealer WebSocket hands out a connection id. */
 static esp_err_t confirm_ws_session(esp_spotify_client_handle_t client, char *conn_id)
 {
-    ACQUIRE_LOCK(client->http_buf_lock);
-    client->http_client.http_event_cb = json_http_event_cb;
+    http_sched_acquire(&client->http_sched, HTTP_LANE_SHARED, SPOTIFY_REQ_STATE);
+    client->http_pool[SPOTIFY_HTTP_HOST_API].http_event_cb = json_http_event_cb;
     char *url = http_utils_join_string("https://api.spotify.com/v1/me/notifications/player?connection_id=", 0, conn_id, 0);
     HttpStatus_Code status_code;
-    esp_err_t err = perform_http_request(client, client->access_token.value, "application/json", url, HTTP_METHOD_PUT, &status_code);
+    esp_err_t err = perform_http_request(client, SPOTIFY_HTTP_HOST_API, client->access_token.value, "application/json", url, HTTP_METHOD_PUT, &status_code);
     free(conn_id);
     free(url);
     if (err == ESP_OK)
     {
         err = (status_code == HttpStatus_Ok) ? ESP_OK : ESP_FAIL;
     }
-    RELEASE_LOCK(client->http_buf_lock);
+    http_sched_release(&client->http_sched, HTTP_LANE_SHARED);
     return err;
 }
@@ -0,0 +1,86 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdatomic.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_err.h"
+#include "esp_http_client.h"
+#include "spotify_client.h"
+
+/* Exported macro ------------------------------------------------------------*/
+/* _async requests waiting behind the one being run. The UI only ever has a
+ * couple in flight (a search, then the track picked from it). */
+#define ASYNC_QUEUE_DEPTH 4
+/* Same as PLAYER_TASK_STACK_SIZE: the worker runs the very calls that
+ * main/'s per-screen tasks used to, with their 8 KB stacks. */
+#define ASYNC_TASK_STACK_SIZE 8192
+/* This component's own esp_err_t codes, past ESP-IDF's ESP_ERR_*_BASE
+ * ranges so they can't be mistaken for one of esp_http_client's. */
+#define SPOTIFY_ERR_BASE 0x1F000
+/* What perform_http_request() returns for a request whose _async call was
+ * cancelled (spotify_request_cancel()) before or while it was sent. */
+#define HTTP_ERR_CANCELLED (SPOTIFY_ERR_BASE + 1)
+/* The timeout spotify_request_cancel() gives the connection the running
+ * request is being sent on: every socket wait of it that starts afterwards
+ * (connect, the first byte, the rest of the body) gives up right away. */
+#define ASYNC_CANCEL_TIMEOUT_MS 1
+
+/* Exported types ------------------------------------------------------------*/
+/* Which blocking call an _async request stands for. */
+typedef enum
+{
+    ASYNC_USER_PLAYLISTS = 0,
+    ASYNC_AVAILABLE_DEVICES,
+    ASYNC_SEARCH_TRACKS,
+    ASYNC_PLAY_CONTEXT_URI,
+    ASYNC_PLAY_TRACK_URI,
+    ASYNC_TRANSFER_PLAYBACK,
+} async_op_t;
+
+typedef struct
+{
+    spotify_request_t id; /* 0: none */
+    async_op_t op;
+    char *arg;            /* the call's string argument (query, uri, device id), a copy */
+    spotify_async_cb_t cb;
+    void *user_ctx;
+} async_req_t;
+
+/* The component's own task that runs _async requests one at a time, in
+ * the order they were made (the HTTP scheduler still puts them in their
+ * class's place among everyone else's requests). */
+typedef struct
+{
+    SemaphoreHandle_t lock;                /* everything below but task */
+    async_req_t pending[ASYNC_QUEUE_DEPTH];
+    int head;                              /* oldest pending request */
+    int count;
+    async_req_t running;                   /* id 0 once its callback is due */
+    /* Set by spotify_request_cancel() for `running`; watched by
+     * perform_http_request() through http_conn_t.cancel. */
+    atomic_bool cancel_running;
+    /* The connection `running` is being sent on, between
+     * async_worker_begin_send() and async_worker_end_send(); NULL
+     * otherwise. */
+    esp_http_client_handle_t sending;
+    spotify_request_t last_id;
+    TaskHandle_t task;
+} async_worker_t;
+
+/* Exported functions prototypes ---------------------------------------------*/
+esp_err_t async_worker_init(esp_spotify_client_handle_t client, UBaseType_t priority);
+void async_worker_deinit(async_worker_t *worker);
+const atomic_bool *async_worker_cancel_flag(async_worker_t *worker);
+bool async_worker_begin_send(async_worker_t *worker, esp_http_client_handle_t handle);
+void async_worker_end_send(async_worker_t *worker);
+
+#ifdef __cplusplus
+}
+#endif
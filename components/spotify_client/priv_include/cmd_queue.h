@@ -0,0 +1,48 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_err.h"
+
+/* Exported macro ------------------------------------------------------------*/
+/* Commands waiting for player_task. Only a burst of taps faster than a
+ * round trip to the API ever queues up, and volume/seek changes take a
+ * single slot however many there are (see cmd_queue_push()). */
+#define CMD_QUEUE_DEPTH 8
+
+/* Exported types ------------------------------------------------------------*/
+/* A player command (PlayerCommand_t, spotify_client_priv.h) and its
+ * argument, if it takes one. */
+typedef struct
+{
+    int cmd;
+    int arg; /* SET_VOLUME: percent; SEEK: position in ms; PAUSE_UNPAUSE:
+              * PLAY or PAUSE, resolved when given (0 if unknown) */
+} queued_cmd_t;
+
+/* player_dispatch_*() -> player_task, in the order they were given. Unlike
+ * the event group bits it replaces, two taps of the same button are two
+ * commands, and commands given before player_task wakes up all run. */
+typedef struct
+{
+    queued_cmd_t cmds[CMD_QUEUE_DEPTH];
+    int head;                /* oldest pending command */
+    int count;
+    SemaphoreHandle_t lock;
+} cmd_queue_t;
+
+/* Exported functions prototypes ---------------------------------------------*/
+esp_err_t cmd_queue_init(cmd_queue_t *queue);
+void cmd_queue_deinit(cmd_queue_t *queue);
+esp_err_t cmd_queue_push(cmd_queue_t *queue, int cmd, int arg);
+bool cmd_queue_pop(cmd_queue_t *queue, queued_cmd_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,42 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_err.h"
+#include "spotify_client.h"
+
+/* Exported macro ------------------------------------------------------------*/
+/* Pending SpotifyEvent_t's. Track events coalesce (one NEW_TRACK and one
+ * SAME_TRACK at most) and UNKNOW ones make room, so this only has to hold
+ * the PLAYER_ERROR/NO_PLAYER_ACTIVE events a slow consumer hasn't got to
+ * yet - one per player command or session start at most. */
+#define EVENT_QUEUE_DEPTH 8
+
+/* Exported types ------------------------------------------------------------*/
+/* What spotify_wait_event() reads from: player_task pushes without ever
+ * waiting for the consumer (the lock is only held to copy an event in or
+ * out), and a newer track event replaces pending ones, so the UI always
+ * gets the freshest state next instead of working through a backlog. */
+typedef struct
+{
+    SpotifyEvent_t events[EVENT_QUEUE_DEPTH];
+    int head;                /* oldest pending event */
+    int count;
+    SemaphoreHandle_t lock;
+    SemaphoreHandle_t ready; /* binary, given on every push */
+} event_queue_t;
+
+/* Exported functions prototypes ---------------------------------------------*/
+esp_err_t event_queue_init(event_queue_t *queue);
+void event_queue_deinit(event_queue_t *queue);
+void event_queue_push(event_queue_t *queue, const SpotifyEvent_t *event);
+BaseType_t event_queue_receive(event_queue_t *queue, SpotifyEvent_t *event, TickType_t ticks_to_wait);
+
+#ifdef __cplusplus
+}
+#endif
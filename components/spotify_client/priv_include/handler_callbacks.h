@@ -13,7 +13,14 @@ extern "C" {
 /* Exported functions prototypes ---------------------------------------------*/
 esp_err_t default_http_event_cb(esp_http_client_event_t* evt);
 esp_err_t json_http_event_cb(esp_http_client_event_t* evt);
-esp_err_t playlist_http_event_cb(esp_http_client_event_t *evt);
+/* Feeds the response body straight into the json_stream_t in
+ * user_data->ctx, chunk by chunk, instead of buffering it; the stream is
+ * reset whenever a (re)try of the request goes out. Doesn't use
+ * user_data->buffer at all. */
+esp_err_t json_stream_http_event_cb(esp_http_client_event_t* evt);
+/* Same, for the json_filter_t in user_data->ctx: only the values matching
+ * its path ever get buffered (in the filter's own buffer), one at a time. */
+esp_err_t json_filter_http_event_cb(esp_http_client_event_t *evt);
 void default_ws_event_cb(void* handler_args, esp_event_base_t base, int32_t event_id, void* event_data);
 
 #ifdef __cplusplus
@@ -0,0 +1,67 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_err.h"
+#include "spotify_client.h"
+
+/* Exported macro ------------------------------------------------------------*/
+/* Not a spotify_req_class_t: for the component's own short uses of a lane
+ * that aren't requests (reading its connections' stats). Last in line, and
+ * left out of spotify_sched_stats_t. */
+#define HTTP_SCHED_UNMETERED SPOTIFY_REQ_CLASS_MAX
+#define HTTP_SCHED_QUEUES    (SPOTIFY_REQ_CLASS_MAX + 1)
+
+/* Exported types ------------------------------------------------------------*/
+/* Connections that can be used independently of each other. */
+typedef enum
+{
+    /* api.spotify.com and discord.com: they share the token, sprintf_buf and
+     * parse_scratch, and a 401 refreshes the token from inside an API
+     * request, so they go together */
+    HTTP_LANE_SHARED = 0,
+    HTTP_LANE_IMAGE, /* i.scdn.co: no buffer, token or scratch of its own */
+    HTTP_LANE_MAX
+} http_lane_id_t;
+
+/* One lane's owner and queue. Whoever holds a lane is its only user; when
+ * it lets go, the lane goes straight to a waiter of the most urgent class
+ * waiting, instead of to whichever task a plain mutex would wake up (the
+ * highest-priority one, whatever it is about to send). */
+typedef struct
+{
+    SemaphoreHandle_t lock;                     /* guards the fields below, never held across a request */
+    SemaphoreHandle_t grant[HTTP_SCHED_QUEUES]; /* binary, given to hand the lane to a waiter of that class */
+    uint8_t waiting[HTTP_SCHED_QUEUES];
+    bool busy;
+    int owner;                                  /* class of the current holder */
+    int64_t granted_us;                         /* esp_timer time it got the lane */
+} http_lane_t;
+
+/* Every HTTP request goes through this (see http_sched_acquire()). Each
+ * class only ever uses one lane, so stats[cls] is guarded by that lane's
+ * lock. */
+typedef struct
+{
+    http_lane_t lanes[HTTP_LANE_MAX];
+    spotify_sched_stats_t stats[SPOTIFY_REQ_CLASS_MAX];
+} http_sched_t;
+
+/* Exported functions prototypes ---------------------------------------------*/
+esp_err_t http_sched_init(http_sched_t *sched);
+void http_sched_deinit(http_sched_t *sched);
+void http_sched_acquire(http_sched_t *sched, http_lane_id_t lane, int cls);
+void http_sched_release(http_sched_t *sched, http_lane_id_t lane);
+http_lane_id_t http_sched_lane_of(spotify_http_host_t host);
+void http_sched_get_stats(http_sched_t *sched, spotify_req_class_t cls, spotify_sched_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,52 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+#include "spotify_client.h"
+
+/* Exported macro ------------------------------------------------------------*/
+/* How long a prediction wins over what the server says, counted from the
+ * tap and again from the command's success: long enough for the dealer's
+ * PLAYER_STATE_CHANGED echo, which is what normally confirms it first. */
+#define OPTIMISTIC_HOLD_MS 3000
+/* A predicted position the server reports within this of is confirmed. */
+#define OPTIMISTIC_PROGRESS_SLACK_MS 1500
+/* Fields a prediction can cover (PREDICT_* bits, optimistic.c). */
+#define OPTIMISTIC_FIELDS 3
+
+/* Exported types ------------------------------------------------------------*/
+/* What the UI has been told ahead of the server, field by field, and what
+ * the server last said about those fields, to roll back to. Guarded by
+ * track_lock, like the snapshot it patches. */
+typedef struct
+{
+    uint8_t fields;             /* PREDICT_* bits (optimistic.c) still held */
+    int64_t hold_until_us[OPTIMISTIC_FIELDS]; /* esp_timer time each expires at */
+    bool is_playing;
+    time_t progress_ms;         /* ...at progress_at_us */
+    int64_t progress_at_us;
+    int volume_percent;
+    struct
+    {
+        bool is_playing;
+        time_t progress_ms;
+        int64_t progress_at_us;
+        int volume_percent;
+    } server;
+} optimistic_t;
+
+/* Exported functions prototypes ---------------------------------------------*/
+int optimistic_resolve_toggle(const TrackInfo *track);
+const TrackInfo *optimistic_predict(optimistic_t *opt, TrackInfo **track, int cmd, int arg);
+void optimistic_reconcile(optimistic_t *opt, TrackInfo *track, bool new_track);
+void optimistic_settle(optimistic_t *opt, int cmd);
+const TrackInfo *optimistic_rollback(optimistic_t *opt, TrackInfo **track, int cmd);
+
+#ifdef __cplusplus
+}
+#endif
@@ -9,22 +9,53 @@ extern "C" {
 #include <time.h>
 
 #include "json_parser.h"
+#include "json_stream.h"
+#include "json_filter.h"
 #include "spotify_client.h"
 
 /* Exported macro --------------------------------------------------------------*/
-/* Size of the caller-owned json_tok_t buffer every parse_* function below
- * expects; see esp_spotify_client's json_tokens field. */
+/* Cap on the tokens one response may need; the token arena only ever
+ * grows to what responses actually used (spotify_parse_stats_t). */
 #define MAX_TOKENS 1000
 
 /* Exported types ------------------------------------------------------------*/
+/* Tokenizing scratch every parse_* function below takes, one per
+ * esp_spotify_client: the reusable token arena plus its usage stats.
+ * parse_scratch_init() before first use, parse_scratch_free() at the end. */
+typedef struct {
+    json_tok_arena_t arena;
+    spotify_parse_stats_t stats;
+} parse_scratch_t;
+
+/* State for search_results_stream_cb(), which builds the TrackSearchItem_t
+ * list of a /v1/search response as it streams in (json_stream.h) instead of
+ * from a fully buffered and tokenized body. Zero-initialize it with `tracks`
+ * set to the (empty) TRACK_LIST to fill. */
+typedef struct {
+    List *tracks;
+    TrackSearchItem_t *item; /* result being filled in, not in `tracks` yet */
+    bool in_tracks;          /* inside the top-level "tracks" object */
+    bool in_items;           /* ...and inside its "items" array */
+    bool in_artists;         /* ...inside the current item's "artists" array */
+    bool seen_items;
+} search_results_state_t;
+
+/* Arg of playlist_filter_cb(): the (empty) PLAYLIST_LIST to fill and the
+ * scratch to parse each item with. */
+typedef struct {
+    List *playlists;
+    parse_scratch_t *scratch;
+} playlist_filter_state_t;
 
 /* Globally scoped variables declarations ------------------------------------*/
 
 /* Exported functions prototypes ---------------------------------------------*/
-/* All parse_* functions below take a caller-owned json_tok_t[MAX_TOKENS]
- * scratch buffer instead of relying on internal shared state, so concurrent
- * callers (e.g. different esp_spotify_client instances) don't step on each
- * other. The caller must serialize its own uses of a given buffer. */
+void           parse_scratch_init(parse_scratch_t *scratch);
+void           parse_scratch_free(parse_scratch_t *scratch);
+/* All parse_* functions below take a caller-owned parse_scratch_t instead
+ * of relying on internal shared state, so concurrent callers (e.g.
+ * different esp_spotify_client instances) don't step on each other. The
+ * caller must serialize its own uses of a given scratch. */
 /* expires_in (seconds) is optional: pass NULL to ignore it, or a non-NULL
  * out-param that's set to the token's lifetime, or to 0 if the response
  * didn't include that field (caller should then only rely on reactive
@@ -34,29 +65,54 @@ extern "C" {
  * ESP_FAIL if the response was unparseable or didn't have that field
  * (e.g. a Discord rate-limit/error body instead of a token) - caller
  * should treat this the same as a failed HTTP request, not crash. */
-esp_err_t      parse_access_token(const char* js, char* access_token, int size, json_tok_t *tokens, int *expires_in);
-/* Returns ESP_OK if both "name" and "uri" were found; otherwise
- * playlist_item->name/uri are left NULL (caller should discard the item)
- * instead of crashing on a malformed/unexpected fragment. */
-esp_err_t      parse_playlist(const char* js, PlaylistItem_t* playlist_item, json_tok_t *tokens);
+esp_err_t      parse_access_token(const char* js, char* access_token, int size, parse_scratch_t *scratch, int *expires_in);
+/* Returns the item (one allocation, see PlaylistItem_t) if both "name" and
+ * "uri" were found, NULL otherwise instead of crashing on a
+ * malformed/unexpected fragment. js is modified: strings are unescaped in
+ * place. */
+PlaylistItem_t* parse_playlist(char* js, parse_scratch_t *scratch);
+/* json_filter_cb_t for the "items[*]" of a /v1/me/playlists response (arg:
+ * playlist_filter_state_t): parses each item with parse_playlist() and
+ * appends it to state->playlists. Items that don't fit the filter buffer or
+ * lack name/uri are skipped, not fatal; match 0 starts the list over. */
+int            playlist_filter_cb(char *json, int len, int index, void *arg);
 /* Returns ESP_OK once the response itself parsed and had a "devices"
  * array, even if individual malformed entries inside it were skipped
  * (logged, not fatal); ESP_FAIL only if the whole response was
  * unparseable or missing "devices" entirely - caller should treat that
  * the same as a failed HTTP request. */
-esp_err_t      parse_available_devices(const char* js, List*, json_tok_t *tokens);
-/* Unlike the other parse_* functions, takes an explicit max_tokens instead
- * of assuming MAX_TOKENS: search responses are heavier than anything else
- * this component parses (full track objects with nested artists[]/album{}),
- * so callers own a bigger, on-demand scratch buffer just for this call (see
- * spotify_search_tracks(), player_commands.c) instead of the shared
- * per-client json_tokens[MAX_TOKENS]. Same "never abort on external data"
- * behavior as parse_available_devices: skips malformed entries instead of
- * failing the whole call; ESP_FAIL only if the response itself didn't parse
- * or was missing "tracks"/"items" entirely. */
-esp_err_t      parse_search_results(const char* js, List* tracks_list, json_tok_t *tokens, int max_tokens);
-void           parse_connection_id(const char* js, char** str, json_tok_t *tokens);
-SpotifyEvent_t parse_track(const char* js, TrackInfo** track_info, int initial_state, json_tok_t *tokens);
+esp_err_t      parse_available_devices(char* js, List*, parse_scratch_t *scratch);
+/* json_stream_cb_t for a /v1/search response (arg: search_results_state_t).
+ * Search responses are heavier than anything else this component parses
+ * (full track objects with nested artists[]/album{}), so instead of
+ * buffering and tokenizing them whole, each result is appended to
+ * state->tracks as soon as its object closes, keeping only name/uri/artist
+ * names. Same "never abort on external data" behavior as
+ * parse_available_devices: malformed entries are skipped, not fatal. A new
+ * top-level object (the request being retried) starts the list over. */
+int            search_results_stream_cb(const json_stream_evt_t *evt, void *arg);
+/* Call once the response has been fed in: drops a result left unfinished by
+ * a truncated body. ESP_FAIL if no "tracks"/"items" array was ever seen
+ * (not a search response); ESP_OK otherwise, with whatever results were
+ * complete. */
+esp_err_t      parse_search_results_finish(search_results_state_t *state);
+/* ESP_FAIL, with *str left untouched (caller should preset it to NULL), if
+ * the message doesn't have headers."Spotify-Connection-Id" or can't be
+ * tokenized. Never aborts: it's external data like the rest. */
+esp_err_t      parse_connection_id(const char* js, char** str, parse_scratch_t *scratch);
+/* Player state fields are read by the generated extract_player_state()
+ * (schema/spotify_objects.json); one that lacks them is UNKNOW, with the
+ * track left as it was. A compact WS push for the current track is read
+ * with substring searches, without tokenizing it. *track_info is the
+ * caller's reference to the current snapshot (track_snapshot.h), which may
+ * be replaced; a SAME_TRACK/NEW_TRACK event's payload is a new reference to
+ * the snapshot it reports. */
+SpotifyEvent_t parse_track(const char* js, TrackInfo** track_info, int initial_state, parse_scratch_t *scratch);
+/* item.id of a dealer PLAYER_STATE_CHANGED message, copied to id
+ * (SPOTIFY_ID_BUF_SIZE bytes); false for any other message. A json_stream
+ * pass: no tokens, no allocation and no parse_scratch_t, so it's safe to
+ * call from any task without holding HTTP_LANE_SHARED. */
+bool           parse_ws_track_id(const char* js, char* id);
 
 #ifdef __cplusplus
 }
@@ -26,26 +26,40 @@ extern "C" {
 #include "esp_websocket_client.h"
 #include "spotify_client.h"
 #include "parse_objects.h"
+#include "json_minify.h"
+#include "ws_ring.h"
+#include "event_queue.h"
+#include "cmd_queue.h"
+#include "optimistic.h"
+#include "track_snapshot.h"
+#include "http_sched.h"
+#include "async_worker.h"
 
 /* Exported macro ------------------------------------------------------------*/
 // eventgroup macros
 #define ENABLE_PLAYER       (1 << 0)
 #define DISABLE_PLAYER      (1 << 1)
-#define WS_READY_FOR_DATA   (1 << 2)
+/* (1 << 2) was WS_READY_FOR_DATA, before ws_client.ring */
 #define WS_CONNECT_EVENT    (1 << 3)
 #define WS_DISCONNECT_EVENT (1 << 4)
 #define WS_DATA_EVENT       (1 << 5)
-#define WS_DATA_CONSUMED    (1 << 6)
-#define DO_PLAY             (1 << 7)
-#define DO_PAUSE            (1 << 8)
-#define DO_NEXT             (1 << 9)
-#define DO_PREVIOUS         (1 << 10)
-#define DO_PAUSE_UNPAUSE    (1 << 11)
+/* (1 << 6) was WS_DATA_CONSUMED, before TrackInfo snapshots */
+#define PLAYER_CMD_EVENT    (1 << 7)  /* something was pushed to client->cmd_queue */
+/* (1 << 8) to (1 << 11) were the other DO_* bits, one per command, before
+ * cmd_queue */
 
 #define ACQUIRE_LOCK(mux) xSemaphoreTake(mux, portMAX_DELAY)
 #define RELEASE_LOCK(mux) xSemaphoreGive(mux)
 #define MAX_HTTP_BUFFER 8192
 #define MAX_WS_BUFFER   4096
+/* The Discord endpoint only ever returns a small
+ * {"access_token": ..., "expires_in": ...} object (token itself bounded by
+ * ACCESS_TOKEN_BUF_SIZE), so its connection doesn't need a full
+ * MAX_HTTP_BUFFER of its own. */
+#define DISCORD_HTTP_BUFFER 1024
+/* Every pooled connection's socket timeout (esp_http_client's own default,
+ * made explicit so async_worker_end_send() can put it back). */
+#define HTTP_TIMEOUT_MS 5000
 #define SPRINTF_BUF_SIZE 100
 #define ACCESS_TOKEN_BUF_SIZE 400
 #define WS_PING_INTERVAL_SEC 30
@@ -64,10 +78,10 @@ extern "C" {
 #define BEARER_PREFIX "Bearer "
 #define BEARER_PREFIX_LEN (sizeof(BEARER_PREFIX) - 1)
 /* Exported types ------------------------------------------------------------*/
-/* Player commands as understood by player_cmd() (player_commands.c).
- * Deliberately not aliased to the DO_* EventGroup bits above (see
- * bits_to_player_cmd()): keeping this enum independent means the EventGroup
- * bit layout can change without having to keep these values in sync by hand. */
+/* Player commands as understood by player_cmd() (player_commands.c), and
+ * as queued for player_task in cmd_queue. SET_VOLUME and SEEK only go
+ * through the queue (player_task runs them with spotify_set_volume()/
+ * spotify_seek_to_position()), never through player_cmd(). */
 typedef enum
 {
     PAUSE = 1,
@@ -75,79 +89,95 @@ typedef enum
     PAUSE_UNPAUSE,
     PREVIOUS,
     NEXT,
-    GET_STATE
+    GET_STATE,
+    SET_VOLUME,
+    SEEK
 } PlayerCommand_t;
-/* Scratch state for playlist_http_event_cb's byte-by-byte JSON scan
- * (handler_callbacks.c): tracks brace depth (in_items/brace_count),
- * whether the current item overflowed the buffer (item_overflow), and
- * whether we're currently inside a JSON string value - and if so, whether
- * the next byte is backslash-escaped (in_string/escaped) - so structural
- * characters ('{'/'}') and "insignificant" whitespace that happen to
- * appear inside free-text fields (playlist names/descriptions) aren't
- * mistaken for JSON structure.
- *
- * Grouped into its own struct (instead of loose fields on evt_user_data_t)
- * specifically so it can be reset in one line wherever a fresh playlist
- * fetch starts: `user_data->playlist_scan = (playlist_scan_state_t){0};` -
- * see spotify_user_playlists() and playlist_http_event_cb's
- * ON_FINISH/DISCONNECTED cases. */
-typedef struct {
-    int in_items;
-    int brace_count;
-    int item_overflow;
-    bool in_string;
-    bool escaped;
-} playlist_scan_state_t;
-
 typedef struct {
     uint8_t *buffer;
     size_t buffer_size;
     size_t current_size;
     void * ctx;
-    /* json_tok_t* scratch buffer (owned by the esp_spotify_client this
-     * user_data belongs to) for parse_* calls that only have access to this
-     * struct, not the client handle (e.g. playlist_http_event_cb). Kept as
-     * void* here to avoid pulling json_parser.h into this header; cast back
-     * to json_tok_t* at the call site. */
-    void * tokens;
     /* Per-instance scratch state for the HTTP event callbacks in
      * handler_callbacks.c. These used to be function-local statics shared by
      * every esp_spotify_client instance; keeping them here instead means two
      * clients (or a client's HTTP and WS pipelines) can't corrupt each
      * other's in-progress parsing state. */
     int output_len;
-    playlist_scan_state_t playlist_scan;
+    json_minify_t minify;  /* json_http_event_cb(): where the response left off */
 } evt_user_data_t;
 
+/* One pooled HTTP connection (see spotify_http_host_t). Requests for a given
+ * host always go through the same handle, so a kept-alive connection to one
+ * host survives requests to the others. */
+typedef struct
+{
+    esp_http_client_handle_t handle;
+    http_event_handle_cb http_event_cb;
+    evt_user_data_t user_data;
+    /* Whether `handle` currently holds an open connection, tracked from
+     * HTTP_EVENT_ON_CONNECTED/DISCONNECTED in http_event_cb_wrapper()
+     * (esp_http_client doesn't expose its own state). Lets
+     * perform_http_request() tell a reused keep-alive connection apart
+     * from a fresh one, both for stats and for its stale-socket retry. */
+    bool connected;
+    int64_t last_used_us; /* esp_timer time the last request on handle finished */
+    int64_t connect_start_us; /* esp_timer time the current perform() started, for handshake timing */
+    /* Set once handle has completed a TLS handshake with
+     * save_client_session on: from then on every reconnect offers that
+     * session's ticket (esp_http_client keeps it per handle). */
+    bool has_session;
+    uint8_t retries; /* connection-error retries of the current request */
+    /* While the async worker is the one sending (async_worker_cancel_flag()),
+     * its request's cancel flag, watched by perform_http_request() and
+     * http_event_cb_wrapper(); NULL otherwise. */
+    const atomic_bool *cancel;
+    spotify_http_stats_t stats;
+} http_conn_t;
+
 /* Shared client struct, used across spotify_client.c/spotify_auth.c/
  * player_commands.c/player_task.c (ANALYSIS.md 2.6) - lives here since all
  * four need the full definition. */
 struct esp_spotify_client
 {
+    /* player_task's latest snapshot (track_snapshot.h), one reference.
+     * Replaced or changed only under track_lock, through parse_track() or
+     * track_snapshot_writable(). */
     TrackInfo *track_info;
     char sprintf_buf[SPRINTF_BUF_SIZE];
-    SemaphoreHandle_t http_buf_lock; /* Mutex to manage access to the http client buffer */
-    uint8_t s_retries;               /* number of retries on error connections */
+    /* Who gets which HTTP connection next. Holding a lane (see
+     * http_sched_lane_of()) is what grants use of its connections, their
+     * buffers and stats, and for HTTP_LANE_SHARED also of access_token,
+     * sprintf_buf and parse_scratch. */
+    http_sched_t http_sched;
+    /* track_info, optimistic and ws_parse_scratch. Only ever held for a
+     * parse or a field update, never across a request; taken after a lane
+     * when both are needed. */
+    SemaphoreHandle_t track_lock;
+    optimistic_t optimistic; /* what track_info shows ahead of the server */
+    bool holds_ca_store;             /* counted in the global CA store's users (CONFIG_SPOTIFY_GLOBAL_CA_STORE) */
     struct
     {
         char value[ACCESS_TOKEN_BUF_SIZE];
         time_t expiresIn;
     } access_token;
-    struct
-    {
-        esp_http_client_handle_t handle;
-        http_event_handle_cb http_event_cb;
-        evt_user_data_t user_data;
-    } http_client;
+    http_conn_t http_pool[SPOTIFY_HTTP_HOST_MAX]; /* one connection per host, indexed by spotify_http_host_t */
     struct
     {
         esp_websocket_client_handle_t handle;
-        evt_user_data_t user_data;
+        ws_ring_t ring; /* messages from default_ws_event_cb() to player_task */
         EventGroupHandle_t event_group;
+        int64_t connect_start_us; /* esp_timer time of the last WEBSOCKET_EVENT_BEFORE_CONNECT */
+        spotify_handshake_stats_t handshakes;
     } ws_client;
-    QueueHandle_t event_queue;
+    event_queue_t event_queue; /* player_task -> spotify_wait_event() */
+    cmd_queue_t cmd_queue;     /* player_dispatch_*() -> player_task */
     TaskHandle_t player_task_handle;
-    json_tok_t json_tokens[MAX_TOKENS]; /* scratch buffer for parse_objects.c, per-instance not global (ANALYSIS.md 2.4) */
+    async_worker_t async;      /* spotify_*_async() */
+    parse_scratch_t parse_scratch; /* tokens for parse_objects.c, per-instance not global (ANALYSIS.md 2.4); under HTTP_LANE_SHARED */
+    /* player_task's for WebSocket messages, so dealer events are parsed
+     * while a request holds HTTP_LANE_SHARED; under track_lock. */
+    parse_scratch_t ws_parse_scratch;
 };
 
 /* Exported variables declarations -------------------------------------------*/
@@ -161,11 +191,11 @@ esp_err_t get_access_token_locked(esp_spotify_client_handle_t client);
 bool access_token_needs_refresh(esp_spotify_client_handle_t client);
 
 /* spotify_client.c */
-esp_err_t perform_http_request(esp_spotify_client_handle_t client, const char *auth, const char *content_type, const char *url, esp_http_client_method_t method, HttpStatus_Code *status_code);
+esp_err_t perform_http_request(esp_spotify_client_handle_t client, spotify_http_host_t host, const char *auth, const char *content_type, const char *url, esp_http_client_method_t method, HttpStatus_Code *status_code);
 
 /* player_commands.c */
 esp_err_t player_cmd(esp_spotify_client_handle_t client, PlayerCommand_t cmd, void *payload, HttpStatus_Code *status_code);
-bool bits_to_player_cmd(uint32_t bit, PlayerCommand_t *out_cmd);
+esp_err_t player_cmd_locked(esp_spotify_client_handle_t client, PlayerCommand_t cmd, void *payload, HttpStatus_Code *status_code);
 
 /* player_task.c */
 void player_task(void *pvParameters);
@@ -0,0 +1,44 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdatomic.h>
+#include <stdint.h>
+#include "spotify_client.h"
+
+/* Exported types ------------------------------------------------------------*/
+/* TrackInfo.strings. Offsets are from the start of the block, so a copy is
+ * just a memcpy of `size` bytes; 0 is never a string's (it's the header). */
+struct TrackStrings
+{
+    uint16_t size;          /* bytes in use, this header included */
+    uint16_t name;
+    uint16_t album_name;
+    uint16_t url_cover;     /* 0: no usable cover */
+    uint16_t artists_count;
+    uint16_t artists[];     /* artists_count offsets, then the text */
+};
+
+/* A TrackInfo published in SAME_TRACK/NEW_TRACK events, see
+ * spotify_track_ref(). Strings belong to `owner`: the snapshot itself when
+ * it was built for a new track (the block right after it, same
+ * allocation), or the one it was copied from for a change of progress/play
+ * state/volume, which copies nothing but this struct and keeps the owner
+ * referenced. */
+typedef struct track_snapshot
+{
+    atomic_int refs;
+    struct track_snapshot *owner;
+    TrackInfo track;
+} track_snapshot_t;
+
+/* Exported functions prototypes ---------------------------------------------*/
+TrackInfo *track_snapshot_new(int artists_count, size_t text_size, TrackStrings **strings);
+TrackInfo *track_snapshot_writable(TrackInfo **track);
+
+#ifdef __cplusplus
+}
+#endif
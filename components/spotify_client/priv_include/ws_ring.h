@@ -0,0 +1,78 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "spotify_client.h"
+
+/* Exported macro ------------------------------------------------------------*/
+#define WS_RING_MAX_DEPTH 16
+
+/* Exported types ------------------------------------------------------------*/
+/* One message buffer. tag packs the buffer's state (low 2 bits, below) with
+ * the sequence number it was queued under, so a compare-and-swap on it can
+ * never succeed against a buffer that was dropped and requeued in between. */
+typedef struct
+{
+    char *data;
+    size_t len;
+    atomic_uint tag;
+    /* Overflow bookkeeping, websocket task only: 0 = not looked at yet,
+     * 1 = track_id holds the message's item.id, -1 = not a player state */
+    int8_t id_state;
+    char track_id[SPOTIFY_ID_BUF_SIZE];
+} ws_ring_msg_t;
+
+typedef enum
+{
+    WS_RING_FREE = 0, /* the producer's to take */
+    WS_RING_WRITING,  /* being assembled by the producer */
+    WS_RING_QUEUED,   /* complete, waiting for the consumer (or dropped back to WRITING) */
+    WS_RING_TAKEN,    /* the consumer's until ws_ring_release() */
+} ws_ring_state_t;
+
+/* Complete dealer messages on their way from default_ws_event_cb() (the
+ * websocket task, sole producer) to player_task (sole consumer), in a ring
+ * of depth buffers the producer fills in turn. Neither side ever blocks on
+ * the other: buffers change hands only through their tag, with C11 atomics,
+ * and the consumer always takes the lowest sequence number queued before
+ * it started looking (head). When every buffer is taken the producer makes
+ * room itself, see ws_ring_begin(). */
+typedef struct
+{
+    ws_ring_msg_t msgs[WS_RING_MAX_DEPTH];
+    char *storage;                  /* depth * msg_size bytes, PSRAM when there is some */
+    size_t msg_size;                /* largest message + NUL */
+    int depth;
+    atomic_uint head;               /* sequence number of the next message queued */
+    /* producer only */
+    int next;                       /* buffer to try first for the next message */
+    int writing;                    /* message being assembled, -1 if none */
+    spotify_ws_queue_stats_t stats;
+} ws_ring_t;
+
+/* Exported functions prototypes ---------------------------------------------*/
+esp_err_t ws_ring_init(ws_ring_t *ring, int depth, size_t msg_size);
+void ws_ring_free(ws_ring_t *ring);
+
+/* Producer (websocket task) */
+esp_err_t ws_ring_begin(ws_ring_t *ring, size_t len);
+void ws_ring_append(ws_ring_t *ring, size_t offset, const void *data, size_t len);
+bool ws_ring_commit(ws_ring_t *ring);
+void ws_ring_abort(ws_ring_t *ring);
+
+/* Consumer (player_task) */
+const char *ws_ring_take(ws_ring_t *ring, int *msg);
+void ws_ring_release(ws_ring_t *ring, int msg);
+void ws_ring_flush(ws_ring_t *ring);
+
+#ifdef __cplusplus
+}
+#endif
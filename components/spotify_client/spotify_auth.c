@@ -37,24 +37,24 @@ bool access_token_needs_refresh(esp_spotify_client_handle_t client)
 }
 
 /**
- * @brief Same as get_access_token(), but assumes client->http_buf_lock is
+ * @brief Same as get_access_token(), but assumes HTTP_LANE_SHARED is
  * already held by the caller. Used by the public API functions in
  * player_commands.c so they can retry-after-reauth atomically under a single
- * lock acquisition, instead of releasing and re-acquiring the lock around the
- * refresh (which would let another task's request interleave and corrupt the
- * shared HTTP buffer/ctx in between).
+ * acquisition, instead of letting go of the lane around the refresh (which
+ * would let another task's request interleave and corrupt the shared HTTP
+ * buffer/ctx in between).
  */
 esp_err_t get_access_token_locked(esp_spotify_client_handle_t client)
 {
-    client->http_client.http_event_cb = json_http_event_cb;
+    client->http_pool[SPOTIFY_HTTP_HOST_DISCORD].http_event_cb = json_http_event_cb;
     HttpStatus_Code status_code;
-    esp_err_t err = perform_http_request(client, CONFIG_DISCORD_TOKEN, "application/json", ACCESS_TOKEN_URL, HTTP_METHOD_GET, &status_code);
+    esp_err_t err = perform_http_request(client, SPOTIFY_HTTP_HOST_DISCORD, CONFIG_DISCORD_TOKEN, "application/json", ACCESS_TOKEN_URL, HTTP_METHOD_GET, &status_code);
     if (err == ESP_OK)
     {
         if (status_code == HttpStatus_Ok)
         {
             int expires_in = 0;
-            err = parse_access_token((char *)(client->http_client.user_data.buffer), client->access_token.value + BEARER_PREFIX_LEN, ACCESS_TOKEN_BUF_SIZE - BEARER_PREFIX_LEN, client->json_tokens, &expires_in);
+            err = parse_access_token((char *)(client->http_pool[SPOTIFY_HTTP_HOST_DISCORD].user_data.buffer), client->access_token.value + BEARER_PREFIX_LEN, ACCESS_TOKEN_BUF_SIZE - BEARER_PREFIX_LEN, &client->parse_scratch, &expires_in);
             if (err == ESP_OK)
             {
                 client->access_token.expiresIn = (expires_in > 0) ? (time(NULL) + expires_in) : 0;
@@ -80,8 +80,9 @@ esp_err_t get_access_token_locked(esp_spotify_client_handle_t client)
 
 esp_err_t get_access_token(esp_spotify_client_handle_t client)
 {
-    ACQUIRE_LOCK(client->http_buf_lock);
+    // only player_task's, when it starts a session
+    http_sched_acquire(&client->http_sched, HTTP_LANE_SHARED, SPOTIFY_REQ_STATE);
     esp_err_t err = get_access_token_locked(client);
-    RELEASE_LOCK(client->http_buf_lock);
+    http_sched_release(&client->http_sched, HTTP_LANE_SHARED);
     return err;
 }
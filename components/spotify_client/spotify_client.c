@@ -2,6 +2,8 @@
 #include "spotify_client.h"
 #include "esp_log.h"
 #include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_tls.h"
 #include "esp_websocket_client.h"
 #include "handler_callbacks.h"
 #include "parse_objects.h"
@@ -13,12 +15,40 @@
 
 /* Private function prototypes -----------------------------------------------*/
 static esp_err_t http_event_cb_wrapper(esp_http_client_event_t *evt);
-static esp_err_t http_retries_available(esp_spotify_client_handle_t client, esp_err_t err);
+static esp_err_t http_retries_available(http_conn_t *conn, esp_err_t err);
 static void debug_mem();
 static void prepare_client(esp_http_client_handle_t http_client, const char *auth, const char *content_type, const char *url, esp_http_client_method_t method);
+static void http_client_close(http_conn_t *conn);
+static esp_err_t dispatch_command(esp_spotify_client_handle_t client, PlayerCommand_t cmd, int arg);
+static void http_client_expire_idle(http_conn_t *conn);
+static esp_err_t http_pool_init_conn(esp_spotify_client_handle_t client, spotify_http_host_t host);
+static void record_handshake(spotify_handshake_stats_t *hs, int64_t start_us, bool offered);
+static void ws_handshake_event_cb(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data);
+static esp_err_t ca_store_acquire(void);
+static void ca_store_release(void);
 
 /* Locally scoped variables --------------------------------------------------*/
 static const char *TAG = "spotify_client";
+/* Number of live clients using esp-tls' global CA store; the store is
+ * loaded when this goes 0 -> 1 and freed when it drops back to 0. Only
+ * touched from spotify_client_init()/deinit(), which aren't meant to run
+ * concurrently. */
+static unsigned ca_store_users;
+
+/* Base URL and receive buffer size of each pooled connection; a buffer size
+ * of 0 means the connection owns no buffer and callers lend it one per
+ * request (fetch_album_art() passes its caller's out_buf). Such a
+ * connection shares nothing with the others, so it also gets a lane of its
+ * own (http_sched_lane_of()). */
+static const struct
+{
+    const char *url;
+    size_t buffer_size;
+} http_hosts[SPOTIFY_HTTP_HOST_MAX] = {
+    [SPOTIFY_HTTP_HOST_API] = {"https://api.spotify.com/v1", MAX_HTTP_BUFFER},
+    [SPOTIFY_HTTP_HOST_IMAGE] = {"https://i.scdn.co", 0},
+    [SPOTIFY_HTTP_HOST_DISCORD] = {"https://discord.com", DISCORD_HTTP_BUFFER},
+};
 
 /* Globally scoped variables definitions -------------------------------------*/
 
@@ -36,58 +66,44 @@ esp_spotify_client_handle_t spotify_client_init(UBaseType_t priority)
         return NULL;
     }
 
-    client->http_client.user_data.buffer = (uint8_t *)calloc(1, MAX_HTTP_BUFFER);
-    if (!client->http_client.user_data.buffer)
+    client->track_info = track_snapshot_new(0, 0, NULL); // no track yet
+    if (!client->track_info)
     {
         spotify_client_deinit(client);
         return NULL;
     }
-    client->http_client.user_data.buffer_size = MAX_HTTP_BUFFER;
-    client->http_client.user_data.tokens = client->json_tokens;
+    parse_scratch_init(&client->parse_scratch);
+    parse_scratch_init(&client->ws_parse_scratch);
+    strcpy(client->access_token.value, BEARER_PREFIX);
 
-    client->track_info = (TrackInfo *)calloc(1, sizeof(TrackInfo));
-    if (!client->track_info)
+#if CONFIG_SPOTIFY_GLOBAL_CA_STORE
+    if (ca_store_acquire() != ESP_OK)
     {
-        ESP_LOGE(TAG, "Error allocating memory for track info");
         spotify_client_deinit(client);
         return NULL;
     }
-    client->track_info->artists.type = STRING_LIST;
-    client->track_info->device.volume_percent = -1; // calloc left it 0, which would be indistinguishable from a real 0% volume
-    strcpy(client->access_token.value, BEARER_PREFIX);
-
-    esp_http_client_config_t http_cfg = {
-        .url = "https://api.spotify.com/v1",
-        .user_data = client,
-        .event_handler = http_event_cb_wrapper,
-        .cert_pem = certs_pem_start,
-        .buffer_size_tx = DEFAULT_HTTP_BUF_SIZE + 256,
-    };
+    client->holds_ca_store = true;
+#endif
 
     esp_websocket_client_config_t websocket_cfg = {
         .uri = "wss://dealer.spotify.com",
-        .user_context = &client->ws_client.user_data,
+#if CONFIG_SPOTIFY_GLOBAL_CA_STORE
+        .use_global_ca_store = true,
+#else
         .cert_pem = certs_pem_start,
+#endif
         .ping_interval_sec = WS_PING_INTERVAL_SEC,
         .disable_auto_reconnect = true,
     };
 
-    client->track_info->name = calloc(1, 1);
-    if (!client->track_info->name)
+    for (int host = 0; host < SPOTIFY_HTTP_HOST_MAX; host++)
     {
-        ESP_LOGE(TAG, "Error allocating memory for track name");
-        spotify_client_deinit(client);
-        return NULL;
-    }
-
-    client->http_client.handle = esp_http_client_init(&http_cfg);
-    if (!client->http_client.handle)
-    {
-        ESP_LOGE(TAG, "Error on esp_http_client_init()");
-        spotify_client_deinit(client);
-        return NULL;
+        if (http_pool_init_conn(client, host) != ESP_OK)
+        {
+            spotify_client_deinit(client);
+            return NULL;
+        }
     }
-    client->http_client.http_event_cb = json_http_event_cb;
     client->ws_client.handle = esp_websocket_client_init(&websocket_cfg);
     if (!client->ws_client.handle)
     {
@@ -96,37 +112,50 @@ esp_spotify_client_handle_t spotify_client_init(UBaseType_t priority)
         return NULL;
     }
     esp_websocket_client_destroy_on_exit(client->ws_client.handle);
-    client->ws_client.user_data.buffer = (uint8_t *)calloc(1, MAX_WS_BUFFER);
-    if (!client->ws_client.user_data.buffer)
+    /* Registered once here (handler_args = client); default_ws_event_cb
+     * is registered by player_task when it starts a session. */
+    esp_websocket_register_events(client->ws_client.handle, WEBSOCKET_EVENT_BEFORE_CONNECT, ws_handshake_event_cb, client);
+    esp_websocket_register_events(client->ws_client.handle, WEBSOCKET_EVENT_CONNECTED, ws_handshake_event_cb, client);
+    if (ws_ring_init(&client->ws_client.ring, CONFIG_SPOTIFY_WS_QUEUE_DEPTH, MAX_WS_BUFFER) != ESP_OK)
     {
         spotify_client_deinit(client);
         return NULL;
     }
-    client->ws_client.user_data.buffer_size = MAX_WS_BUFFER;
 
-    client->http_buf_lock = xSemaphoreCreateMutex();
-    if (!client->http_buf_lock)
+    if (http_sched_init(&client->http_sched) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to create HTTP scheduler");
+        spotify_client_deinit(client);
+        return NULL;
+    }
+    client->track_lock = xSemaphoreCreateMutex();
+    if (!client->track_lock)
     {
         ESP_LOGE(TAG, "Failed to create mutex");
         spotify_client_deinit(client);
         return NULL;
     }
 
-    client->event_queue = xQueueCreate(1, sizeof(SpotifyEvent_t));
-    if (!client->event_queue)
+    if (event_queue_init(&client->event_queue) != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to create queue for events");
         spotify_client_deinit(client);
         return NULL;
     }
 
+    if (cmd_queue_init(&client->cmd_queue) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to create queue for commands");
+        spotify_client_deinit(client);
+        return NULL;
+    }
+
     if (!(client->ws_client.event_group = xEventGroupCreate()))
     {
         ESP_LOGE("EventGroup", "Failed to create event group");
         spotify_client_deinit(client);
         return NULL;
     }
-    client->ws_client.user_data.ctx = client->ws_client.event_group;
 
     int res = xTaskCreate(player_task, "player_task", PLAYER_TASK_STACK_SIZE, client, priority, &client->player_task_handle);
     if (!res)
@@ -136,6 +165,13 @@ esp_spotify_client_handle_t spotify_client_init(UBaseType_t priority)
         return NULL;
     }
 
+    if (async_worker_init(client, priority) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to create async worker task");
+        spotify_client_deinit(client);
+        return NULL;
+    }
+
     return client;
 }
 
@@ -155,47 +191,53 @@ esp_err_t spotify_client_deinit(esp_spotify_client_handle_t client)
         vTaskDelete(client->player_task_handle);
         client->player_task_handle = NULL;
     }
-    if (client->http_client.user_data.buffer)
+    // same for the async worker, before the connections it sends on
+    async_worker_deinit(&client->async);
+    for (int host = 0; host < SPOTIFY_HTTP_HOST_MAX; host++)
     {
-        free(client->http_client.user_data.buffer);
-        client->http_client.user_data.buffer = NULL;
-    }
-    if (client->track_info)
-    {
-        spotify_clear_track(client->track_info);
-        free(client->track_info);
-        client->track_info = NULL;
-    }
-    if (client->http_client.handle)
-    {
-        esp_http_client_cleanup(client->http_client.handle);
-        client->http_client.handle = NULL;
+        http_conn_t *conn = &client->http_pool[host];
+        if (conn->handle)
+        {
+            esp_http_client_cleanup(conn->handle);
+            conn->handle = NULL;
+        }
+        // only free buffers the pool allocated itself, not lent ones
+        if (http_hosts[host].buffer_size && conn->user_data.buffer)
+        {
+            free(conn->user_data.buffer);
+        }
+        conn->user_data.buffer = NULL;
     }
+    spotify_track_unref(client->track_info);
+    client->track_info = NULL;
     if (client->ws_client.handle)
     {
         esp_websocket_client_destroy(client->ws_client.handle);
         client->ws_client.handle = NULL;
     }
-    if (client->ws_client.user_data.buffer)
-    {
-        free(client->ws_client.user_data.buffer);
-        client->ws_client.user_data.buffer = NULL;
-    }
-    if (client->http_buf_lock)
-    {
-        vSemaphoreDelete(client->http_buf_lock);
-        client->http_buf_lock = NULL;
-    }
-    if (client->event_queue)
+    // after the websocket client, whose task fills it
+    ws_ring_free(&client->ws_client.ring);
+    parse_scratch_free(&client->parse_scratch);
+    parse_scratch_free(&client->ws_parse_scratch);
+    http_sched_deinit(&client->http_sched);
+    if (client->track_lock)
     {
-        vQueueDelete(client->event_queue);
-        client->event_queue = NULL;
+        vSemaphoreDelete(client->track_lock);
+        client->track_lock = NULL;
     }
+    event_queue_deinit(&client->event_queue);
+    cmd_queue_deinit(&client->cmd_queue);
     if (client->ws_client.event_group)
     {
         vEventGroupDelete(client->ws_client.event_group);
         client->ws_client.event_group = NULL;
     }
+    if (client->holds_ca_store)
+    {
+        // after every connection above has been torn down
+        ca_store_release();
+        client->holds_ca_store = false;
+    }
     free(client);
     return ESP_OK;
 }
@@ -216,23 +258,18 @@ esp_err_t player_dispatch_event(esp_spotify_client_handle_t client, SendEvent_t
         xEventGroupSetBits(client->ws_client.event_group, DISABLE_PLAYER);
         break;
     case DATA_PROCESSED_EVENT:
-        xEventGroupSetBits(client->ws_client.event_group, WS_DATA_CONSUMED);
+        // nothing waits for it anymore: events carry their own TrackInfo
         break;
     case DO_PLAY_EVENT:
-        xEventGroupSetBits(client->ws_client.event_group, DO_PLAY);
-        break;
+        return dispatch_command(client, PLAY, 0);
     case DO_PAUSE_EVENT:
-        xEventGroupSetBits(client->ws_client.event_group, DO_PAUSE);
-        break;
+        return dispatch_command(client, PAUSE, 0);
     case PAUSE_UNPAUSE_EVENT:
-        xEventGroupSetBits(client->ws_client.event_group, DO_PAUSE_UNPAUSE);
-        break;
+        return dispatch_command(client, PAUSE_UNPAUSE, 0);
     case DO_NEXT_EVENT:
-        xEventGroupSetBits(client->ws_client.event_group, DO_NEXT);
-        break;
+        return dispatch_command(client, NEXT, 0);
     case DO_PREVIOUS_EVENT:
-        xEventGroupSetBits(client->ws_client.event_group, DO_PREVIOUS);
-        break;
+        return dispatch_command(client, PREVIOUS, 0);
     default:
         ESP_LOGE(TAG, "Unknown event: %d", event);
         return ESP_FAIL;
@@ -240,35 +277,185 @@ esp_err_t player_dispatch_event(esp_spotify_client_handle_t client, SendEvent_t
     return ESP_OK;
 }
 
+/* Queued like the transport commands, instead of blocking the caller for
+ * the request as spotify_set_volume() does; a newer value replaces one
+ * still pending. A failure is reported as a PLAYER_ERROR event. */
+esp_err_t player_dispatch_volume(esp_spotify_client_handle_t client, int volume_percent)
+{
+    if (!client->ws_client.event_group)
+    {
+        ESP_LOGE(TAG, "Run spotify_client_init() first");
+        return ESP_FAIL;
+    }
+    return dispatch_command(client, SET_VOLUME, volume_percent);
+}
+
+/* Same as player_dispatch_volume(), for spotify_seek_to_position(). */
+esp_err_t player_dispatch_seek(esp_spotify_client_handle_t client, int position_ms)
+{
+    if (!client->ws_client.event_group)
+    {
+        ESP_LOGE(TAG, "Run spotify_client_init() first");
+        return ESP_FAIL;
+    }
+    return dispatch_command(client, SEEK, position_ms);
+}
+
+esp_err_t spotify_client_get_http_stats(esp_spotify_client_handle_t client, spotify_http_host_t host, spotify_http_stats_t *stats)
+{
+    if (!client || !stats || host < 0 || host >= SPOTIFY_HTTP_HOST_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    http_lane_id_t lane = http_sched_lane_of(host);
+    http_sched_acquire(&client->http_sched, lane, HTTP_SCHED_UNMETERED);
+    *stats = client->http_pool[host].stats;
+    http_sched_release(&client->http_sched, lane);
+    return ESP_OK;
+}
+
+esp_err_t spotify_client_get_parse_stats(esp_spotify_client_handle_t client, spotify_parse_stats_t *stats)
+{
+    if (!client || !stats)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    http_sched_acquire(&client->http_sched, HTTP_LANE_SHARED, HTTP_SCHED_UNMETERED);
+    *stats = client->parse_scratch.stats;
+    http_sched_release(&client->http_sched, HTTP_LANE_SHARED);
+    // plus player_task's WebSocket scratch: its own arena, the same kinds
+    ACQUIRE_LOCK(client->track_lock);
+    const spotify_parse_stats_t *ws = &client->ws_parse_scratch.stats;
+    for (int kind = 0; kind < SPOTIFY_PARSE_MAX; kind++)
+    {
+        if (ws->peak_tokens[kind] > stats->peak_tokens[kind])
+        {
+            stats->peak_tokens[kind] = ws->peak_tokens[kind];
+        }
+    }
+    stats->arena_tokens += ws->arena_tokens;
+    stats->failed += ws->failed;
+    RELEASE_LOCK(client->track_lock);
+    return ESP_OK;
+}
+
+esp_err_t spotify_client_get_ws_handshake_stats(esp_spotify_client_handle_t client, spotify_handshake_stats_t *stats)
+{
+    if (!client || !stats)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    /* Written from the websocket task without a lock; a copy taken while a
+     * connect completes may mix old and new fields, which is fine for
+     * diagnostics. */
+    *stats = client->ws_client.handshakes;
+    return ESP_OK;
+}
+
+esp_err_t spotify_client_get_ws_queue_stats(esp_spotify_client_handle_t client, spotify_ws_queue_stats_t *stats)
+{
+    if (!client || !stats)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // producer-written without a lock too, same caveat as above
+    *stats = client->ws_client.ring.stats;
+    return ESP_OK;
+}
+
+esp_err_t spotify_client_get_sched_stats(esp_spotify_client_handle_t client, spotify_req_class_t req_class, spotify_sched_stats_t *stats)
+{
+    if (!client || !stats || req_class < 0 || req_class >= SPOTIFY_REQ_CLASS_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    http_sched_get_stats(&client->http_sched, req_class, stats);
+    return ESP_OK;
+}
+
 BaseType_t spotify_wait_event(esp_spotify_client_handle_t client, SpotifyEvent_t *event, TickType_t xTicksToWait)
 {
     // TODO: check first if the player is enabled,
     // if not, send an event of the error
-    return xQueueReceive(client->event_queue, event, xTicksToWait);
-
-    // maybe we can send the DATA_PROCESSED_EVENT here
+    return event_queue_receive(&client->event_queue, event, xTicksToWait);
 }
 
 /* Private functions ---------------------------------------------------------*/
+/* Hands cmd to player_task (cmd_queue_push() says what merges), which runs
+ * it even if it's still busy with the previous one when this is called.
+ * What it's going to do is published right away, as a SAME_TRACK ahead of
+ * the server's (optimistic.c): the UI doesn't wait for the request, nor
+ * for the dealer's echo. ESP_ERR_NO_MEM if there are already
+ * CMD_QUEUE_DEPTH commands waiting. */
+static esp_err_t dispatch_command(esp_spotify_client_handle_t client, PlayerCommand_t cmd, int arg)
+{
+    ACQUIRE_LOCK(client->track_lock);
+    if (cmd == PAUSE_UNPAUSE)
+    {
+        arg = optimistic_resolve_toggle(client->track_info);
+    }
+    esp_err_t err = cmd_queue_push(&client->cmd_queue, cmd, arg);
+    if (err == ESP_OK)
+    {
+        const TrackInfo *predicted = optimistic_predict(&client->optimistic, &client->track_info, cmd, arg);
+        if (predicted)
+        {
+            // still under track_lock, so it can't overtake a newer snapshot
+            SpotifyEvent_t evt = {.player_event = SAME_TRACK, .payload = (void *)predicted};
+            event_queue_push(&client->event_queue, &evt);
+        }
+    }
+    RELEASE_LOCK(client->track_lock);
+    if (err == ESP_OK)
+    {
+        xEventGroupSetBits(client->ws_client.event_group, PLAYER_CMD_EVENT);
+    }
+    return err;
+}
+
 static esp_err_t http_event_cb_wrapper(esp_http_client_event_t *evt)
 {
-    esp_spotify_client_handle_t client = evt->user_data;
-    evt->user_data = &client->http_client.user_data;
-    return client->http_client.http_event_cb(evt);
+    http_conn_t *conn = evt->user_data;
+    switch (evt->event_id)
+    {
+    case HTTP_EVENT_ON_CONNECTED:
+        conn->connected = true;
+        conn->stats.connects++;
+        record_handshake(&conn->stats.handshakes, conn->connect_start_us, conn->has_session);
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+        conn->has_session = true;
+#endif
+        break;
+    case HTTP_EVENT_DISCONNECTED:
+        conn->connected = false;
+        break;
+    case HTTP_EVENT_ON_HEADER:
+    case HTTP_EVENT_ON_DATA:
+        if (conn->cancel && atomic_load(conn->cancel))
+        {
+            // spotify_request_cancel(): keep what's left of the response
+            // out of the parser; the shortened timeout ends the transfer
+            return ESP_OK;
+        }
+        break;
+    default:
+        break;
+    }
+    evt->user_data = &conn->user_data;
+    return conn->http_event_cb(evt);
 }
 
-static inline esp_err_t http_retries_available(esp_spotify_client_handle_t client, esp_err_t err)
+static inline esp_err_t http_retries_available(http_conn_t *conn, esp_err_t err)
 {
     ESP_LOGE(TAG, "HTTP request failed: %s", esp_err_to_name(err));
-    if (++(client->s_retries) <= RETRIES_ERR_CONN)
+    if (++(conn->retries) <= RETRIES_ERR_CONN)
     {
-        esp_http_client_close(client->http_client.handle);
+        http_client_close(conn);
         vTaskDelay(pdMS_TO_TICKS(HTTP_RETRY_DELAY_MS));
-        ESP_LOGW(TAG, "Retrying %d/%d...", client->s_retries, RETRIES_ERR_CONN);
+        ESP_LOGW(TAG, "Retrying %d/%d...", conn->retries, RETRIES_ERR_CONN);
         debug_mem();
         return ESP_OK;
     }
-    client->s_retries = 0;
     return ESP_FAIL;
 }
 
@@ -293,29 +480,94 @@ static inline void prepare_client(esp_http_client_handle_t http_client, const ch
     esp_http_client_set_header(http_client, "Content-Type", content_type);
 }
 
+/* esp_http_client_close() already dispatches HTTP_EVENT_DISCONNECTED (which
+ * clears `connected` in http_event_cb_wrapper) whenever it actually had
+ * something open; clearing it here too just makes that explicit. */
+static inline void http_client_close(http_conn_t *conn)
+{
+    esp_http_client_close(conn->handle);
+    conn->connected = false;
+}
+
+/* Servers drop idle keep-alive connections on their own schedule, and a
+ * request on such a socket only fails after the write/read round trip.
+ * Closing it ourselves past CONFIG_SPOTIFY_HTTP_KEEP_ALIVE_IDLE_MS turns that
+ * into a plain fresh connect. */
+static inline void http_client_expire_idle(http_conn_t *conn)
+{
+#if CONFIG_SPOTIFY_HTTP_KEEP_ALIVE && CONFIG_SPOTIFY_HTTP_KEEP_ALIVE_IDLE_MS > 0
+    if (conn->connected &&
+        esp_timer_get_time() - conn->last_used_us > (int64_t)CONFIG_SPOTIFY_HTTP_KEEP_ALIVE_IDLE_MS * 1000)
+    {
+        ESP_LOGD(TAG, "Kept-alive connection idle for too long, closing it");
+        http_client_close(conn);
+    }
+#endif
+}
+
 /**
- * @brief Sets up and performs a single logical HTTP request on
- * client->http_client.handle, retrying on connection errors up to
- * RETRIES_ERR_CONN times, and closes the connection before returning.
+ * @brief Sets up and performs a single logical HTTP request on the pooled
+ * connection for `host` (client->http_pool[host]), retrying on connection errors up to
+ * RETRIES_ERR_CONN times.
+ *
+ * With CONFIG_SPOTIFY_HTTP_KEEP_ALIVE the connection is left open on success
+ * so the next request skips the TCP+TLS handshake; if that reused connection
+ * turns out to be dead (closed server-side), it's reopened once right away,
+ * without consuming one of the RETRIES_ERR_CONN attempts or their back-off
+ * delay. It's always closed on failure, and after every request without
+ * keep-alive.
  *
- * Caller must already hold client->http_buf_lock and must have set
- * client->http_client.http_event_cb (and user_data.ctx / post field
+ * On the async worker, a spotify_request_cancel() of the request being run
+ * stops this early with HTTP_ERR_CANCELLED: before sending, or at the
+ * attempt's next socket wait (see spotify_request_cancel()), dropping the
+ * connection.
+ *
+ * Caller must already hold http_sched_lane_of(host) and must have set
+ * client->http_pool[host].http_event_cb (and user_data.ctx / post field
  * beforehand, if the request needs them) before calling this.
  */
-esp_err_t perform_http_request(esp_spotify_client_handle_t client, const char *auth, const char *content_type, const char *url, esp_http_client_method_t method, HttpStatus_Code *status_code)
+esp_err_t perform_http_request(esp_spotify_client_handle_t client, spotify_http_host_t host, const char *auth, const char *content_type, const char *url, esp_http_client_method_t method, HttpStatus_Code *status_code)
 {
     esp_err_t err;
     HttpStatus_Code s_code = 0;
-    prepare_client(client->http_client.handle, auth, content_type, url, method);
-    do
+    http_conn_t *conn = &client->http_pool[host];
+    bool stale_retried = false;
+    prepare_client(conn->handle, auth, content_type, url, method);
+    http_client_expire_idle(conn);
+    conn->stats.requests++;
+    conn->cancel = async_worker_cancel_flag(&client->async);
+    for (;;)
     {
-        ESP_LOGD(TAG, "Endpoint to send: %s", url);
-        err = esp_http_client_perform(client->http_client.handle);
+        if (conn->cancel && !async_worker_begin_send(&client->async, conn->handle))
+        {
+            // cancelled while waiting for the lane, or between retries
+            err = HTTP_ERR_CANCELLED;
+            break;
+        }
+        bool reused = conn->connected;
+        ESP_LOGD(TAG, "Endpoint to send: %s (%s connection)", url, reused ? "reused" : "new");
+        conn->connect_start_us = esp_timer_get_time();
+        err = esp_http_client_perform(conn->handle);
+        if (conn->cancel)
+        {
+            async_worker_end_send(&client->async);
+            if (atomic_load(conn->cancel))
+            {
+                // whatever perform() returned, the response is incomplete
+                // or unwanted and the connection mid-transfer
+                ESP_LOGI(TAG, "Request cancelled, dropping the connection");
+                err = HTTP_ERR_CANCELLED;
+                break;
+            }
+        }
         if (err == ESP_OK)
         {
-            client->s_retries = 0;
-            s_code = esp_http_client_get_status_code(client->http_client.handle);
-            int length = esp_http_client_get_content_length(client->http_client.handle);
+            if (reused)
+            {
+                conn->stats.reused++;
+            }
+            s_code = esp_http_client_get_status_code(conn->handle);
+            int length = esp_http_client_get_content_length(conn->handle);
             ESP_LOGD(TAG, "HTTP Status Code = %d, content_length = %d", s_code, length);
             break;
         }
@@ -328,20 +580,160 @@ esp_err_t perform_http_request(esp_spotify_client_handle_t client, const char *a
              * regardless; report it as the clean 401 it is, so callers'
              * "refresh token and retry on 401" logic (gated on
              * err == ESP_OK) isn't skipped (ANALYSIS.md 1.19). */
-            HttpStatus_Code real_status = esp_http_client_get_status_code(client->http_client.handle);
+            HttpStatus_Code real_status = esp_http_client_get_status_code(conn->handle);
             if (real_status == HttpStatus_Unauthorized)
             {
-                client->s_retries = 0;
                 s_code = real_status;
                 err = ESP_OK;
+                /* perform() bailed out before reading the 401's body, so
+                 * this connection isn't at a clean request boundary. */
+                http_client_close(conn);
                 break;
             }
         }
-    } while (http_retries_available(client, err) == ESP_OK);
-    esp_http_client_close(client->http_client.handle);
+        if (reused && !stale_retried)
+        {
+            ESP_LOGW(TAG, "Kept-alive connection is stale (%s), reconnecting", esp_err_to_name(err));
+            http_client_close(conn);
+            conn->stats.stale_reconnects++;
+            stale_retried = true;
+            continue;
+        }
+        if (http_retries_available(conn, err) != ESP_OK)
+        {
+            break;
+        }
+    }
+    // the retry budget is per request, however this one ended (cancelled
+    // included): the next one on this connection starts with all of it
+    conn->retries = 0;
+#if CONFIG_SPOTIFY_HTTP_KEEP_ALIVE
+    if (err != ESP_OK)
+    {
+        http_client_close(conn);
+    }
+#else
+    http_client_close(conn);
+#endif
+    conn->last_used_us = esp_timer_get_time();
+    conn->cancel = NULL;
     if (status_code)
     {
         *status_code = s_code;
     }
     return err;
 }
+
+/* Sets up the pooled connection for `host`: its esp_http_client handle
+ * (user_data is the http_conn_t itself, see http_event_cb_wrapper) and, if
+ * http_hosts[] says it owns one, its receive buffer. */
+static esp_err_t http_pool_init_conn(esp_spotify_client_handle_t client, spotify_http_host_t host)
+{
+    http_conn_t *conn = &client->http_pool[host];
+    if (http_hosts[host].buffer_size)
+    {
+        conn->user_data.buffer = (uint8_t *)calloc(1, http_hosts[host].buffer_size);
+        if (!conn->user_data.buffer)
+        {
+            ESP_LOGE(TAG, "Error allocating HTTP buffer for %s", http_hosts[host].url);
+            return ESP_ERR_NO_MEM;
+        }
+        conn->user_data.buffer_size = http_hosts[host].buffer_size;
+    }
+
+    esp_http_client_config_t http_cfg = {
+        .url = http_hosts[host].url,
+        .user_data = conn,
+        .event_handler = http_event_cb_wrapper,
+#if CONFIG_SPOTIFY_GLOBAL_CA_STORE
+        .use_global_ca_store = true,
+#else
+        .cert_pem = certs_pem_start,
+#endif
+        .buffer_size_tx = DEFAULT_HTTP_BUF_SIZE + 256,
+        .timeout_ms = HTTP_TIMEOUT_MS,
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+        /* Keep the TLS session of the last connection and offer its ticket
+         * on the next connect, so reconnects (idle expiry, stale keep-alive,
+         * Wi-Fi drops) get an abbreviated handshake instead of a full ECDHE
+         * one. */
+        .save_client_session = true,
+#endif
+    };
+    conn->handle = esp_http_client_init(&http_cfg);
+    if (!conn->handle)
+    {
+        ESP_LOGE(TAG, "Error on esp_http_client_init() for %s", http_hosts[host].url);
+        return ESP_FAIL;
+    }
+    conn->http_event_cb = json_http_event_cb;
+    return ESP_OK;
+}
+
+static void record_handshake(spotify_handshake_stats_t *hs, int64_t start_us, bool offered)
+{
+    uint32_t ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+    if (offered)
+    {
+        hs->offered++;
+        hs->offered_ms_total += ms;
+    }
+    else
+    {
+        hs->full++;
+        hs->full_ms_total += ms;
+    }
+    hs->last_ms = ms;
+    hs->last_offered = offered;
+    ESP_LOGD(TAG, "TLS handshake (%s) took %" PRIu32 " ms", offered ? "session offered" : "full", ms);
+}
+
+/* esp_websocket_client has no session ticket support (no equivalent of
+ * save_client_session), so every dealer connect is a full handshake; it's
+ * still timed here so it can be compared against the HTTP side. */
+static void ws_handshake_event_cb(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
+{
+    esp_spotify_client_handle_t client = handler_args;
+    switch (event_id)
+    {
+    case WEBSOCKET_EVENT_BEFORE_CONNECT:
+        client->ws_client.connect_start_us = esp_timer_get_time();
+        break;
+    case WEBSOCKET_EVENT_CONNECTED:
+        record_handshake(&client->ws_client.handshakes, client->ws_client.connect_start_us, false);
+        break;
+    default:
+        break;
+    }
+}
+
+static esp_err_t ca_store_acquire(void)
+{
+    if (ca_store_users == 0)
+    {
+        uint32_t heap_before = esp_get_free_heap_size();
+        int64_t start_us = esp_timer_get_time();
+        /* EMBED_TXTFILES NUL-terminates the blob and certs_pem_end points
+         * past that NUL, which is what mbedTLS' PEM parser expects the
+         * length to include. */
+        esp_err_t err = esp_tls_set_global_ca_store((const unsigned char *)certs_pem_start, certs_pem_end - certs_pem_start);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to load CA bundle into the global CA store: %s", esp_err_to_name(err));
+            esp_tls_free_global_ca_store();
+            return err;
+        }
+        ESP_LOGI(TAG, "Global CA store loaded: %" PRId64 " us, %" PRIi32 " bytes of heap",
+                 esp_timer_get_time() - start_us, (int32_t)(heap_before - esp_get_free_heap_size()));
+    }
+    ca_store_users++;
+    return ESP_OK;
+}
+
+static void ca_store_release(void)
+{
+    if (ca_store_users && --ca_store_users == 0)
+    {
+        esp_tls_free_global_ca_store();
+    }
+}
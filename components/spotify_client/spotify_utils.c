@@ -68,16 +68,9 @@ void spotify_free_nodes(List* list)
             free(node->data);
             break;
         case PLAYLIST_LIST:
-            PlaylistItem_t* playlist_item = node->data;
-            free(playlist_item->name);
-            free(playlist_item->uri);
-            free(playlist_item);
-            break;
         case DEVICE_LIST:
-            DeviceItem_t* device_item = node->data;
-            free(device_item->name);
-            free(device_item->id);
-            free(device_item);
+            // strings live in the same allocation (see PlaylistItem_t)
+            free(node->data);
             break;
         case TRACK_LIST:
             TrackSearchItem_t* track_item = node->data;
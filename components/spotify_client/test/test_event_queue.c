@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <string.h>
+#include "event_queue.h"
+#include "track_snapshot.h"
+#include "unity.h"
+
+/* A track event carrying a fresh snapshot of track `id`; anything else
+ * with id as its error_code. */
+static void push(event_queue_t *queue, PlayerEvent_t player_event, int id)
+{
+    SpotifyEvent_t event = { .player_event = player_event, .error_code = id };
+    if (player_event == SAME_TRACK || player_event == NEW_TRACK)
+    {
+        TrackInfo *track = track_snapshot_new(0, 0, NULL);
+        TEST_ASSERT_NOT_NULL(track);
+        snprintf(track->id, sizeof(track->id), "track%d", id);
+        event.payload = track;
+    }
+    event_queue_push(queue, &event);
+}
+
+/* The next event must be player_event, for track `id` (or with that
+ * error_code). */
+static void expect(event_queue_t *queue, PlayerEvent_t player_event, int id)
+{
+    SpotifyEvent_t event;
+    TEST_ASSERT_EQUAL(pdPASS, event_queue_receive(queue, &event, 0));
+    TEST_ASSERT_EQUAL(player_event, event.player_event);
+    if (player_event == SAME_TRACK || player_event == NEW_TRACK)
+    {
+        char expected[SPOTIFY_ID_BUF_SIZE];
+        snprintf(expected, sizeof(expected), "track%d", id);
+        TEST_ASSERT_EQUAL_STRING(expected, ((const TrackInfo *)event.payload)->id);
+        spotify_track_unref(event.payload);
+    }
+    else
+    {
+        TEST_ASSERT_EQUAL(id, event.error_code);
+    }
+}
+
+TEST_CASE("event queue delivers the newest of more NEW_TRACKs than it holds", "[spotify_client]")
+{
+    event_queue_t queue;
+    TEST_ASSERT_EQUAL(ESP_OK, event_queue_init(&queue));
+    for (int i = 0; i < 3 * EVENT_QUEUE_DEPTH; i++)
+    {
+        push(&queue, NEW_TRACK, i);
+    }
+    expect(&queue, NEW_TRACK, 3 * EVENT_QUEUE_DEPTH - 1);
+    SpotifyEvent_t event;
+    TEST_ASSERT_EQUAL(pdFAIL, event_queue_receive(&queue, &event, 0));
+    event_queue_deinit(&queue);
+}
+
+TEST_CASE("event queue coalesces track events, keeps the rest in order", "[spotify_client]")
+{
+    event_queue_t queue;
+    TEST_ASSERT_EQUAL(ESP_OK, event_queue_init(&queue));
+    push(&queue, SAME_TRACK, 1);
+    push(&queue, PLAYER_ERROR, 401);
+    push(&queue, NEW_TRACK, 2);
+    push(&queue, SAME_TRACK, 2);
+    push(&queue, NO_PLAYER_ACTIVE, 0);
+    push(&queue, SAME_TRACK, 3); // replaces only the pending SAME_TRACK
+    expect(&queue, PLAYER_ERROR, 401);
+    expect(&queue, NEW_TRACK, 2);
+    expect(&queue, NO_PLAYER_ACTIVE, 0);
+    expect(&queue, SAME_TRACK, 3);
+
+    // the errors fill it, the track events still get through
+    for (int i = 0; i < EVENT_QUEUE_DEPTH - 1; i++)
+    {
+        push(&queue, PLAYER_ERROR, 500 + i);
+    }
+    push(&queue, NEW_TRACK, 4);
+    push(&queue, NEW_TRACK, 5);
+    for (int i = 0; i < EVENT_QUEUE_DEPTH - 1; i++)
+    {
+        expect(&queue, PLAYER_ERROR, 500 + i);
+    }
+    expect(&queue, NEW_TRACK, 5);
+
+    push(&queue, NEW_TRACK, 6); // released by deinit
+    event_queue_deinit(&queue);
+}
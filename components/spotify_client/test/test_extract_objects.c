@@ -0,0 +1,122 @@
+#include <limits.h>
+#include <string.h>
+#include "extract_objects.h"
+#include "json_parser.h"
+#include "unity.h"
+
+#define MAX_TEST_TOKENS 64
+
+/* Tokenizes js and runs extract_record() on its root object; INT_MIN
+ * (which no assertion below expects) if js itself doesn't tokenize. */
+static int extract(const char *js, ex_record_t *out)
+{
+    static json_tok_t tokens[MAX_TEST_TOKENS];
+    jparse_ctx_t jctx;
+    if (json_parse_start_static(&jctx, js, strlen(js), tokens, MAX_TEST_TOKENS) != OS_SUCCESS) {
+        return INT_MIN;
+    }
+    int ret = extract_record(js, jctx.tokens, jctx.num_tokens, 0, out);
+    json_parse_end_static(&jctx);
+    return ret;
+}
+
+static bool str_is(json_str_t s, const char *expected)
+{
+    return s.len == (int)strlen(expected) && memcmp(s.str, expected, s.len) == 0;
+}
+
+TEST_CASE("extractor fills every field type", "[spotify_client]")
+{
+    ex_record_t r;
+    TEST_ASSERT_EQUAL(OS_SUCCESS, extract("{\"id\": \"a\\\"b\", \"count\": -3, \"total\": 1718000000000,"
+                                          " \"flag\": true, \"inner\": {\"n\": 7},"
+                                          " \"tags\": [\"x\"], \"points\": [{\"x\": 1}, {\"x\": 2}]}", &r));
+    TEST_ASSERT(str_is(r.id, "a\\\"b")); // still escaped
+    TEST_ASSERT_EQUAL(-3, r.count);
+    TEST_ASSERT(r.has_total && r.total == 1718000000000LL);
+    TEST_ASSERT(r.has_flag && r.flag);
+    TEST_ASSERT(r.has_inner && r.inner.n == 7);
+    TEST_ASSERT(r.has_tags && r.tags_count == 1 && str_is(r.tags[0], "x"));
+    TEST_ASSERT(r.has_points && r.points_count == 2 && r.points[0].x == 1 && r.points[1].x == 2);
+}
+
+TEST_CASE("extractor fails on a missing required field", "[spotify_client]")
+{
+    ex_record_t r;
+    TEST_ASSERT_EQUAL(-OS_FAIL, extract("{\"id\": \"a\"}", &r));
+    TEST_ASSERT_EQUAL(-OS_FAIL, extract("{\"count\": 1}", &r));
+    TEST_ASSERT_EQUAL(-OS_FAIL, extract("{}", &r));
+
+    // optional ones are only reported missing
+    TEST_ASSERT_EQUAL(OS_SUCCESS, extract("{\"count\": 1, \"id\": \"a\"}", &r));
+    TEST_ASSERT_FALSE(r.has_total || r.has_flag || r.has_inner || r.has_tags || r.has_points);
+
+    // ...as is an optional object missing one of its own required fields
+    TEST_ASSERT_EQUAL(OS_SUCCESS, extract("{\"id\": \"a\", \"count\": 1, \"inner\": {\"m\": 7}}", &r));
+    TEST_ASSERT_FALSE(r.has_inner);
+}
+
+TEST_CASE("extractor keeps max_items elements and skips the rest", "[spotify_client]")
+{
+    ex_record_t r;
+    TEST_ASSERT_EQUAL(OS_SUCCESS, extract("{\"tags\": [\"a\", \"b\", \"c\", [\"d\"], {\"e\": 1}],"
+                                          " \"points\": [{\"x\": 1}, {\"x\": 2}, {\"x\": 3}],"
+                                          " \"id\": \"after\", \"count\": 4}", &r));
+    TEST_ASSERT_EQUAL(2, r.tags_count);
+    TEST_ASSERT(str_is(r.tags[0], "a") && str_is(r.tags[1], "b"));
+    TEST_ASSERT_EQUAL(2, r.points_count);
+    TEST_ASSERT(r.points[0].x == 1 && r.points[1].x == 2);
+    // the skipped elements don't throw off the fields after the array
+    TEST_ASSERT(str_is(r.id, "after"));
+    TEST_ASSERT_EQUAL(4, r.count);
+
+    // elements that fail to extract don't take a slot
+    TEST_ASSERT_EQUAL(OS_SUCCESS, extract("{\"id\": \"a\", \"count\": 1, \"tags\": [5, \"toolongtag\", \"b\", \"c\"],"
+                                          " \"points\": [{\"y\": 1}, {\"x\": 2}]}", &r));
+    TEST_ASSERT_EQUAL(2, r.tags_count);
+    TEST_ASSERT(str_is(r.tags[0], "b") && str_is(r.tags[1], "c"));
+    TEST_ASSERT_EQUAL(1, r.points_count);
+    TEST_ASSERT_EQUAL(2, r.points[0].x);
+}
+
+TEST_CASE("extractor takes the first usable of duplicated keys", "[spotify_client]")
+{
+    ex_record_t r;
+    TEST_ASSERT_EQUAL(OS_SUCCESS, extract("{\"id\": \"first\", \"count\": 1, \"id\": \"second\", \"count\": 2}", &r));
+    TEST_ASSERT(str_is(r.id, "first"));
+    TEST_ASSERT_EQUAL(1, r.count);
+
+    // an unusable first occurrence leaves the field to a later one
+    TEST_ASSERT_EQUAL(OS_SUCCESS, extract("{\"id\": \"a\", \"count\": \"1\", \"count\": 2,"
+                                          " \"inner\": {}, \"inner\": {\"n\": 3}}", &r));
+    TEST_ASSERT_EQUAL(2, r.count);
+    TEST_ASSERT(r.has_inner && r.inner.n == 3);
+}
+
+TEST_CASE("extractor rejects values of the wrong type", "[spotify_client]")
+{
+    ex_record_t r;
+    // required: the object fails
+    TEST_ASSERT_EQUAL(-OS_FAIL, extract("{\"id\": \"a\", \"count\": \"1\"}", &r));
+    TEST_ASSERT_EQUAL(-OS_FAIL, extract("{\"id\": \"a\", \"count\": 1.5}", &r));
+    TEST_ASSERT_EQUAL(-OS_FAIL, extract("{\"id\": 1, \"count\": 1}", &r));
+    TEST_ASSERT_EQUAL(-OS_FAIL, extract("{\"id\": \"toolongid\", \"count\": 1}", &r));
+    // optional: only reported missing
+    TEST_ASSERT_EQUAL(OS_SUCCESS, extract("{\"id\": \"a\", \"count\": 1, \"flag\": 1, \"total\": null,"
+                                          " \"inner\": [7], \"tags\": \"x\", \"points\": {\"x\": 1}}", &r));
+    TEST_ASSERT_FALSE(r.has_flag || r.has_total || r.has_inner || r.has_tags || r.has_points);
+    // the root itself
+    TEST_ASSERT_EQUAL(-OS_FAIL, extract("[{\"id\": \"a\", \"count\": 1}]", &r));
+}
+
+TEST_CASE("extractor skips unknown members, nested ones included", "[spotify_client]")
+{
+    ex_record_t r;
+    TEST_ASSERT_EQUAL(OS_SUCCESS, extract("{\"extra\": {\"id\": \"no\", \"count\": 9, \"inner\": {\"n\": 9}},"
+                                          " \"list\": [{\"count\": 8}, [[]], {}],"
+                                          " \"id\": \"yes\", \"more\": {\"a\": {\"b\": {\"count\": 7}}},"
+                                          " \"count\": 1, \"inner\": {\"skip\": {\"n\": 6}, \"n\": 2}}", &r));
+    TEST_ASSERT(str_is(r.id, "yes"));
+    TEST_ASSERT_EQUAL(1, r.count);
+    TEST_ASSERT(r.has_inner && r.inner.n == 2);
+}
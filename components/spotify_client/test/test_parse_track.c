@@ -0,0 +1,77 @@
+#include <string.h>
+#include "parse_objects.h"
+#include "track_snapshot.h"
+#include "unity.h"
+
+#define CURRENT_ID "a3dDVhYRnKTbxTNJFoBinF"
+
+/* A PLAYER_STATE_CHANGED push around `state`, the way the dealer sends it. */
+#define WS_PUSH(state) "{\"payloads\":[{\"events\":[{\"event\":{\"state\":" state "}," \
+                       "\"type\":\"PLAYER_STATE_CHANGED\",\"uri\":\"spotify:user:someone\"}]}]," \
+                       "\"type\":\"message\",\"uri\":\"wss://event\"}"
+#define STATE(progress, item_id, album_id) "{\"device\":{\"volume_percent\":48},\"progress_ms\":" progress "," \
+    "\"item\":{\"album\":{\"id\":\"" album_id "\",\"images\":[{\"height\":300,\"url\":\"https://i.scdn.co/x\"}]," \
+    "\"name\":\"Album\"},\"artists\":[{\"name\":\"Artist\"}],\"duration_ms\":200000,\"id\":\"" item_id "\"," \
+    "\"name\":\"Track\"},\"is_playing\":true}"
+
+/* parse_track() on js, against a stale snapshot of CURRENT_ID; *tokens is
+ * whether it had to tokenize the message. */
+static SpotifyEvent_t parse(const char *js, TrackInfo **track, bool *tokens)
+{
+    parse_scratch_t scratch;
+    parse_scratch_init(&scratch);
+    *track = track_snapshot_new(0, 0, NULL);
+    TEST_ASSERT_NOT_NULL(*track);
+    strcpy((*track)->id, CURRENT_ID);
+    (*track)->device.volume_percent = -1;
+    SpotifyEvent_t evt = parse_track(js, track, 0, &scratch);
+    *tokens = scratch.stats.peak_tokens[SPOTIFY_PARSE_PLAYER_STATE] > 0;
+    parse_scratch_free(&scratch);
+    return evt;
+}
+
+static void expect_same_track(const char *js, bool tokens_expected)
+{
+    TrackInfo *track;
+    bool tokens;
+    SpotifyEvent_t evt = parse(js, &track, &tokens);
+    TEST_ASSERT_EQUAL(SAME_TRACK, evt.player_event);
+    TEST_ASSERT_EQUAL(tokens_expected, tokens);
+    const TrackInfo *info = evt.payload;
+    TEST_ASSERT_EQUAL_STRING(CURRENT_ID, info->id);
+    TEST_ASSERT_EQUAL(81234, (int)info->progress_ms);
+    TEST_ASSERT_TRUE(info->isPlaying);
+    TEST_ASSERT_EQUAL(48, info->device.volume_percent);
+    spotify_track_unref(evt.payload);
+    spotify_track_unref(track);
+}
+
+static void expect_new_track(const char *js)
+{
+    TrackInfo *track;
+    bool tokens;
+    SpotifyEvent_t evt = parse(js, &track, &tokens);
+    TEST_ASSERT_EQUAL(NEW_TRACK, evt.player_event);
+    TEST_ASSERT_EQUAL_STRING("2zg4mZaouqKLiMcVbpT4r5", ((const TrackInfo *)evt.payload)->id);
+    spotify_track_unref(evt.payload);
+    spotify_track_unref(track);
+}
+
+TEST_CASE("parse_track reads a same-track push without tokenizing it", "[spotify_client]")
+{
+    expect_same_track(WS_PUSH(STATE("81234", CURRENT_ID, "5aJXVuLkSIc47WQAmL9xVQ")), false);
+    // anything it isn't sure about still ends up a SAME_TRACK, the long way
+    expect_same_track(WS_PUSH(STATE(" 81234", CURRENT_ID, "5aJXVuLkSIc47WQAmL9xVQ")), true);
+    expect_same_track("{\"payloads\":[{\"events\":[{\"event\":{\"state\":" STATE("81234", CURRENT_ID, "x") "},"
+                      "\"type\":\"PLAYER_STATE_CHANGED\"},{\"event\":{\"state\":" STATE("1", CURRENT_ID, "x") "},"
+                      "\"type\":\"PLAYER_STATE_CHANGED\"}]}],\"uri\":\"wss://event\"}", true);
+}
+
+TEST_CASE("parse_track takes the current id only from the item", "[spotify_client]")
+{
+    expect_new_track(WS_PUSH(STATE("81234", "2zg4mZaouqKLiMcVbpT4r5", "5aJXVuLkSIc47WQAmL9xVQ")));
+    // the same id ahead of the item isn't the item's
+    expect_new_track("{\"id\":\"" CURRENT_ID "\",\"payloads\":[{\"events\":[{\"event\":{\"state\":"
+                     STATE("81234", "2zg4mZaouqKLiMcVbpT4r5", "x") "},\"type\":\"PLAYER_STATE_CHANGED\"}]}],"
+                     "\"uri\":\"wss://event\"}");
+}
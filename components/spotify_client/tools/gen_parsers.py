@@ -0,0 +1,312 @@
+#!/usr/bin/env python3
+"""Generates specialized extractors from schema/spotify_objects.json.
+
+Usage: gen_parsers.py <schema.json> <output dir>
+
+Writes extract_objects.h/.c. For every top-level entry of "objects" there is
+a struct ex_<name>_t and
+
+    int extract_<name>(const char *js, const json_tok_t *tokens, int num_tokens,
+                       int root, ex_<name>_t *out);
+
+which fills it from the object at tokens[root] (as tokenized by json_parser /
+jsmn) in a single forward pass: every member is dispatched on its key's
+length and bytes once, values nobody asked for are skipped by token range,
+so each token is looked at no more than once - unlike a json_obj_get_*()
+call per field, which rescans the object each time.
+
+Schema, per field:
+    "type":      "string" | "int" | "int64" | "bool" | "object" | "array"
+    "optional":  true to accept it missing (out->has_<field> tells); a
+                 missing required field, or one with the wrong type, fails
+                 the enclosing object
+    "max_len":   strings only, longest raw (still escaped) length accepted;
+                 a number or a C expression (the "includes" are in scope)
+    "fields":    objects only, the members to extract
+    "items":     arrays only, the element schema (any non-array type)
+    "max_items": arrays only, elements kept (<field>_count); the rest, and
+                 elements that fail to extract, are skipped
+
+Strings come out as json_str_t views into js, still escaped (json_unescape()
+decodes them); of duplicated keys, the first usable occurrence wins. The
+static helpers are inline so a schema not using some type doesn't warn.
+"""
+import json
+import os
+import sys
+
+SCALARS = {
+    # type: (C type, extractor helper)
+    'string': ('json_str_t', 'ex_str'),
+    'int': ('int', 'ex_int'),
+    'int64': ('int64_t', 'ex_int64'),
+    'bool': ('bool', 'ex_bool'),
+}
+
+HELPERS = r'''
+typedef struct {
+    const char *js;
+    const json_tok_t *t;
+    int n;
+} ex_ctx_t;
+
+/* Index of the first token after the value at i (and all it contains). */
+static inline int ex_skip(const ex_ctx_t *c, int i)
+{
+    int end = c->t[i].end;
+    for (i++; i < c->n && c->t[i].start < end; i++) {
+    }
+    return i;
+}
+
+static inline bool ex_str(const ex_ctx_t *c, int i, json_str_t *out, int max_len)
+{
+    const json_tok_t *t = &c->t[i];
+    if (t->type != JSMN_STRING || t->end - t->start > max_len) {
+        return false;
+    }
+    out->str = c->js + t->start;
+    out->len = t->end - t->start;
+    return true;
+}
+
+static inline bool ex_int64(const ex_ctx_t *c, int i, int64_t *out)
+{
+    const json_tok_t *t = &c->t[i];
+    return t->type == JSMN_PRIMITIVE && json_str_to_int64(c->js + t->start, t->end - t->start, out) == OS_SUCCESS;
+}
+
+static inline bool ex_int(const ex_ctx_t *c, int i, int *out)
+{
+    const json_tok_t *t = &c->t[i];
+    return t->type == JSMN_PRIMITIVE && json_str_to_int(c->js + t->start, t->end - t->start, out) == OS_SUCCESS;
+}
+
+static inline bool ex_bool(const ex_ctx_t *c, int i, bool *out)
+{
+    const json_tok_t *t = &c->t[i];
+    if (t->type != JSMN_PRIMITIVE || (c->js[t->start] != 't' && c->js[t->start] != 'f')) {
+        return false;
+    }
+    *out = c->js[t->start] == 't';
+    return true;
+}
+'''
+
+
+class SchemaError(Exception):
+    pass
+
+
+def check(spec, path):
+    t = spec.get('type')
+    if t in SCALARS:
+        if 'max_len' in spec and t != 'string':
+            raise SchemaError('%s: max_len on a non-string' % path)
+    elif t == 'object':
+        fields = spec.get('fields')
+        if not fields:
+            raise SchemaError('%s: object without fields' % path)
+        if len(fields) > 32:
+            raise SchemaError('%s: more than 32 fields' % path)
+        for name, f in fields.items():
+            if not name.isidentifier():
+                raise SchemaError('%s.%s: not usable as a C identifier' % (path, name))
+            check(f, path + '.' + name)
+    elif t == 'array':
+        items = spec.get('items')
+        if not items or items.get('type') == 'array':
+            raise SchemaError('%s: array needs non-array "items"' % path)
+        if int(spec.get('max_items', 0)) <= 0:
+            raise SchemaError('%s: array needs "max_items" > 0' % path)
+        if items.get('optional'):
+            raise SchemaError('%s: array items can\'t be optional' % path)
+        check(items, path + '[]')
+    else:
+        raise SchemaError('%s: unknown type %r' % (path, t))
+
+
+class Generator:
+    def __init__(self, schema):
+        self.schema = schema
+        self.types = []   # struct definitions, innermost first
+        self.funcs = []   # static object extractors, innermost first
+        self.protos = []  # public entry points
+
+    def c_type(self, spec, name):
+        t = spec['type']
+        if t in SCALARS:
+            return SCALARS[t][0]
+        if t == 'object':
+            self.struct(spec, name)
+            return 'ex_%s_t' % name
+        return self.c_type(spec['items'], name)
+
+    def struct(self, spec, name, doc=None):
+        lines = []
+        if doc:
+            lines.append('/* %s */' % doc)
+        lines.append('typedef struct {')
+        for fname, f in spec['fields'].items():
+            ctype = self.c_type(f, '%s_%s' % (name, fname))
+            if f['type'] == 'array':
+                lines.append('    int %s_count;' % fname)
+                lines.append('    %s %s[%d];' % (ctype, fname, int(f['max_items'])))
+            else:
+                lines.append('    %s %s;' % (ctype, fname))
+            if f.get('optional'):
+                lines.append('    bool has_%s;' % fname)
+        lines.append('} ex_%s_t;' % name)
+        self.types.append('\n'.join(lines))
+        self.obj_func(spec, name)
+
+    def value(self, spec, name, dest, bit, indent):
+        """Code extracting the value at token i into dest, leaving i on the
+        token after it and setting `bit` in `seen` on success."""
+        pad = ' ' * indent
+        t = spec['type']
+        out = []
+        if t in SCALARS:
+            helper = SCALARS[t][1]
+            args = '&%s' % dest
+            if t == 'string':
+                args += ', %s' % spec.get('max_len', 'INT_MAX')
+            out.append('%sif (%s(c, i, %s)) {' % (pad, helper, args))
+            out.append('%s    seen |= %s;' % (pad, bit))
+            out.append('%s}' % pad)
+            out.append('%si = ex_skip(c, i);' % pad)
+        elif t == 'object':
+            out.append('%sif (c->t[i].type == JSMN_OBJECT) {' % pad)
+            out.append('%s    bool sub_ok = true;' % pad)
+            out.append('%s    i = obj_%s(c, i, &%s, &sub_ok);' % (pad, name, dest))
+            out.append('%s    if (sub_ok) {' % pad)
+            out.append('%s        seen |= %s;' % (pad, bit))
+            out.append('%s    }' % pad)
+            out.append('%s} else {' % pad)
+            out.append('%s    i = ex_skip(c, i);' % pad)
+            out.append('%s}' % pad)
+        else:
+            item = spec['items']
+            count = dest + '_count'
+            slot = '%s[%s]' % (dest, count)
+            out.append('%sif (c->t[i].type == JSMN_ARRAY) {' % pad)
+            out.append('%s    int elems = c->t[i].size;' % pad)
+            out.append('%s    i++;' % pad)
+            out.append('%s    while (elems-- > 0 && i < c->n) {' % pad)
+            out.append('%s        if (%s == %d) {' % (pad, count, int(spec['max_items'])))
+            out.append('%s            i = ex_skip(c, i);' % pad)
+            out.append('%s            continue;' % pad)
+            out.append('%s        }' % pad)
+            out.append('%s        uint32_t seen_elem = 0;' % pad)
+            # element extraction reuses value() with its own `seen`
+            inner = self.value(item, name, slot, '1u', indent + 8)
+            out.append('\n'.join(inner).replace('seen |=', 'seen_elem |='))
+            out.append('%s        if (seen_elem) {' % pad)
+            out.append('%s            %s++;' % (pad, count))
+            out.append('%s        }' % pad)
+            out.append('%s    }' % pad)
+            out.append('%s    seen |= %s;' % (pad, bit))
+            out.append('%s} else {' % pad)
+            out.append('%s    i = ex_skip(c, i);' % pad)
+            out.append('%s}' % pad)
+        return out
+
+    def obj_func(self, spec, name):
+        fields = list(spec['fields'].items())
+        required = 0
+        for n, (fname, f) in enumerate(fields):
+            if not f.get('optional'):
+                required |= 1 << n
+        body = []
+        body.append('static int obj_%s(const ex_ctx_t *c, int i, ex_%s_t *out, bool *ok)' % (name, name))
+        body.append('{')
+        body.append('    uint32_t seen = 0;')
+        body.append('    int members = c->t[i].size;')
+        body.append('    memset(out, 0, sizeof(*out));')
+        body.append('    i++;')
+        body.append('    while (members-- > 0 && i + 1 < c->n) {')
+        body.append('        const char *key = c->js + c->t[i].start;')
+        body.append('        int key_len = c->t[i].end - c->t[i].start;')
+        body.append('        i++;')
+        for n, (fname, f) in enumerate(fields):
+            bit = '(1u << %d)' % n
+            kw = 'if' if n == 0 else '} else if'
+            body.append('        %s (key_len == %d && !(seen & %s) && memcmp(key, "%s", %d) == 0) {'
+                        % (kw, len(fname), bit, fname, len(fname)))
+            body.extend(self.value(f, '%s_%s' % (name, fname), 'out->' + fname, bit, 12))
+        body.append('        } else {')
+        body.append('            i = ex_skip(c, i);')
+        body.append('        }')
+        body.append('    }')
+        for n, (fname, f) in enumerate(fields):
+            if f.get('optional'):
+                body.append('    out->has_%s = seen & (1u << %d);' % (fname, n))
+        body.append('    if ((seen & 0x%xu) != 0x%xu) {' % (required, required))
+        body.append('        *ok = false;')
+        body.append('    }')
+        body.append('    return i;')
+        body.append('}')
+        self.funcs.append('\n'.join(body))
+
+    def run(self):
+        for name, spec in self.schema['objects'].items():
+            if not name.isidentifier():
+                raise SchemaError('%s: not usable as a C identifier' % name)
+            spec = dict(spec, type='object')
+            check(spec, name)
+            self.struct(spec, name, spec.get('doc'))
+            self.protos.append(
+                'int extract_%s(const char *js, const json_tok_t *tokens, int num_tokens, int root, ex_%s_t *out);'
+                % (name, name))
+            self.funcs.append('\n'.join([
+                'int extract_%s(const char *js, const json_tok_t *tokens, int num_tokens, int root, ex_%s_t *out)'
+                % (name, name),
+                '{',
+                '    ex_ctx_t c = { .js = js, .t = tokens, .n = num_tokens };',
+                '    bool ok = true;',
+                '    if (root < 0 || root >= num_tokens || tokens[root].type != JSMN_OBJECT) {',
+                '        return -OS_FAIL;',
+                '    }',
+                '    obj_%s(&c, root, out, &ok);' % name,
+                '    return ok ? OS_SUCCESS : -OS_FAIL;',
+                '}',
+            ]))
+
+
+def main(argv):
+    if len(argv) != 3:
+        sys.stderr.write('usage: %s <schema.json> <output dir>\n' % argv[0])
+        return 2
+    with open(argv[1]) as f:
+        schema = json.load(f)
+    gen = Generator(schema)
+    try:
+        gen.run()
+    except SchemaError as e:
+        sys.stderr.write('%s: %s\n' % (argv[1], e))
+        return 1
+
+    banner = '/* Generated by gen_parsers.py from %s - do not edit. */\n' % os.path.basename(argv[1])
+    includes = ''.join('#include "%s"\n' % h for h in schema.get('includes', []))
+    header = (banner + '#pragma once\n\n'
+              '#ifdef __cplusplus\nextern "C" {\n#endif\n\n'
+              '#include <stdbool.h>\n#include <stdint.h>\n\n'
+              '#include "json_parser.h"\n' + includes + '\n' +
+              '\n\n'.join(gen.types) + '\n\n'
+              '/* OS_SUCCESS, or -OS_FAIL if tokens[root] isn\'t an object or a required\n'
+              ' * field is missing, has the wrong type or is too long. See gen_parsers.py. */\n' +
+              '\n'.join(gen.protos) + '\n\n'
+              '#ifdef __cplusplus\n}\n#endif\n')
+    source = (banner + '#include <limits.h>\n#include <stdlib.h>\n#include <string.h>\n\n'
+              '#include "extract_objects.h"\n' + HELPERS + '\n' +
+              '\n\n'.join(gen.funcs) + '\n')
+
+    os.makedirs(argv[2], exist_ok=True)
+    for fname, text in (('extract_objects.h', header), ('extract_objects.c', source)):
+        with open(os.path.join(argv[2], fname), 'w') as f:
+            f.write(text)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
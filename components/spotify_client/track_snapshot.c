@@ -0,0 +1,188 @@
+/* Includes ------------------------------------------------------------------*/
+#include "track_snapshot.h"
+#include "esp_log.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Private macro -------------------------------------------------------------*/
+#define SNAPSHOT_OF(t)    ((track_snapshot_t *)((char *)(t) - offsetof(track_snapshot_t, track)))
+#define STRING_AT(s, off) ((const char *)(s) + (off))
+
+/* Locally scoped variables --------------------------------------------------*/
+static const char *TAG = "spotify_client";
+
+/* Exported functions --------------------------------------------------------*/
+const TrackInfo *spotify_track_ref(const TrackInfo *track)
+{
+    if (track)
+    {
+        atomic_fetch_add_explicit(&SNAPSHOT_OF(track)->refs, 1, memory_order_relaxed);
+    }
+    return track;
+}
+
+void spotify_track_unref(const TrackInfo *track)
+{
+    if (!track)
+    {
+        return;
+    }
+    track_snapshot_t *snap = SNAPSHOT_OF(track);
+    // acq_rel: whoever frees it sees every other holder done with it
+    if (atomic_fetch_sub_explicit(&snap->refs, 1, memory_order_acq_rel) != 1)
+    {
+        return;
+    }
+    if (snap->owner != snap)
+    {
+        spotify_track_unref(&snap->owner->track);
+    }
+    free(snap);
+}
+
+/* "" before the first track. */
+const char *spotify_track_name(const TrackInfo *track)
+{
+    return track->strings ? STRING_AT(track->strings, track->strings->name) : "";
+}
+
+const char *spotify_track_album_name(const TrackInfo *track)
+{
+    return track->strings ? STRING_AT(track->strings, track->strings->album_name) : "";
+}
+
+/* NULL if there is no usable cover (Album.cover_size is 0 then). */
+const char *spotify_track_cover_url(const TrackInfo *track)
+{
+    if (!track->strings || !track->strings->url_cover)
+    {
+        return NULL;
+    }
+    return STRING_AT(track->strings, track->strings->url_cover);
+}
+
+int spotify_track_artist_count(const TrackInfo *track)
+{
+    return track->strings ? track->strings->artists_count : 0;
+}
+
+/* NULL if index is out of range. */
+const char *spotify_track_artist(const TrackInfo *track, int index)
+{
+    if (index < 0 || index >= spotify_track_artist_count(track))
+    {
+        return NULL;
+    }
+    return STRING_AT(track->strings, track->strings->artists[index]);
+}
+
+/* Only for copies made with spotify_clone_track(), never for a snapshot
+ * from an event (spotify_track_unref() that instead). */
+void spotify_clear_track(TrackInfo *track)
+{
+    if (!track)
+    {
+        return;
+    }
+    free((void *)track->strings);
+    track->strings = NULL;
+    track->id[0] = 0;
+    track->album.cover_size = 0;
+    track->isPlaying = false;
+    track->progress_ms = 0;
+    track->duration_ms = 0;
+    track->device.volume_percent = -1;
+}
+
+/* A copy of src that outlives it, e.g. to keep or persist a track without
+ * holding its snapshot: one allocation, whatever the number of artists.
+ * On ESP_ERR_NO_MEM dest has everything but the strings. */
+esp_err_t spotify_clone_track(TrackInfo *dest, const TrackInfo *src)
+{
+    *dest = *src;
+    if (!src->strings)
+    {
+        return ESP_OK;
+    }
+    TrackStrings *strings = malloc(src->strings->size);
+    if (!strings)
+    {
+        ESP_LOGE(TAG, "Out of memory cloning track strings");
+        dest->strings = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(strings, src->strings, src->strings->size);
+    dest->strings = strings;
+    return ESP_OK;
+}
+
+/* A snapshot owning a block for artists_count artists and text_size bytes
+ * of strings (NULs included), returned empty in *strings for the caller to
+ * fill in: snapshot and strings are a single allocation. With neither,
+ * there's no block at all (strings NULL, see the accessors). One reference:
+ * the caller's. NULL if out of memory or too big for 16-bit offsets. */
+TrackInfo *track_snapshot_new(int artists_count, size_t text_size, TrackStrings **strings)
+{
+    size_t block = 0;
+    if (artists_count || text_size)
+    {
+        block = sizeof(TrackStrings) + artists_count * sizeof(uint16_t) + text_size;
+        if (block > UINT16_MAX)
+        {
+            ESP_LOGE(TAG, "Track strings too long (%u bytes)", (unsigned)block);
+            return NULL;
+        }
+    }
+    // TrackStrings only needs 2-byte alignment, which sizeof(*snap) keeps
+    track_snapshot_t *snap = calloc(1, sizeof(*snap) + block);
+    if (!snap)
+    {
+        ESP_LOGE(TAG, "Error allocating memory for track snapshot");
+        return NULL;
+    }
+    atomic_init(&snap->refs, 1);
+    snap->owner = snap;
+    snap->track.device.volume_percent = -1; // unknown, not 0%
+    if (block)
+    {
+        TrackStrings *s = (TrackStrings *)(snap + 1);
+        s->size = sizeof(TrackStrings) + artists_count * sizeof(uint16_t);
+        s->artists_count = artists_count;
+        snap->track.strings = s;
+        if (strings)
+        {
+            *strings = s;
+        }
+    }
+    return &snap->track;
+}
+
+/* The producer's snapshot *track, made safe to change the scalar fields of
+ * (progress_ms, isPlaying, device.volume_percent, id) - never its strings.
+ * That's *track itself while nobody else holds a reference (nothing was
+ * published from it, or every consumer is done with it); otherwise a copy
+ * sharing its strings replaces it in *track, so what was published stays
+ * as it was. NULL (and *track untouched) if out of memory. */
+TrackInfo *track_snapshot_writable(TrackInfo **track)
+{
+    track_snapshot_t *snap = SNAPSHOT_OF(*track);
+    // acquire: pairs with the consumers' last unref
+    if (atomic_load_explicit(&snap->refs, memory_order_acquire) == 1)
+    {
+        return *track;
+    }
+    track_snapshot_t *copy = malloc(sizeof(*copy));
+    if (!copy)
+    {
+        ESP_LOGE(TAG, "Error allocating memory for track snapshot");
+        return NULL;
+    }
+    copy->track = snap->track;
+    copy->owner = snap->owner;
+    atomic_init(&copy->refs, 1);
+    spotify_track_ref(&copy->owner->track);
+    spotify_track_unref(*track);
+    *track = &copy->track;
+    return *track;
+}
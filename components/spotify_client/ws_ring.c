@@ -0,0 +1,289 @@
+/* Includes ------------------------------------------------------------------*/
+#include "ws_ring.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "parse_objects.h"
+#include <string.h>
+
+/* Private macro -------------------------------------------------------------*/
+#define TAG_STATE(tag)       ((ws_ring_state_t)((tag) & 3u))
+#define TAG_MAKE(seq, state) (((seq) << 2) | (state))
+/* Sequence numbers are the tag's upper 30 bits and wrap; a is older than b
+ * if it's less than half the space behind. */
+#define TAG_OLDER(a, b)      ((int32_t)(((a) & ~3u) - ((b) & ~3u)) < 0)
+
+/* Private function prototypes -----------------------------------------------*/
+static int claim_free(ws_ring_t *ring);
+static int make_room(ws_ring_t *ring);
+static bool same_track(ws_ring_t *ring, int a, int b);
+static bool drop_queued(ws_ring_t *ring, int msg, unsigned tag);
+
+/* Locally scoped variables --------------------------------------------------*/
+static const char *TAG = "spotify_client";
+
+/* Exported functions --------------------------------------------------------*/
+esp_err_t ws_ring_init(ws_ring_t *ring, int depth, size_t msg_size)
+{
+    memset(ring, 0, sizeof(*ring));
+    ring->writing = -1;
+    if (depth < 1 || depth > WS_RING_MAX_DEPTH)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    /* Only ever touched by the two tasks and parsed sequentially, so the
+     * slower external RAM costs little and keeps depth * MAX_WS_BUFFER out
+     * of internal RAM; boards without PSRAM get internal RAM instead. */
+    ring->storage = heap_caps_malloc(depth * msg_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!ring->storage)
+    {
+        ring->storage = heap_caps_malloc(depth * msg_size, MALLOC_CAP_8BIT);
+    }
+    if (!ring->storage)
+    {
+        ESP_LOGE(TAG, "Error allocating %d WebSocket buffers", depth);
+        return ESP_ERR_NO_MEM;
+    }
+    for (int i = 0; i < depth; i++)
+    {
+        ring->msgs[i].data = ring->storage + i * msg_size;
+        atomic_init(&ring->msgs[i].tag, TAG_MAKE(0u, WS_RING_FREE));
+    }
+    ring->msg_size = msg_size;
+    ring->depth = depth;
+    atomic_init(&ring->head, 0);
+    return ESP_OK;
+}
+
+void ws_ring_free(ws_ring_t *ring)
+{
+    heap_caps_free(ring->storage);
+    ring->storage = NULL;
+    ring->depth = 0;
+}
+
+/* Starts assembling a len-byte message. ESP_OK: append its fragments and
+ * commit it. Otherwise the message is dropped (and counted): it doesn't fit
+ * a buffer (ESP_ERR_INVALID_SIZE), or no buffer could be freed for it
+ * (ESP_ERR_NO_MEM).
+ *
+ * A full ring frees the buffer of a queued message instead of waiting, but
+ * only one that what player_task ends up seeing doesn't need: the oldest
+ * player state queued right before another one for the same track. The
+ * later one carries the full current state, and parse_track() applies it
+ * as a SAME_TRACK update or a NEW_TRACK alike, so the older one is pure
+ * history; one track's progress/volume/pause pushes are also what actually
+ * piles up. Anything else queued (the connection message above all, which
+ * player_task must see first) is never dropped: without such a pair the
+ * incoming message is refused instead. */
+esp_err_t ws_ring_begin(ws_ring_t *ring, size_t len)
+{
+    ws_ring_abort(ring);
+    if (len + 1 > ring->msg_size)
+    {
+        ring->stats.dropped_oversized++;
+        return ESP_ERR_INVALID_SIZE;
+    }
+    int msg = claim_free(ring);
+    if (msg < 0 && (msg = make_room(ring)) < 0)
+    {
+        // player_task may have taken and released all that was queued since
+        msg = claim_free(ring);
+    }
+    if (msg < 0)
+    {
+        ring->stats.dropped_other++;
+        ESP_LOGW(TAG, "WebSocket queue full, dropped the incoming message");
+        return ESP_ERR_NO_MEM;
+    }
+    ring->next = (msg + 1) % ring->depth;
+    ring->msgs[msg].len = len;
+    ring->msgs[msg].id_state = 0;
+    ring->writing = msg;
+    return ESP_OK;
+}
+
+/* Copies one fragment of the message begun with ws_ring_begin() to offset.
+ * No-op when it was dropped. */
+void ws_ring_append(ws_ring_t *ring, size_t offset, const void *data, size_t len)
+{
+    if (ring->writing < 0 || offset + len > ring->msgs[ring->writing].len)
+    {
+        return;
+    }
+    memcpy(ring->msgs[ring->writing].data + offset, data, len);
+}
+
+/* Queues the message begun with ws_ring_begin(), NUL-terminated. False if
+ * there was none (dropped). */
+bool ws_ring_commit(ws_ring_t *ring)
+{
+    int msg = ring->writing;
+    if (msg < 0)
+    {
+        return false;
+    }
+    ring->msgs[msg].data[ring->msgs[msg].len] = '\0';
+    ring->writing = -1;
+    // release: the message is complete before player_task can see it queued,
+    // and queued before it sees head past it
+    unsigned seq = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    atomic_store_explicit(&ring->msgs[msg].tag, TAG_MAKE(seq, WS_RING_QUEUED), memory_order_release);
+    atomic_store_explicit(&ring->head, seq + 1, memory_order_release);
+
+    ring->stats.queued++;
+    // buffers not free: queued ones plus the one player_task may be on
+    uint32_t in_use = 0;
+    for (int i = 0; i < ring->depth; i++)
+    {
+        in_use += TAG_STATE(atomic_load_explicit(&ring->msgs[i].tag, memory_order_relaxed)) != WS_RING_FREE;
+    }
+    if (in_use > ring->stats.high_water)
+    {
+        ring->stats.high_water = in_use;
+    }
+    return true;
+}
+
+/* Forgets a message begun but not committed (connection lost mid-message). */
+void ws_ring_abort(ws_ring_t *ring)
+{
+    if (ring->writing >= 0)
+    {
+        atomic_store_explicit(&ring->msgs[ring->writing].tag, TAG_MAKE(0u, WS_RING_FREE), memory_order_relaxed);
+        ring->writing = -1;
+    }
+}
+
+/* Oldest queued message, or NULL if there is none. Its buffer is
+ * player_task's until ws_ring_release(ring, *msg). */
+const char *ws_ring_take(ws_ring_t *ring, int *msg)
+{
+    while (1)
+    {
+        /* Only what was queued before head was read: buffers are scanned
+         * one at a time, and a message queued meanwhile into one already
+         * passed could hide an older one behind a newer one. */
+        unsigned limit = TAG_MAKE(atomic_load_explicit(&ring->head, memory_order_acquire), 0u);
+        int oldest = -1;
+        unsigned oldest_tag = 0;
+        for (int i = 0; i < ring->depth; i++)
+        {
+            unsigned tag = atomic_load_explicit(&ring->msgs[i].tag, memory_order_relaxed);
+            if (TAG_STATE(tag) == WS_RING_QUEUED && TAG_OLDER(tag, limit) && (oldest < 0 || TAG_OLDER(tag, oldest_tag)))
+            {
+                oldest = i;
+                oldest_tag = tag;
+            }
+        }
+        if (oldest < 0)
+        {
+            return NULL;
+        }
+        // fails only if the producer dropped it meanwhile: look again
+        if (atomic_compare_exchange_strong_explicit(&ring->msgs[oldest].tag, &oldest_tag,
+                                                    (oldest_tag & ~3u) | WS_RING_TAKEN, memory_order_acquire,
+                                                    memory_order_relaxed))
+        {
+            *msg = oldest;
+            return ring->msgs[oldest].data;
+        }
+    }
+}
+
+void ws_ring_release(ws_ring_t *ring, int msg)
+{
+    atomic_store_explicit(&ring->msgs[msg].tag, TAG_MAKE(0u, WS_RING_FREE), memory_order_release);
+}
+
+/* Drops everything queued (a new session's messages start over). */
+void ws_ring_flush(ws_ring_t *ring)
+{
+    int msg;
+    while (ws_ring_take(ring, &msg))
+    {
+        ws_ring_release(ring, msg);
+    }
+}
+
+/* Private functions ---------------------------------------------------------*/
+/* Next free buffer in turn, now WRITING; -1 if there is none. */
+static int claim_free(ws_ring_t *ring)
+{
+    for (int i = 0; i < ring->depth; i++)
+    {
+        int m = (ring->next + i) % ring->depth;
+        // acquire: pairs with ws_ring_release(), player_task is done reading it
+        if (TAG_STATE(atomic_load_explicit(&ring->msgs[m].tag, memory_order_acquire)) == WS_RING_FREE)
+        {
+            atomic_store_explicit(&ring->msgs[m].tag, TAG_MAKE(0u, WS_RING_WRITING), memory_order_relaxed);
+            return m;
+        }
+    }
+    return -1;
+}
+
+/* Producer side of ws_ring_begin()'s overflow policy: drops a superseded
+ * player state and returns its buffer, now WRITING; -1 if there is none. */
+static int make_room(ws_ring_t *ring)
+{
+    // queued buffers, oldest first (insertion sort, depth is tiny)
+    int order[WS_RING_MAX_DEPTH];
+    unsigned tags[WS_RING_MAX_DEPTH];
+    int n = 0;
+    for (int i = 0; i < ring->depth; i++)
+    {
+        unsigned tag = atomic_load_explicit(&ring->msgs[i].tag, memory_order_relaxed);
+        if (TAG_STATE(tag) != WS_RING_QUEUED)
+        {
+            continue;
+        }
+        int j = n++;
+        for (; j > 0 && TAG_OLDER(tag, tags[j - 1]); j--)
+        {
+            order[j] = order[j - 1];
+            tags[j] = tags[j - 1];
+        }
+        order[j] = i;
+        tags[j] = tag;
+    }
+
+    for (int i = 0; i + 1 < n; i++)
+    {
+        if (same_track(ring, order[i], order[i + 1]) && drop_queued(ring, order[i], tags[i]))
+        {
+            ring->stats.dropped_same_track++;
+            ESP_LOGD(TAG, "WebSocket queue full, dropped a superseded player state");
+            return order[i];
+        }
+    }
+    return -1;
+}
+
+/* Whether queued messages a and b are player states for the same track.
+ * Ids are only extracted here, on overflow, and kept with the buffer. Reading
+ * a buffer player_task may be taking meanwhile is fine: only this task ever
+ * writes them. */
+static bool same_track(ws_ring_t *ring, int a, int b)
+{
+    int m[2] = {a, b};
+    for (int i = 0; i < 2; i++)
+    {
+        ws_ring_msg_t *msg = &ring->msgs[m[i]];
+        if (!msg->id_state)
+        {
+            msg->id_state = parse_ws_track_id(msg->data, msg->track_id) ? 1 : -1;
+        }
+        if (msg->id_state < 0)
+        {
+            return false;
+        }
+    }
+    return strcmp(ring->msgs[a].track_id, ring->msgs[b].track_id) == 0;
+}
+
+/* Takes queued msg back from player_task; fails if it got to it first. */
+static bool drop_queued(ws_ring_t *ring, int msg, unsigned tag)
+{
+    return atomic_compare_exchange_strong_explicit(&ring->msgs[msg].tag, &tag, TAG_MAKE(0u, WS_RING_WRITING),
+                                                   memory_order_relaxed, memory_order_relaxed);
+}
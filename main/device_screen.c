@@ -6,102 +6,116 @@
 
 static const char *TAG = "DEVICE_SCREEN";
 
+/* Same as playlist_screen.c's: the fetch under way (0 if none) and the
+ * devices listed, under the display lock. */
+static spotify_request_t devices_req = 0;
+static List *devices = NULL;
+
+static void free_devices(void)
+{
+    if (devices)
+    {
+        // spotify_free_nodes() frees the Nodes/DeviceItem_t's but not
+        // the List struct itself (it's calloc'd by spotify_available_devices()).
+        spotify_free_nodes(devices);
+        free(devices);
+        devices = NULL;
+    }
+}
+
+/* Runs on the client's worker task once spotify_transfer_playback() is
+ * done; nothing to show, only a failure to log. */
+static void transfer_done_cb(spotify_request_t req, spotify_async_result_t *result, void *user_ctx)
+{
+    if (result->err != ESP_OK || (result->status_code != HttpStatus_Ok && result->status_code != HTTP_STATUS_NO_CONTENT))
+    {
+        ESP_LOGW(TAG, "spotify_transfer_playback() failed (err=%s, http_status=%d)", esp_err_to_name(result->err), result->status_code);
+    }
+}
+
 /* Runs on the lvgl_port task (touch dispatch) when a device row is
- * tapped; the row's id (DeviceItem_t.id, still owned by the List that
- * device_task hasn't freed yet - see device_task) was stored as the
- * event's user_data when the row button was created. Just hands it off;
- * device_task does the actual (blocking) spotify_transfer_playback call. */
+ * tapped; the row's id (DeviceItem_t.id, owned by `devices`) was stored as
+ * the event's user_data when the row button was created, and is copied by
+ * spotify_transfer_playback_async(). */
 static void device_row_clicked_cb(lv_event_t *e)
 {
     char *id = lv_event_get_user_data(e);
-    xQueueSend(device_selection_queue, &id, 0);
+    if (spotify_transfer_playback_async(client, id, transfer_done_cb, NULL, NULL) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error queueing the playback transfer");
+    }
+    device_screen_close();
 }
 
-/* Dedicated task so the (blocking) spotify_available_devices()/
- * spotify_transfer_playback() HTTP calls never freeze lvgl_port's own task
- * (which pumps lv_timer_handler() and would otherwise stall rendering/
- * input for that whole time) - same reasoning as playlist_task
- * (playlist_screen.c). Sits idle until openDevicesFn() (ui_events.c) wakes
- * it via xTaskNotifyGive(). */
-static void device_task(void *arg)
+/* Runs on the client's worker task once spotify_available_devices() is
+ * done - same as playlists_done_cb (playlist_screen.c). */
+static void devices_done_cb(spotify_request_t req, spotify_async_result_t *result, void *user_ctx)
 {
-    for (;;)
+    bsp_display_lock(0);
+    if (req != devices_req)
     {
-        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
-
-        List *devices = spotify_available_devices(client);
-
-        bsp_display_lock(0);
-        lv_obj_clean(ui_DeviceList);
-        if (!devices)
-        {
-            lv_label_set_text(ui_DeviceStatusLabel, "Error al obtener dispositivos");
-            lv_obj_clear_flag(ui_DeviceStatusLabel, LV_OBJ_FLAG_HIDDEN);
-        }
-        else if (devices->count == 0)
-        {
-            lv_label_set_text(ui_DeviceStatusLabel, "No se encontraron dispositivos");
-            lv_obj_clear_flag(ui_DeviceStatusLabel, LV_OBJ_FLAG_HIDDEN);
-        }
-        else
-        {
-            lv_obj_add_flag(ui_DeviceStatusLabel, LV_OBJ_FLAG_HIDDEN);
-            Node *node = devices->first;
-            while (node)
-            {
-                DeviceItem_t *item = node->data;
-                lv_obj_t *btn = lv_list_add_button(ui_DeviceList, item->is_active ? LV_SYMBOL_OK : LV_SYMBOL_BLUETOOTH, item->name);
-                lv_obj_add_event_cb(btn, device_row_clicked_cb, LV_EVENT_CLICKED, item->id);
-                node = node->next;
-            }
-        }
         bsp_display_unlock();
-
-        // Woken up by either a row tap (id) or the close button (NULL
-        // sentinel, see closeDevicesFn in ui_events.c) - covers the
-        // no-devices/error case too, since only "close" can be tapped then.
-        char *selected_id = NULL;
-        xQueueReceive(device_selection_queue, &selected_id, portMAX_DELAY);
-
-        if (selected_id)
+        if (result->list)
         {
-            HttpStatus_Code status_code;
-            esp_err_t err = spotify_transfer_playback(client, selected_id, &status_code);
-            if (err != ESP_OK || (status_code != HttpStatus_Ok && status_code != HTTP_STATUS_NO_CONTENT))
-            {
-                ESP_LOGW(TAG, "spotify_transfer_playback(%s) failed (err=%s, http_status=%d)", selected_id, esp_err_to_name(err), status_code);
-            }
+            spotify_free_nodes(result->list);
+            free(result->list);
         }
-
-        // Unlike playlist_task (a separate screen, navigated via
-        // lv_disp_load_scr), the device picker is a modal on top of
-        // ui_PlayerScreen - closing it is just re-hiding it.
-        bsp_display_lock(0);
-        lv_obj_add_flag(ui_DeviceModal, LV_OBJ_FLAG_HIDDEN);
-        bsp_display_unlock();
-
-        if (devices)
+        return;
+    }
+    devices_req = 0;
+    free_devices();
+    devices = result->list;
+    lv_obj_clean(ui_DeviceList);
+    if (!devices)
+    {
+        lv_label_set_text(ui_DeviceStatusLabel, "Error al obtener dispositivos");
+        lv_obj_clear_flag(ui_DeviceStatusLabel, LV_OBJ_FLAG_HIDDEN);
+    }
+    else if (devices->count == 0)
+    {
+        lv_label_set_text(ui_DeviceStatusLabel, "No se encontraron dispositivos");
+        lv_obj_clear_flag(ui_DeviceStatusLabel, LV_OBJ_FLAG_HIDDEN);
+    }
+    else
+    {
+        lv_obj_add_flag(ui_DeviceStatusLabel, LV_OBJ_FLAG_HIDDEN);
+        Node *node = devices->first;
+        while (node)
         {
-            // spotify_free_nodes() frees the Nodes/DeviceItem_t's but not
-            // the List struct itself (it's calloc'd by spotify_available_devices()).
-            spotify_free_nodes(devices);
-            free(devices);
+            DeviceItem_t *item = node->data;
+            lv_obj_t *btn = lv_list_add_button(ui_DeviceList, item->is_active ? LV_SYMBOL_OK : LV_SYMBOL_BLUETOOTH, item->name);
+            lv_obj_add_event_cb(btn, device_row_clicked_cb, LV_EVENT_CLICKED, item->id);
+            node = node->next;
         }
     }
+    bsp_display_unlock();
 }
 
-esp_err_t device_screen_init(void)
+void device_screen_open(void)
 {
-    device_selection_queue = xQueueCreate(1, sizeof(char *));
-    if (!device_selection_queue)
+    if (devices_req)
     {
-        ESP_LOGE(TAG, "Error creating device selection queue");
-        return ESP_FAIL;
+        spotify_request_cancel(client, devices_req);
     }
-    if (xTaskCreate(device_task, "device_task", 8192, NULL, 5, &device_task_handle) != pdPASS)
+    if (spotify_available_devices_async(client, devices_done_cb, NULL, &devices_req) != ESP_OK)
+    {
+        devices_req = 0;
+        lv_label_set_text(ui_DeviceStatusLabel, "Error al obtener dispositivos");
+    }
+}
+
+void device_screen_close(void)
+{
+    if (devices_req)
     {
-        ESP_LOGE(TAG, "Error creating device task");
-        return ESP_FAIL;
+        spotify_request_cancel(client, devices_req);
+        devices_req = 0;
     }
-    return ESP_OK;
+    // Rows are left to openDevicesFn's lv_obj_clean(), same as
+    // playlist_screen_close().
+    free_devices();
+    // Unlike the playlist screen (a separate screen, navigated via
+    // lv_disp_load_scr), the device picker is a modal on top of
+    // ui_PlayerScreen - closing it is just re-hiding it.
+    lv_obj_add_flag(ui_DeviceModal, LV_OBJ_FLAG_HIDDEN);
 }
@@ -1,13 +1,17 @@
 #pragma once
 
-#include "esp_err.h"
+/* Same as playlist_screen.h, for the device picker: fetching the devices and
+ * transferring playback are _async requests. All of these run on the
+ * lvgl_port task (ui_events.c), display lock held. */
 
 /**
- * @brief Creates the device-selection queue and the dedicated device_task,
- * and wires device_task_handle/device_selection_queue (app_globals.h).
- * Call once from app_main(), after spotify_client_init() has produced a
- * valid `client`.
- *
- * @return ESP_OK on success, ESP_FAIL if the queue or task couldn't be created.
+ * @brief Starts fetching the available devices into ui_DeviceModal, just
+ * shown by openDevicesFn (ui_events.c).
  */
-esp_err_t device_screen_init(void);
+void device_screen_open(void);
+
+/**
+ * @brief Hides ui_DeviceModal, cancelling a fetch still under way and
+ * freeing the devices listed.
+ */
+void device_screen_close(void);
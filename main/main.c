@@ -16,15 +16,6 @@
 #include "wifi_screen.h"
 
 esp_spotify_client_handle_t client = NULL;
-TaskHandle_t playlist_task_handle = NULL;
-QueueHandle_t playlist_selection_queue = NULL;
-QueueHandle_t volume_target_queue = NULL;
-QueueHandle_t seek_target_queue = NULL;
-TaskHandle_t device_task_handle = NULL;
-QueueHandle_t device_selection_queue = NULL;
-TaskHandle_t search_task_handle = NULL;
-QueueHandle_t search_query_queue = NULL;
-QueueHandle_t search_selection_queue = NULL;
 QueueHandle_t wifi_ap_selected_queue = NULL;
 QueueHandle_t wifi_password_submit_queue = NULL;
 
@@ -80,23 +71,5 @@ void app_main(void)
         return;
     }
 
-    if (playlist_screen_init() != ESP_OK)
-    {
-        ESP_LOGE(TAG, "Error initializing playlist screen");
-        return;
-    }
-
-    if (device_screen_init() != ESP_OK)
-    {
-        ESP_LOGE(TAG, "Error initializing device screen");
-        return;
-    }
-
-    if (search_screen_init() != ESP_OK)
-    {
-        ESP_LOGE(TAG, "Error initializing search screen");
-        return;
-    }
-
     player_screen_start();
 }
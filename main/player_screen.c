@@ -49,17 +49,14 @@ static lv_image_dsc_t pic_img_dsc = {
 
 static uint16_t *pixels = NULL;
 
-/* File-scope (was function-local to player_screen_start) so volume_task/
- * seek_task can read the last-known-good volume_percent/progress_ms to
- * resync the sliders after a failed PUT, without reaching into
- * esp_spotify_client's opaque struct (not visible outside the component). */
-static TrackInfo track = {.artists.type = STRING_LIST};
+/* A shallow copy of shown_track, the last NEW_TRACK snapshot, which is
+ * held for its strings; SAME_TRACK updates only change the scalars here. */
+static TrackInfo track = {.device.volume_percent = -1};
+static const TrackInfo *shown_track = NULL;
 
 /* Private function prototypes -----------------------------------------------*/
-static char *join_artist_names(List *artists);
+static char *join_artist_names(const TrackInfo *track);
 static void format_time(char *buf, size_t buf_size, int64_t ms);
-static void volume_task(void *arg);
-static void seek_task(void *arg);
 static esp_jpeg_image_scale_t pick_jpeg_scale(int source_size, int max_size);
 static void reset_cover_to_blank(void);
 
@@ -111,27 +108,11 @@ void player_screen_start(void)
         }
     }
 
-    volume_target_queue = xQueueCreate(1, sizeof(int));
-    if (!volume_target_queue || xTaskCreate(volume_task, "volume_task", 8192, NULL, 5, NULL) != pdPASS)
-    {
-        // Non-fatal: the slider just won't actually change anything on
-        // Spotify's side if this failed. Rest of the player still works.
-        ESP_LOGE(TAG, "Failed to start volume_task, volume slider will have no effect");
-    }
-
-    seek_target_queue = xQueueCreate(1, sizeof(int));
-    if (!seek_target_queue || xTaskCreate(seek_task, "seek_task", 8192, NULL, 5, NULL) != pdPASS)
-    {
-        ESP_LOGE(TAG, "Failed to start seek_task, progress slider will have no effect");
-    }
-
     pic_img_dsc.data = (uint8_t *)pixels;
     bsp_display_lock(0);
     lv_img_set_src(ui_CoverImage, &pic_img_dsc);
     bsp_display_unlock();
 
-    assert(track.name = strdup("No device playing..."));
-
     SpotifyEvent_t spotify_evt;
     TickType_t event_stamp = 0;
 
@@ -169,10 +150,10 @@ void player_screen_start(void)
                 {
                     // TODO: get all available devices
                 }
-                else
+                else if (spotify_evt.player_event == SAME_TRACK)
                 {
+                    spotify_track_unref(spotify_evt.payload);
                 }
-                player_dispatch_event(client, DATA_PROCESSED_EVENT);
                 continue;
             }
             // Bounded wait from here on (was `0`, a busy-spin: with no
@@ -189,9 +170,9 @@ void player_screen_start(void)
             {
             case NEW_TRACK:
                 got_real_update = true;
-                spotify_clear_track(&track);
-                spotify_clone_track(&track, (TrackInfo *)spotify_evt.payload);
-                player_dispatch_event(client, DATA_PROCESSED_EVENT);
+                spotify_track_unref(shown_track);
+                shown_track = spotify_evt.payload;
+                track = *shown_track;
                 progress_ms_now = track.progress_ms;
                 if (progress_ms_now > track.duration_ms)
                     progress_ms_now = track.duration_ms;
@@ -199,11 +180,11 @@ void player_screen_start(void)
                 {
                     free(artist_str);
                 }
-                artist_str = join_artist_names(&track.artists);
+                artist_str = join_artist_names(&track);
                 char total_buf[8];
                 format_time(total_buf, sizeof(total_buf), track.duration_ms);
                 bsp_display_lock(0);
-                lv_label_set_text(ui_Track, track.name);
+                lv_label_set_text(ui_Track, spotify_track_name(&track));
                 lv_label_set_text(ui_Artists, artist_str);
                 lv_label_set_text(ui_TrackTotalLabel, total_buf);
                 lv_label_set_text(ui_PauseUnpauseIcon, track.isPlaying ? LV_SYMBOL_PAUSE : LV_SYMBOL_PLAY);
@@ -267,10 +248,9 @@ void player_screen_start(void)
                 break;
             case SAME_TRACK:
                 got_real_update = true;
-                TrackInfo *t_updated = spotify_evt.payload;
+                const TrackInfo *t_updated = spotify_evt.payload;
                 track.isPlaying = t_updated->isPlaying;
                 track.progress_ms = t_updated->progress_ms;
-                player_dispatch_event(client, DATA_PROCESSED_EVENT);
                 progress_ms_now = track.progress_ms;
                 if (progress_ms_now > track.duration_ms)
                     progress_ms_now = track.duration_ms;
@@ -278,13 +258,12 @@ void player_screen_start(void)
                 lv_label_set_text(ui_PauseUnpauseIcon, track.isPlaying ? LV_SYMBOL_PAUSE : LV_SYMBOL_PLAY);
                 // Only touch the slider if the volume actually changed
                 // since we last knew it. When we're the ones who changed
-                // it (spotify_set_volume), client->track_info->device.
-                // volume_percent (what t_updated points at) was already
-                // optimistically updated before this WS echo arrived, so
-                // it'll match track.device.volume_percent below and this
-                // is a no-op - only a genuine external change (from
-                // another Spotify client) shows up as a difference here,
-                // so this can't fight the user's own in-progress drag.
+                // it (player_dispatch_volume), the slider is already at the
+                // value the client's prediction and then the WS echo carry,
+                // so setting it again is a no-op - only a genuine external
+                // change (from another Spotify client) or the rollback of a
+                // failed PUT actually moves it, so this can't fight the
+                // user's own in-progress drag.
                 if (t_updated->device.volume_percent >= 0 &&
                     t_updated->device.volume_percent != track.device.volume_percent)
                 {
@@ -292,12 +271,12 @@ void player_screen_start(void)
                     lv_slider_set_value(ui_VolumeSlider, track.device.volume_percent, LV_ANIM_OFF);
                 }
                 bsp_display_unlock();
+                spotify_track_unref(t_updated);
                 break;
             case NO_PLAYER_ACTIVE:
                 // TODO: get all devices available
                 break;
             default:
-                player_dispatch_event(client, DATA_PROCESSED_EVENT);
                 continue;
             }
         }
@@ -346,62 +325,6 @@ void player_screen_start(void)
 }
 
 /* Private functions ---------------------------------------------------------*/
-/* Dedicated task so the (blocking) spotify_set_volume() HTTP call never
- * freezes lvgl_port's own task (which pumps lv_timer_handler() and would
- * otherwise stall rendering/input for that whole time) - same reasoning as
- * playlist_task (playlist_screen.c). Sits idle until
- * volume_commit_timer_cb() (ui_events.c) overwrites volume_target_queue
- * once the user's drag has settled. */
-static void volume_task(void *arg)
-{
-    int target;
-    for (;;)
-    {
-        xQueueReceive(volume_target_queue, &target, portMAX_DELAY);
-        HttpStatus_Code status_code;
-        esp_err_t err = spotify_set_volume(client, target, &status_code);
-        // The slider already shows `target` (LVGL moved it on touch,
-        // independent of whether the PUT succeeded). If it didn't, resync
-        // to the last confirmed value instead of leaving the UI wrong -
-        // Spotify 404s volume/seek fairly often with a briefly-inactive
-        // device (ANALYSIS.md 1.17).
-        if (err != ESP_OK || (status_code != HttpStatus_Ok && status_code != HTTP_STATUS_NO_CONTENT))
-        {
-            ESP_LOGW(TAG, "spotify_set_volume(%d) failed (err=%s, http_status=%d), resyncing slider", target, esp_err_to_name(err), status_code);
-            if (track.device.volume_percent >= 0)
-            {
-                bsp_display_lock(0);
-                lv_slider_set_value(ui_VolumeSlider, track.device.volume_percent, LV_ANIM_OFF);
-                bsp_display_unlock();
-            }
-        }
-    }
-}
-
-/* Same reasoning as volume_task above, for the seek slider: the (blocking)
- * spotify_seek_to_position() HTTP call must not run on lvgl_port's task.
- * Sits idle until seekSliderChangedFn() (ui_events.c) overwrites
- * seek_target_queue on release. */
-static void seek_task(void *arg)
-{
-    int target_ms;
-    for (;;)
-    {
-        xQueueReceive(seek_target_queue, &target_ms, portMAX_DELAY);
-        HttpStatus_Code status_code;
-        esp_err_t err = spotify_seek_to_position(client, target_ms, &status_code);
-        // See volume_task's comment above - same silent-failure problem,
-        // same fix.
-        if (err != ESP_OK || (status_code != HttpStatus_Ok && status_code != HTTP_STATUS_NO_CONTENT))
-        {
-            ESP_LOGW(TAG, "spotify_seek_to_position(%d) failed (err=%s, http_status=%d), resyncing slider", target_ms, esp_err_to_name(err), status_code);
-            bsp_display_lock(0);
-            lv_slider_set_value(ui_ProgressBar, track.progress_ms, LV_ANIM_OFF);
-            bsp_display_unlock();
-        }
-    }
-}
-
 static void format_time(char *buf, size_t buf_size, int64_t ms)
 {
     if (ms < 0)
@@ -412,16 +335,15 @@ static void format_time(char *buf, size_t buf_size, int64_t ms)
     snprintf(buf, buf_size, "%d:%02d", total_sec / 60, total_sec % 60);
 }
 
-static char *join_artist_names(List *artists)
+static char *join_artist_names(const TrackInfo *track)
 {
-    if (!artists || artists->count == 0) return strdup("");
+    int count = spotify_track_artist_count(track);
+    if (count == 0) return strdup("");
 
     size_t total_len = 0;
-    Node *node = artists->first;
-    while (node) {
-        total_len += strlen((char *)node->data);
-        if (node->next) total_len += 2; // ", "
-        node = node->next;
+    for (int i = 0; i < count; i++) {
+        total_len += strlen(spotify_track_artist(track, i));
+        if (i + 1 < count) total_len += 2; // ", "
     }
 
     // Reservamos la cadena final (+1 para el '\0')
@@ -430,12 +352,10 @@ static char *join_artist_names(List *artists)
 
     result[0] = '\0';
 
-    node = artists->first;
-    while (node) {
-        strcat(result, (char *)node->data);
-        if (node->next)
+    for (int i = 0; i < count; i++) {
+        strcat(result, spotify_track_artist(track, i));
+        if (i + 1 < count)
             strcat(result, ", ");
-        node = node->next;
     }
 
     return result;
@@ -6,94 +6,120 @@
 
 static const char *TAG = "PLAYLIST_SCREEN";
 
+/* The fetch under way (0 if none) and the playlists listed, whose uris the
+ * rows point into. Only touched under the display lock: on the lvgl_port
+ * task (which holds it while dispatching touch events) or in
+ * playlists_done_cb. */
+static spotify_request_t playlists_req = 0;
+static List *playlists = NULL;
+
+static void free_playlists(void)
+{
+    if (playlists)
+    {
+        // spotify_free_nodes() frees the Nodes/PlaylistItem_t's but not
+        // the List struct itself (it's calloc'd by spotify_user_playlists()).
+        spotify_free_nodes(playlists);
+        free(playlists);
+        playlists = NULL;
+    }
+}
+
+/* Runs on the client's worker task once spotify_play_context_uri() is
+ * done; nothing to show, only a failure to log. */
+static void play_done_cb(spotify_request_t req, spotify_async_result_t *result, void *user_ctx)
+{
+    if (result->err != ESP_OK || (result->status_code != HttpStatus_Ok && result->status_code != HTTP_STATUS_NO_CONTENT))
+    {
+        ESP_LOGW(TAG, "spotify_play_context_uri() failed (err=%s, http_status=%d)", esp_err_to_name(result->err), result->status_code);
+    }
+}
+
 /* Runs on the lvgl_port task (touch dispatch) when a playlist row is
- * tapped; the row's uri (PlaylistItem_t.uri, still owned by the List that
- * playlist_task hasn't freed yet - see playlist_task) was stored as the
- * event's user_data when the row button was created. Just hands it off;
- * playlist_task does the actual (blocking) spotify_play_context_uri call. */
+ * tapped; the row's uri (PlaylistItem_t.uri, owned by `playlists`) was
+ * stored as the event's user_data when the row button was created.
+ * spotify_play_context_uri_async() copies it, so the list can go right
+ * away with the screen. */
 static void playlist_row_clicked_cb(lv_event_t *e)
 {
     char *uri = lv_event_get_user_data(e);
-    xQueueSend(playlist_selection_queue, &uri, 0);
+    if (spotify_play_context_uri_async(client, uri, play_done_cb, NULL, NULL) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error queueing the selected playlist");
+    }
+    playlist_screen_close();
 }
 
-/* Dedicated task so the (blocking, ~1-2s) spotify_user_playlists() HTTP
- * call never freezes lvgl_port's own task (which pumps lv_timer_handler()
- * and would otherwise stall rendering/input for that whole time). Sits
- * idle until openPlaylistsFn() (ui_events.c) wakes it via
- * xTaskNotifyGive(). */
-static void playlist_task(void *arg)
+/* Runs on the client's worker task once spotify_user_playlists() is done -
+ * never for a fetch cancelled by playlist_screen_close(). The check on req
+ * still matters, as in search_screen.c's search_done_cb: the close may
+ * have come too late to cancel it. */
+static void playlists_done_cb(spotify_request_t req, spotify_async_result_t *result, void *user_ctx)
 {
-    for (;;)
+    bsp_display_lock(0);
+    if (req != playlists_req)
     {
-        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
-
-        List *playlists = spotify_user_playlists(client);
-
-        bsp_display_lock(0);
-        lv_obj_clean(ui_PlaylistList);
-        if (!playlists)
-        {
-            lv_label_set_text(ui_PlaylistStatusLabel, "Error al obtener playlists");
-            lv_obj_clear_flag(ui_PlaylistStatusLabel, LV_OBJ_FLAG_HIDDEN);
-        }
-        else if (playlists->count == 0)
-        {
-            lv_label_set_text(ui_PlaylistStatusLabel, "No se encontraron playlists");
-            lv_obj_clear_flag(ui_PlaylistStatusLabel, LV_OBJ_FLAG_HIDDEN);
-        }
-        else
-        {
-            lv_obj_add_flag(ui_PlaylistStatusLabel, LV_OBJ_FLAG_HIDDEN);
-            Node *node = playlists->first;
-            while (node)
-            {
-                PlaylistItem_t *item = node->data;
-                lv_obj_t *btn = lv_list_add_button(ui_PlaylistList, LV_SYMBOL_AUDIO, item->name);
-                lv_obj_add_event_cb(btn, playlist_row_clicked_cb, LV_EVENT_CLICKED, item->uri);
-                node = node->next;
-            }
-        }
         bsp_display_unlock();
-
-        // Woken up by either a row tap (uri) or the back button (NULL
-        // sentinel, see playlistBackFn in ui_events.c) - covers the
-        // no-playlists/error case too, since only "back" can be tapped then.
-        char *selected_uri = NULL;
-        xQueueReceive(playlist_selection_queue, &selected_uri, portMAX_DELAY);
-
-        if (selected_uri)
+        if (result->list)
         {
-            HttpStatus_Code status_code;
-            spotify_play_context_uri(client, selected_uri, &status_code);
+            spotify_free_nodes(result->list);
+            free(result->list);
         }
-
-        bsp_display_lock(0);
-        lv_disp_load_scr(ui_PlayerScreen);
-        bsp_display_unlock();
-
-        if (playlists)
+        return;
+    }
+    playlists_req = 0;
+    free_playlists();
+    playlists = result->list;
+    lv_obj_clean(ui_PlaylistList);
+    if (!playlists)
+    {
+        lv_label_set_text(ui_PlaylistStatusLabel, "Error al obtener playlists");
+        lv_obj_clear_flag(ui_PlaylistStatusLabel, LV_OBJ_FLAG_HIDDEN);
+    }
+    else if (playlists->count == 0)
+    {
+        lv_label_set_text(ui_PlaylistStatusLabel, "No se encontraron playlists");
+        lv_obj_clear_flag(ui_PlaylistStatusLabel, LV_OBJ_FLAG_HIDDEN);
+    }
+    else
+    {
+        lv_obj_add_flag(ui_PlaylistStatusLabel, LV_OBJ_FLAG_HIDDEN);
+        Node *node = playlists->first;
+        while (node)
         {
-            // spotify_free_nodes() frees the Nodes/PlaylistItem_t's but not
-            // the List struct itself (it's calloc'd by spotify_user_playlists()).
-            spotify_free_nodes(playlists);
-            free(playlists);
+            PlaylistItem_t *item = node->data;
+            lv_obj_t *btn = lv_list_add_button(ui_PlaylistList, LV_SYMBOL_AUDIO, item->name);
+            lv_obj_add_event_cb(btn, playlist_row_clicked_cb, LV_EVENT_CLICKED, item->uri);
+            node = node->next;
         }
     }
+    bsp_display_unlock();
 }
 
-esp_err_t playlist_screen_init(void)
+void playlist_screen_open(void)
 {
-    playlist_selection_queue = xQueueCreate(1, sizeof(char *));
-    if (!playlist_selection_queue)
+    if (playlists_req)
     {
-        ESP_LOGE(TAG, "Error creating playlist selection queue");
-        return ESP_FAIL;
+        spotify_request_cancel(client, playlists_req);
     }
-    if (xTaskCreate(playlist_task, "playlist_task", 8192, NULL, 5, &playlist_task_handle) != pdPASS)
+    if (spotify_user_playlists_async(client, playlists_done_cb, NULL, &playlists_req) != ESP_OK)
+    {
+        playlists_req = 0;
+        lv_label_set_text(ui_PlaylistStatusLabel, "Error al obtener playlists");
+    }
+}
+
+void playlist_screen_close(void)
+{
+    if (playlists_req)
     {
-        ESP_LOGE(TAG, "Error creating playlist task");
-        return ESP_FAIL;
+        // the connection is dropped instead of read to the end
+        spotify_request_cancel(client, playlists_req);
+        playlists_req = 0;
     }
-    return ESP_OK;
+    // Rows are left to openPlaylistsFn's lv_obj_clean() (this may be
+    // running from one of their own click callbacks): pointing into freed
+    // playlists, on a screen no longer shown, they can't be tapped until then.
+    free_playlists();
+    lv_disp_load_scr(ui_PlayerScreen);
 }
@@ -1,13 +1,18 @@
 #pragma once
 
-#include "esp_err.h"
+/* No task of its own: fetching the playlists and playing the one picked are
+ * spotify_client _async requests, run on the client's worker task, same as
+ * search_screen.h. All of these run on the lvgl_port task (ui_events.c),
+ * display lock held. */
 
 /**
- * @brief Creates the playlist-selection queue and the dedicated
- * playlist_task, and wires playlist_task_handle/playlist_selection_queue
- * (app_globals.h). Call once from app_main(), after spotify_client_init()
- * has produced a valid `client`.
- *
- * @return ESP_OK on success, ESP_FAIL if the queue or task couldn't be created.
+ * @brief Starts fetching the user's playlists into ui_PlaylistScreen, just
+ * loaded by openPlaylistsFn (ui_events.c).
  */
-esp_err_t playlist_screen_init(void);
+void playlist_screen_open(void);
+
+/**
+ * @brief Goes back to ui_PlayerScreen, cancelling a fetch still under way
+ * and freeing the playlists listed.
+ */
+void playlist_screen_close(void);
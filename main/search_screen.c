@@ -7,109 +7,114 @@
 
 static const char *TAG = "SEARCH_SCREEN";
 
+/* The search being fetched (0 if none) and the results on screen, whose
+ * uris the result rows point into. Both only touched under the display
+ * lock: on the lvgl_port task (which holds it while dispatching touch
+ * events) or in search_done_cb. */
+static spotify_request_t search_req = 0;
+static List *search_results = NULL;
+
+static void free_results(void)
+{
+    if (search_results)
+    {
+        // spotify_free_nodes() frees the Nodes/TrackSearchItem_t's but not
+        // the List struct itself (it's calloc'd by spotify_search_tracks()).
+        spotify_free_nodes(search_results);
+        free(search_results);
+        search_results = NULL;
+    }
+}
+
 /* Runs on the lvgl_port task (touch dispatch) when a search result row is
- * tapped; the row's uri (TrackSearchItem_t.uri, still owned by the List that
- * search_task hasn't freed yet - see search_task) was stored as the event's
- * user_data when the row button was created. Just hands it off; search_task
- * does the actual (blocking) spotify_play_track_uri call. */
+ * tapped; the row's uri (TrackSearchItem_t.uri, owned by search_results)
+ * was stored as the event's user_data when the row button was created.
+ * spotify_play_track_uri_async() copies it, so the results can go right
+ * away with the screen. */
 static void search_row_clicked_cb(lv_event_t *e)
 {
     char *uri = lv_event_get_user_data(e);
-    xQueueSend(search_selection_queue, &uri, 0);
+    if (spotify_play_track_uri_async(client, uri, NULL, NULL, NULL) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error queueing the selected track");
+    }
+    search_screen_close();
 }
 
-/* Dedicated task so the (blocking) spotify_search_tracks()/
- * spotify_play_track_uri() HTTP calls never freeze lvgl_port's own task -
- * same reasoning as playlist_task/device_task. Unlike those, has two wait
- * points instead of one: first for a submitted query (or "back" tapped
- * before ever submitting one), then - only if a query came in - for a row
- * tap (or "back" tapped once results/status are showing). See
- * searchBackFn (ui_events.c) for how it decides which of the two queues to
- * signal. */
-static void search_task(void *arg)
+/* Runs on the Spotify client's worker task once spotify_search_tracks() is
+ * done - never for a search cancelled by search_screen_close() or a newer
+ * search_screen_submit(). The check on req still matters: one of those may
+ * have come too late to cancel it, and be waiting for the display lock
+ * taken here, or already be done. */
+static void search_done_cb(spotify_request_t req, spotify_async_result_t *result, void *user_ctx)
 {
-    for (;;)
+    bsp_display_lock(0);
+    if (req != search_req)
     {
-        char *query = NULL;
-        xQueueReceive(search_query_queue, &query, portMAX_DELAY);
-
-        List *tracks = NULL;
-        if (query)
+        bsp_display_unlock();
+        if (result->list)
         {
-            tracks = spotify_search_tracks(client, query);
-            free(query);
-
-            bsp_display_lock(0);
-            lv_obj_clean(ui_SearchResultList);
-            if (!tracks)
-            {
-                lv_label_set_text(ui_SearchStatusLabel, "Error al buscar");
-                lv_obj_clear_flag(ui_SearchStatusLabel, LV_OBJ_FLAG_HIDDEN);
-            }
-            else if (tracks->count == 0)
-            {
-                lv_label_set_text(ui_SearchStatusLabel, "No se encontraron canciones");
-                lv_obj_clear_flag(ui_SearchStatusLabel, LV_OBJ_FLAG_HIDDEN);
-            }
-            else
-            {
-                lv_obj_add_flag(ui_SearchStatusLabel, LV_OBJ_FLAG_HIDDEN);
-                Node *node = tracks->first;
-                while (node)
-                {
-                    TrackSearchItem_t *item = node->data;
-                    char row_text[128];
-                    snprintf(row_text, sizeof(row_text), "%s - %s", item->name, item->artists ? item->artists : "");
-                    lv_obj_t *btn = lv_list_add_button(ui_SearchResultList, LV_SYMBOL_AUDIO, row_text);
-                    lv_obj_add_event_cb(btn, search_row_clicked_cb, LV_EVENT_CLICKED, item->uri);
-                    node = node->next;
-                }
-            }
-            bsp_display_unlock();
-
-            // Woken up by either a row tap (uri) or the back button (NULL
-            // sentinel, see searchBackFn) - covers the no-results/error case
-            // too, since only "back" can be tapped then.
-            char *selected_uri = NULL;
-            xQueueReceive(search_selection_queue, &selected_uri, portMAX_DELAY);
-
-            if (selected_uri)
-            {
-                HttpStatus_Code status_code;
-                spotify_play_track_uri(client, selected_uri, &status_code);
-            }
+            spotify_free_nodes(result->list);
+            free(result->list);
         }
-        // query == NULL means "back" was tapped before ever submitting one -
-        // nothing was fetched, nothing to clean up beyond leaving the screen,
-        // which is exactly what happens next either way.
-
-        bsp_display_lock(0);
-        lv_disp_load_scr(ui_PlayerScreen);
-        bsp_display_unlock();
-
-        if (tracks)
+        return;
+    }
+    search_req = 0;
+    free_results();
+    search_results = result->list;
+    lv_obj_clean(ui_SearchResultList);
+    if (!search_results)
+    {
+        lv_label_set_text(ui_SearchStatusLabel, "Error al buscar");
+        lv_obj_clear_flag(ui_SearchStatusLabel, LV_OBJ_FLAG_HIDDEN);
+    }
+    else if (search_results->count == 0)
+    {
+        lv_label_set_text(ui_SearchStatusLabel, "No se encontraron canciones");
+        lv_obj_clear_flag(ui_SearchStatusLabel, LV_OBJ_FLAG_HIDDEN);
+    }
+    else
+    {
+        lv_obj_add_flag(ui_SearchStatusLabel, LV_OBJ_FLAG_HIDDEN);
+        Node *node = search_results->first;
+        while (node)
         {
-            // spotify_free_nodes() frees the Nodes/TrackSearchItem_t's but not
-            // the List struct itself (it's calloc'd by spotify_search_tracks()).
-            spotify_free_nodes(tracks);
-            free(tracks);
+            TrackSearchItem_t *item = node->data;
+            char row_text[128];
+            snprintf(row_text, sizeof(row_text), "%s - %s", item->name, item->artists ? item->artists : "");
+            lv_obj_t *btn = lv_list_add_button(ui_SearchResultList, LV_SYMBOL_AUDIO, row_text);
+            lv_obj_add_event_cb(btn, search_row_clicked_cb, LV_EVENT_CLICKED, item->uri);
+            node = node->next;
         }
     }
+    bsp_display_unlock();
 }
 
-esp_err_t search_screen_init(void)
+void search_screen_submit(const char *query)
 {
-    search_query_queue = xQueueCreate(1, sizeof(char *));
-    search_selection_queue = xQueueCreate(1, sizeof(char *));
-    if (!search_query_queue || !search_selection_queue)
+    if (search_req)
+    {
+        spotify_request_cancel(client, search_req);
+    }
+    free_results();
+    if (spotify_search_tracks_async(client, query, search_done_cb, NULL, &search_req) != ESP_OK)
     {
-        ESP_LOGE(TAG, "Error creating search queues");
-        return ESP_FAIL;
+        search_req = 0;
+        lv_label_set_text(ui_SearchStatusLabel, "Error al buscar");
     }
-    if (xTaskCreate(search_task, "search_task", 8192, NULL, 5, &search_task_handle) != pdPASS)
+}
+
+void search_screen_close(void)
+{
+    if (search_req)
     {
-        ESP_LOGE(TAG, "Error creating search task");
-        return ESP_FAIL;
+        // the connection is dropped instead of read to the end
+        spotify_request_cancel(client, search_req);
+        search_req = 0;
     }
-    return ESP_OK;
+    // Rows are left to openSearchFn's lv_obj_clean() (this may be running
+    // from one of their own click callbacks): pointing into freed results,
+    // on a screen no longer shown, they can't be tapped until then.
+    free_results();
+    lv_disp_load_scr(ui_PlayerScreen);
 }
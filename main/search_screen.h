@@ -1,13 +1,18 @@
 #pragma once
 
-#include "esp_err.h"
+/* No task of its own: the search and playing the picked track are
+ * spotify_client _async requests, run on the client's worker task. All of
+ * these run on the lvgl_port task (ui_events.c), display lock held. */
 
 /**
- * @brief Creates the search-query/search-selection queues and the dedicated
- * search_task, and wires search_task_handle/search_query_queue/
- * search_selection_queue (app_globals.h). Call once from app_main(), after
- * spotify_client_init() has produced a valid `client`.
- *
- * @return ESP_OK on success, ESP_FAIL if a queue or the task couldn't be created.
+ * @brief Starts searching for `query` (copied), cancelling a search still
+ * under way; the results replace ui_SearchResultList's rows when it's done.
  */
-esp_err_t search_screen_init(void);
+void search_screen_submit(const char *query);
+
+/**
+ * @brief Leaves the search screen for ui_PlayerScreen, cancelling a search
+ * still under way (its connection is dropped, not read to the end) and
+ * freeing the results shown.
+ */
+void search_screen_close(void);
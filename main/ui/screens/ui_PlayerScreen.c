@@ -265,8 +265,9 @@ void ui_PlayerScreen_screen_init(void)
     // screen (child of ui_PlayerScreen, not a separate SquareLine-style
     // screen - opening/closing it is just toggling LV_OBJ_FLAG_HIDDEN, no
     // lv_disp_load_scr) with a centered panel on top. Hidden by default;
-    // shown by openDevicesFn (ui_events.c), populated/hidden again by
-    // device_task (device_screen.c). Clickable, and closes on its own
+    // shown by openDevicesFn (ui_events.c), populated by
+    // devices_done_cb and hidden again by device_screen_close()
+    // (device_screen.c). Clickable, and closes on its own
     // LV_EVENT_CLICKED (ui_event_DeviceModal below) - LVGL doesn't bubble
     // events from the panel/list to the backdrop by default, so a tap
     // lands directly on ui_DeviceModal only when it's genuinely outside
@@ -2,8 +2,8 @@
 // same *_screen_init() / global lv_obj_t* pattern as ui_PlayerScreen.c so it
 // fits the rest of this SquareLine-based UI.
 //
-// Widgets here are only created once, at ui_init() time. main/main.c's
-// playlist_task populates/clears ui_PlaylistList and toggles
+// Widgets here are only created once, at ui_init() time. main/playlist_screen.c's
+// playlists_done_cb populates/clears ui_PlaylistList and toggles
 // ui_PlaylistStatusLabel each time the screen is opened; this file only
 // builds the static skeleton.
 
@@ -1,6 +1,6 @@
 // Hand-written screen (not generated by SquareLine Studio), same pattern as
 // ui_PlaylistScreen.c/ui_PlayerScreen.c's ui_DeviceModal: dark palette,
-// widgets built once at ui_init() time. search_screen.c's search_task
+// widgets built once at ui_init() time. search_screen.c's search_done_cb
 // populates/clears ui_SearchResultList and toggles ui_SearchStatusLabel; the
 // query textarea/keyboard are driven by ui_events.c (openSearchFn/
 // searchSubmitFn/searchBackFn).
@@ -64,7 +64,7 @@ void ui_SearchScreen_screen_init(void)
     // Bound to ui_SearchInput: typing focuses it automatically once tapped,
     // but it's also shown by default right away since this screen only ever
     // exists to type a query. Hidden once searchSubmitFn hands the query off
-    // to search_task, shown again next time openSearchFn resets the screen.
+    // to search_screen_submit(), shown again next time openSearchFn resets the screen.
     ui_SearchKeyboard = lv_keyboard_create(ui_SearchScreen);
     lv_keyboard_set_textarea(ui_SearchKeyboard, ui_SearchInput);
     lv_obj_set_size(ui_SearchKeyboard, 480, 190);
@@ -5,6 +5,9 @@
 
 #include "ui.h"
 #include "../app_globals.h"
+#include "../search_screen.h"
+#include "../playlist_screen.h"
+#include "../device_screen.h"
 #include <string.h>
 
 void prevFn(lv_event_t * e)
@@ -30,17 +33,17 @@ void nextFn(lv_event_t * e)
 static lv_timer_t *volume_debounce_timer = NULL;
 
 /* Runs once VOLUME_DEBOUNCE_MS has passed with no further drag: hands the
- * settled value off to volume_task (player_screen.c) via volume_target_queue
- * so the blocking spotify_set_volume() HTTP call happens off the lvgl_port
- * task (same reasoning as openPlaylistsFn below). xQueueOverwrite so only
- * the latest value matters, matching the "only care about where the user
- * left it" semantics of a debounce. */
+ * settled value to the client's player_task (player_dispatch_volume()), so
+ * the HTTP call happens off the lvgl_port task. A volume still waiting
+ * there is replaced, matching the "only care about where the user left it"
+ * semantics of a debounce; if the PUT fails, the SAME_TRACK that undoes
+ * the client's prediction moves the slider back (player_screen.c). */
 static void volume_commit_timer_cb(lv_timer_t *timer)
 {
 	lv_timer_del(timer);
 	volume_debounce_timer = NULL;
 	int target = lv_slider_get_value(ui_VolumeSlider);
-	xQueueOverwrite(volume_target_queue, &target);
+	player_dispatch_volume(client, target);
 }
 
 void volumeSliderChangedFn(lv_event_t * e)
@@ -59,64 +62,60 @@ void volumeSliderChangedFn(lv_event_t * e)
  * ui_event_ProgressBar, ui.c), not on every LV_EVENT_VALUE_CHANGED - no
  * debounce timer needed, since a release/tap already is the single "user
  * settled here" moment for a scrubber (a drag doesn't repeatedly fire this,
- * only the final lift-off does). Same handoff-to-a-dedicated-task reasoning
- * as volumeSliderChangedFn otherwise: seek_task (player_screen.c) does the
- * blocking spotify_seek_to_position() call, not this (lvgl_port) task. */
+ * only the final lift-off does). Same handoff as volumeSliderChangedFn
+ * otherwise: player_dispatch_seek() queues it for the client's
+ * player_task, not this (lvgl_port) task. */
 void seekSliderChangedFn(lv_event_t * e)
 {
 	int target_ms = lv_slider_get_value(ui_ProgressBar);
-	xQueueOverwrite(seek_target_queue, &target_ms);
+	player_dispatch_seek(client, target_ms);
 }
 
 /* Runs on the lvgl_port task (touch dispatch), which already holds the
  * LVGL lock while calling this - do NOT call bsp_display_lock() here, only
- * playlist_task (a genuinely separate task) needs to lock around its LVGL
- * calls. This just gives instant visual feedback and hands the (blocking)
- * network fetch off to playlist_task. */
+ * the client's worker task (a genuinely separate task) needs to lock around
+ * its LVGL calls. This just gives instant visual feedback and hands the
+ * network fetch off to an _async request (playlist_screen_open()). */
 void openPlaylistsFn(lv_event_t * e)
 {
 	lv_obj_clean(ui_PlaylistList);
 	lv_label_set_text(ui_PlaylistStatusLabel, "Cargando...");
 	lv_obj_clear_flag(ui_PlaylistStatusLabel, LV_OBJ_FLAG_HIDDEN);
 	lv_disp_load_scr(ui_PlaylistScreen);
-	xTaskNotifyGive(playlist_task_handle);
+	playlist_screen_open();
 }
 
-/* Doesn't navigate by itself: pushes a NULL sentinel so playlist_task (which
- * owns the fetched List's lifetime) is the single place that decides when
- * it's safe to switch back to ui_PlayerScreen and free the list. */
+/* playlist_screen.c owns the fetched List: it frees it on the way back to
+ * ui_PlayerScreen, and cancels a fetch still under way. */
 void playlistBackFn(lv_event_t * e)
 {
-	char *back_sentinel = NULL;
-	xQueueSend(playlist_selection_queue, &back_sentinel, 0);
+	playlist_screen_close();
 }
 
 /* Unlike openPlaylistsFn, this doesn't navigate to a separate screen - the
  * device picker is a modal (ui_DeviceModal, child of ui_PlayerScreen, see
  * ui_PlayerScreen.c), just shown/hidden in place. Same reasoning otherwise:
  * instant visual feedback here, the blocking spotify_available_devices()
- * fetch happens on device_task. */
+ * fetch is an _async request (device_screen_open()). */
 void openDevicesFn(lv_event_t * e)
 {
 	lv_obj_clean(ui_DeviceList);
 	lv_label_set_text(ui_DeviceStatusLabel, "Cargando...");
 	lv_obj_clear_flag(ui_DeviceStatusLabel, LV_OBJ_FLAG_HIDDEN);
 	lv_obj_clear_flag(ui_DeviceModal, LV_OBJ_FLAG_HIDDEN);
-	xTaskNotifyGive(device_task_handle);
+	device_screen_open();
 }
 
-/* Doesn't hide the modal itself - device_task (which owns the fetched
- * List's lifetime) is the single place that decides when it's safe to do
- * that, same reasoning as playlistBackFn. */
+/* Same as playlistBackFn: device_screen.c hides the modal and frees the
+ * List it owns. */
 void closeDevicesFn(lv_event_t * e)
 {
-	char *back_sentinel = NULL;
-	xQueueSend(device_selection_queue, &back_sentinel, 0);
+	device_screen_close();
 }
 
 /* Runs on the lvgl_port task, same reasoning as openPlaylistsFn: instant
- * visual feedback here, the blocking spotify_search_tracks() fetch happens
- * on search_task once the user actually submits a query (searchSubmitFn) -
+ * visual feedback here, the spotify_search_tracks_async() fetch only starts
+ * once the user actually submits a query (searchSubmitFn) -
  * opening the screen alone doesn't touch the network. Resets the screen to
  * its "not searched yet" state every time it's opened (query box empty,
  * keyboard up, no stale results/status from a previous visit). */
@@ -131,12 +130,11 @@ void openSearchFn(lv_event_t * e)
 }
 
 /* Bound to ui_SearchKeyboard's LV_EVENT_READY (the keyboard's own "OK"/enter
- * key, see ui_event_SearchKeyboard, ui_SearchScreen.c). Hands the typed text
- * off to search_task (a strdup'd
- * copy - the textarea's own buffer isn't guaranteed to outlive this call)
- * and swaps the keyboard out for the results list/status, same
- * instant-feedback-here / blocking-call-on-a-task split as every other
- * network-triggering event in this file. */
+ * key, see ui_event_SearchKeyboard, ui_SearchScreen.c). Starts the search
+ * (search_screen_submit() copies the text - the textarea's own buffer isn't
+ * guaranteed to outlive this call) and swaps the keyboard out for the
+ * results list/status, same instant-feedback-here / network-call-elsewhere
+ * split as every other network-triggering event in this file. */
 void searchSubmitFn(lv_event_t * e)
 {
 	const char *text = lv_textarea_get_text(ui_SearchInput);
@@ -144,39 +142,20 @@ void searchSubmitFn(lv_event_t * e)
 	{
 		return;
 	}
-	char *query = strdup(text);
-	if (!query)
-	{
-		return;
-	}
 	lv_obj_add_flag(ui_SearchKeyboard, LV_OBJ_FLAG_HIDDEN);
 	lv_obj_clean(ui_SearchResultList);
 	lv_obj_clear_flag(ui_SearchResultList, LV_OBJ_FLAG_HIDDEN);
 	lv_label_set_text(ui_SearchStatusLabel, "Buscando...");
 	lv_obj_clear_flag(ui_SearchStatusLabel, LV_OBJ_FLAG_HIDDEN);
-	xQueueSend(search_query_queue, &query, 0);
+	search_screen_submit(text);
 }
 
-/* Unlike playlistBackFn/closeDevicesFn, search_task can be blocked on either
- * of two different queues depending on how far the user got before tapping
- * back: still typing (never submitted, search_task's first receive is on
- * search_query_queue) vs. results/status already showing (search_task is
- * waiting on search_selection_queue for a row tap). ui_SearchKeyboard's
- * hidden flag is already the source of truth for which phase we're in (see
- * openSearchFn/searchSubmitFn), so reuse it here instead of tracking a
- * separate bit of state - whichever queue search_task is actually blocked on
- * gets the NULL sentinel. */
+/* Whether a search is still being fetched or its results are showing, or
+ * nothing was submitted at all: search_screen_close() cancels whatever is
+ * under way and leaves. */
 void searchBackFn(lv_event_t * e)
 {
-	char *back_sentinel = NULL;
-	if (lv_obj_has_flag(ui_SearchKeyboard, LV_OBJ_FLAG_HIDDEN))
-	{
-		xQueueSend(search_selection_queue, &back_sentinel, 0);
-	}
-	else
-	{
-		xQueueSend(search_query_queue, &back_sentinel, 0);
-	}
+	search_screen_close();
 }
 
 /* Bound to ui_WifiKeyboard's LV_EVENT_READY (see ui_event_WifiKeyboard,